@@ -0,0 +1,150 @@
+/// A monotonic memory arena: hands out memory from big blocks by bumping a
+/// pointer, and gives it all back at once when it's destroyed.
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace json {
+
+class Arena {
+public:
+  /// @param firstBlockSize the size of the first block we allocate. Each new
+  ///        block is twice as big as the last one, up to maxBlockSize
+  explicit Arena(size_t firstBlockSize = 4096)
+      : nextBlockSize(std::max<size_t>(firstBlockSize, 64)) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&other) noexcept
+      : blocks(std::move(other.blocks)), current(other.current),
+        end(other.end), nextBlockSize(other.nextBlockSize),
+        allocated(other.allocated) {
+    other.current = other.end = nullptr;
+    other.allocated = 0;
+  }
+  Arena &operator=(Arena &&other) noexcept {
+    blocks = std::move(other.blocks);
+    current = other.current;
+    end = other.end;
+    nextBlockSize = other.nextBlockSize;
+    allocated = other.allocated;
+    other.current = other.end = nullptr;
+    other.allocated = 0;
+    return *this;
+  }
+
+  /// The biggest block that we'll grow to. Bigger requests get a block of
+  /// their own.
+  static constexpr size_t maxBlockSize = 1024 * 1024;
+
+  /**
+   * @brief Returns 'bytes' of uninitialized memory
+   *
+   * The memory stays valid until the arena is destroyed or release() is called.
+   *
+   * @param bytes How much memory is needed
+   * @param alignment The alignment that the memory needs; a power of 2
+   */
+  void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+    assert((alignment & (alignment - 1)) == 0);
+    char *result = align(current, alignment);
+    // Blocks can be any size, so aligning can take us past the end
+    if ((result == nullptr) || (result > end) ||
+        (bytes > static_cast<size_t>(end - result))) {
+      newBlock(bytes + alignment);
+      result = align(current, alignment);
+    }
+    current = result + bytes;
+    allocated += bytes;
+    return result;
+  }
+
+  /// Allocates uninitialized memory for 'n' T's
+  template <typename T> T *allocateArray(size_t n) {
+    return static_cast<T *>(allocate(sizeof(T) * n, alignof(T)));
+  }
+
+  /// Copies 'n' chars into the arena, returning a pointer to the copy
+  const char *copy(const char *data, size_t n) {
+    if (n == 0)
+      return nullptr;
+    char *result = allocateArray<char>(n);
+    std::memcpy(result, data, n);
+    return result;
+  }
+
+  /// Frees all the memory we've handed out, in one go
+  void release() {
+    blocks.clear();
+    current = end = nullptr;
+    allocated = 0;
+  }
+
+  /// Number of bytes handed out since construction (or the last release())
+  size_t bytesAllocated() const { return allocated; }
+
+  /// Number of blocks that we've had to get from the global allocator
+  size_t blockCount() const { return blocks.size(); }
+
+private:
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char *current = nullptr;
+  char *end = nullptr;
+  size_t nextBlockSize;
+  size_t allocated = 0;
+
+  static char *align(char *p, size_t alignment) {
+    auto address = reinterpret_cast<std::uintptr_t>(p);
+    address = (address + alignment - 1) & ~(alignment - 1);
+    return reinterpret_cast<char *>(address);
+  }
+
+  /// Gets a new block big enough to hold at least 'minSize' bytes
+  void newBlock(size_t minSize) {
+    size_t size = std::max(nextBlockSize, minSize);
+    blocks.emplace_back(new char[size]);
+    current = blocks.back().get();
+    end = current + size;
+    nextBlockSize = std::min(nextBlockSize * 2, size_t(maxBlockSize));
+  }
+};
+
+/**
+ * @brief A standard allocator that gets its memory from an Arena
+ *
+ * deallocate() does nothing; the memory comes back when the Arena is
+ * destroyed. Copies (and rebound copies) share the same Arena.
+ */
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator(Arena &arena) noexcept : _arena(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+      : _arena(&other.arena()) {}
+
+  T *allocate(size_t n) { return _arena->allocateArray<T>(n); }
+  void deallocate(T *, size_t) noexcept {}
+
+  Arena &arena() const { return *_arena; }
+
+  template <typename U> bool operator==(const ArenaAllocator<U> &other) const {
+    return _arena == &other.arena();
+  }
+  template <typename U> bool operator!=(const ArenaAllocator<U> &other) const {
+    return _arena != &other.arena();
+  }
+
+private:
+  Arena *_arena;
+};
+
+} // namespace json
@@ -0,0 +1,74 @@
+/// A tiny timing harness for the benchmarks. Build them with
+/// -DBUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release.
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace json {
+namespace bench {
+
+/// Stops the compiler from throwing away a result that we never use
+template <typename T> inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const T *sink;
+  sink = &value;
+#endif
+}
+
+/// What one benchmark run measured
+struct Result {
+  double nsPerRun;
+  double bytesPerSecond;
+};
+
+/**
+ * @brief Runs 'f' over and over for about 'seconds' and prints how long it took
+ *
+ * @param name What to call it in the output
+ * @param bytes How many bytes 'f' processes each run, for the throughput
+ *              column; 0 if it doesn't make sense
+ * @param f The code to time
+ * @param seconds Roughly how long to keep running it for
+ */
+template <typename F>
+Result measure(const std::string &name, size_t bytes, F f,
+               double seconds = 0.5) {
+  using Clock = std::chrono::steady_clock;
+  f(); // Warm up the caches
+  size_t runs = 0;
+  auto start = Clock::now();
+  auto elapsed = std::chrono::duration<double>(0);
+  do {
+    f();
+    ++runs;
+    elapsed = Clock::now() - start;
+  } while (elapsed.count() < seconds);
+  Result result;
+  result.nsPerRun = elapsed.count() * 1e9 / runs;
+  result.bytesPerSecond = bytes * runs / elapsed.count();
+  if (bytes)
+    std::printf("%-45s %12.1f ns/run %10.1f MB/s\n", name.c_str(),
+                result.nsPerRun, result.bytesPerSecond / 1e6);
+  else
+    std::printf("%-45s %12.1f ns/run\n", name.c_str(), result.nsPerRun);
+  return result;
+}
+
+/// Reads a whole file into a string
+inline std::string loadFile(const std::string &path) {
+  std::ifstream file(path);
+  if (!file)
+    throw std::runtime_error("Couldn't open " + path);
+  return std::string(std::istreambuf_iterator<char>(file.rdbuf()),
+                     std::istreambuf_iterator<char>());
+}
+
+} // namespace bench
+} // namespace json
@@ -0,0 +1,144 @@
+/// Counts the allocations (and times) for building and freeing DOMs of
+/// sample.json, and times reading it with no DOM at all, or just one field
+
+#include "bench.hpp"
+
+#include "../parse_to_json_class.hpp"
+#include "../parse_to_json_view.hpp"
+#include "../parse_to_struct.hpp"
+#include "../parser/cursor.hpp"
+#include "../parser/sax.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+/// Just the parts of sample.json that the struct benchmark wants
+struct Tenant {
+  BOOST_HANA_DEFINE_STRUCT(Tenant, (std::string, name), (std::string, id));
+};
+struct AuthToken {
+  BOOST_HANA_DEFINE_STRUCT(AuthToken, (Tenant, tenant),
+                           (std::string, expires), (std::string, id));
+};
+struct Access {
+  BOOST_HANA_DEFINE_STRUCT(Access, (AuthToken, token));
+};
+struct Sample {
+  BOOST_HANA_DEFINE_STRUCT(Sample, (Access, access));
+};
+
+// Count every trip to the global allocator
+static size_t allocations = 0;
+static size_t frees = 0;
+
+void *operator new(size_t size) {
+  ++allocations;
+  if (void *result = std::malloc(size ? size : 1))
+    return result;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+  if (p)
+    ++frees;
+  std::free(p);
+}
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+using namespace json;
+
+/// Counts values and string bytes; the least a SAX consumer could do
+struct Counter : SAXHandler {
+  size_t values = 0;
+  size_t stringBytes = 0;
+  void onNull() { ++values; }
+  void onBoolean(bool) { ++values; }
+  void onNumber(const NumberValue &) { ++values; }
+  void onString(const SAXString &s) {
+    ++values;
+    stringBytes += s.size();
+  }
+  void onStartObject() { ++values; }
+  void onStartArray() { ++values; }
+};
+
+/// Builds a document with 'make', then reports how many global allocations
+/// building it took, and how many frees and how long destroying it took
+template <typename F> void report(const char *name, F make) {
+  using Clock = std::chrono::steady_clock;
+  const int runs = 200;
+  size_t allocated = 0, freed = 0;
+  std::chrono::duration<double> destroying(0);
+  for (int i = 0; i < runs; ++i) {
+    size_t before = allocations;
+    auto doc = std::make_unique<decltype(make())>(make());
+    allocated += allocations - before;
+    before = frees;
+    auto start = Clock::now();
+    doc.reset();
+    destroying += Clock::now() - start;
+    freed += frees - before;
+  }
+  std::printf("%-30s %8zu allocations %8zu frees %10.1f ns to free\n", name,
+              allocated / runs, freed / runs,
+              destroying.count() * 1e9 / runs);
+}
+
+int main(int argc, char **argv) {
+  std::string json = bench::loadFile(argc > 1 ? argv[1] : "sample.json");
+  const char *begin = json.data();
+  const char *end = begin + json.size();
+
+  auto parseJSON = [&]() { return readValue(begin, end); };
+  auto parseArena = [&]() { return readArenaValue(begin, end); };
+  auto parseView = [&]() { return readDocument(begin, end); };
+
+  // The parser itself allocates too; JDocument keeps its tree in an arena, so
+  // its count is roughly the parser's share
+  std::printf("Building and freeing one document:\n");
+  report("JSON", parseJSON);
+  report("ArenaJSON", parseArena);
+  report("JDocument (borrowed)", parseView);
+
+  bench::measure("readValue -> JSON", json.size(),
+                 [&]() { bench::doNotOptimize(parseJSON()); });
+  bench::measure("readArenaValue -> ArenaJSON", json.size(),
+                 [&]() { bench::doNotOptimize(parseArena()); });
+  bench::measure("readDocument -> JDocument", json.size(),
+                 [&]() { bench::doNotOptimize(parseView()); });
+  bench::measure("readSAX (no tree at all)", json.size(), [&]() {
+    Counter counter;
+    readSAX(begin, end, counter);
+    bench::doNotOptimize(counter.values);
+  });
+  // The same, with errors returned rather than thrown
+  bench::measure("tryReadValue -> JSON", json.size(), [&]() {
+    bench::doNotOptimize(tryReadValue(begin, end).value);
+  });
+  bench::measure("tryReadSAX", json.size(), [&]() {
+    Counter counter;
+    bench::doNotOptimize(tryReadSAX(begin, end, counter).error);
+    bench::doNotOptimize(counter.values);
+  });
+
+  // Just the token id, which comes after the big service catalog
+  std::printf("\nReading only access.token.id:\n");
+  bench::measure("readValue, then look it up", json.size(), [&]() {
+    JSON doc = parseJSON();
+    bench::doNotOptimize(std::string(doc["access"]["token"]["id"]));
+  });
+  bench::measure("Cursor", json.size(), [&]() {
+    auto status = make_status(begin, end);
+    auto cursor = makeCursor(status);
+    std::string id;
+    if (cursor.enterObject().find("access") &&
+        cursor.enterObject().find("token") && cursor.enterObject().find("id"))
+      id = cursor.readString();
+    bench::doNotOptimize(id);
+  });
+  bench::measure("readStruct", json.size(), [&]() {
+    bench::doNotOptimize(readStruct<Sample>(begin, end).access.token.id);
+  });
+  return 0;
+}
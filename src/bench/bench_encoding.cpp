@@ -0,0 +1,49 @@
+/// Times reading utf-16 json with readValue, which converts it a block at a
+/// time, against converting all of it to utf-8 first and against plain utf-8
+
+#include "bench.hpp"
+
+#include "../parse_to_json_class.hpp"
+
+using namespace json;
+
+int main() {
+  const std::string sample = bench::loadFile("sample.json");
+  std::string json = "[";
+  while (json.size() < (10 << 20))
+    json += sample + ",\n";
+  json += "null]";
+  std::u16string utf16(wideSize<char16_t>(json.data(), json.data() + json.size()),
+                       u'\0');
+  utf8ToWide(json.data(), json.data() + json.size(), &utf16[0]);
+  // As it would come off the wire
+  const std::string bytes(reinterpret_cast<const char *>(utf16.data()),
+                          utf16.size() * 2);
+  std::printf("%zu bytes of utf-8, %zu of utf-16\n", json.size(), bytes.size());
+
+  bench::measure("readValue, utf-8", json.size(), [&]() {
+    bench::doNotOptimize(readValue(json.cbegin(), json.cend()));
+  });
+  bench::measure("readValue, utf-16le bytes", json.size(), [&]() {
+    bench::doNotOptimize(readValue(bytes.cbegin(), bytes.cend()));
+  });
+  bench::measure("readValue, char16_t", json.size(), [&]() {
+    bench::doNotOptimize(readValue(utf16.data(), utf16.data() + utf16.size()));
+  });
+  bench::measure("convert it all to utf-8, then readValue", json.size(), [&]() {
+    const char16_t *p = utf16.data();
+    const char16_t *pe = p + utf16.size();
+    std::string converted(utf8Size(p, pe), '\0');
+    wideToUTF8(p, pe, &converted[0]);
+    bench::doNotOptimize(readValue(converted.cbegin(), converted.cend()));
+  });
+  bench::measure("UTF8Blocks alone", json.size(), [&]() {
+    UTF8Blocks blocks(bytes.data(), bytes.data() + bytes.size(),
+                      Encoding::utf16LE);
+    size_t total = 0;
+    while (blocks.next())
+      total += blocks.size();
+    bench::doNotOptimize(total);
+  });
+  return 0;
+}
@@ -0,0 +1,98 @@
+/// Times reading big json files: mapped with readFile/MappedFile, against
+/// loading them into a std::string through an istreambuf_iterator first. The
+/// files are made up from copies of sample.json and are in the page cache, so
+/// this is the cost of getting the bytes to the parser, not of the disk.
+
+#include "bench.hpp"
+
+#include "../mapped_file.hpp"
+#include "../parser/sax.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace json;
+
+/// Counts the values, so there's something for the parser to do
+struct Counter : SAXHandler {
+  size_t values = 0;
+  void onNull() { ++values; }
+  void onBoolean(bool) { ++values; }
+  void onNumber(const NumberValue &) { ++values; }
+  void onString(const SAXString &) { ++values; }
+  void onStartObject() { ++values; }
+  void onStartArray() { ++values; }
+};
+
+/// Writes an array of copies of 'sample' to 'path', about 'size' bytes long
+void makeFile(const std::string &path, const std::string &sample,
+              size_t size) {
+  std::ofstream file(path, std::ios::binary);
+  file << '[';
+  for (size_t written = 1; written < size; written += sample.size() + 1) {
+    if (written > 1)
+      file << ',';
+    file << sample;
+  }
+  file << ']';
+}
+
+/// How the tests and services load files now
+std::string load(const std::string &path) {
+  std::ifstream file(path);
+  return std::string(std::istreambuf_iterator<char>(file.rdbuf()),
+                     std::istreambuf_iterator<char>());
+}
+
+/// Times loading and parsing a file of 'megabytes' MB, with and without a tree
+void run(const std::string &sample, size_t megabytes, bool buildTree) {
+  const std::string path = "bench_file.json";
+  makeFile(path, sample, megabytes << 20);
+  const size_t bytes = MappedFile(path).size();
+  std::printf("\n%zu MB file\n", megabytes);
+
+  bench::measure("  load into a string", bytes,
+                 [&]() { bench::doNotOptimize(load(path).size()); }, 2);
+  bench::measure("  map and touch every page", bytes, [&]() {
+    MappedFile file(path);
+    size_t sum = 0;
+    for (size_t i = 0; i < file.size(); i += 4096)
+      sum += file.data()[i];
+    bench::doNotOptimize(sum);
+  }, 2);
+  bench::measure("  load, then readSAX", bytes, [&]() {
+    std::string json = load(path);
+    Counter counter;
+    readSAX(json.data(), json.data() + json.size(), counter);
+    bench::doNotOptimize(counter.values);
+  }, 2);
+  bench::measure("  MappedFile, then readSAX", bytes, [&]() {
+    MappedFile file(path);
+    Counter counter;
+    readSAX(file.begin(), file.end(), counter);
+    bench::doNotOptimize(counter.values);
+  }, 2);
+  if (buildTree) {
+    bench::measure("  load, then readValue", bytes, [&]() {
+      std::string json = load(path);
+      bench::doNotOptimize(readValue(json.begin(), json.end()));
+    }, 2);
+    bench::measure("  readFile", bytes,
+                   [&]() { bench::doNotOptimize(readFile(path)); }, 2);
+  }
+  std::remove(path.c_str());
+}
+
+int main(int argc, char **argv) {
+  // The big file size in MB
+  const size_t megabytes = argc > 1 ? std::atoi(argv[1]) : 300;
+  const std::string sample = bench::loadFile("sample.json");
+  // JSON trees take several times the file size in memory, so keep that one
+  // smaller
+  run(sample, 30, true);
+  run(sample, megabytes, false);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/// Times reading floating point numbers: our parser against strtod, and
+/// against the old multiply-by-ten-per-exponent-step conversion
+
+#include "bench.hpp"
+
+#include "../parser/number.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace json;
+
+/// How json_num2cpp_num used to turn the parts of a number into a double
+double legacyConversion(bool isNeg, unsigned long long intPart, int expPart) {
+  double result = intPart;
+  if (expPart < 0)
+    while (expPart++ < 0)
+      result *= 0.1;
+  else
+    while (expPart-- > 0)
+      result *= 10;
+  return isNeg ? -result : result;
+}
+
+/// Splits a number into the parts that legacyConversion wants, without
+/// converting it
+struct Parts {
+  bool isNeg;
+  unsigned long long intPart;
+  int expPart;
+};
+
+Parts split(const std::string &number) {
+  Parts result{false, 0, 0};
+  const char *p = number.c_str();
+  if (*p == '-') {
+    result.isNeg = true;
+    ++p;
+  }
+  bool afterDot = false;
+  for (; *p && *p != 'e'; ++p) {
+    if (*p == '.') {
+      afterDot = true;
+      continue;
+    }
+    if (result.intPart < 1000000000000000000ull) {
+      result.intPart = result.intPart * 10 + (*p - '0');
+      if (afterDot)
+        --result.expPart;
+    } else if (!afterDot)
+      ++result.expPart;
+  }
+  if (*p == 'e')
+    result.expPart += std::atoi(p + 1);
+  return result;
+}
+
+/// Times converting every number in 'numbers' each way
+void run(const char *name, const std::vector<std::string> &numbers) {
+  size_t bytes = 0;
+  for (const std::string &number : numbers)
+    bytes += number.size();
+  std::vector<Parts> parts;
+  for (const std::string &number : numbers)
+    parts.push_back(split(number));
+
+  std::printf("%s\n", name);
+  bench::measure("  readNumber<double>", bytes, [&]() {
+    for (const std::string &number : numbers) {
+      auto status = make_status(number.cbegin(), number.cend());
+      bench::doNotOptimize(readNumber<double>(status));
+    }
+  });
+  bench::measure("  strtod", bytes, [&]() {
+    for (const std::string &number : numbers)
+      bench::doNotOptimize(std::strtod(number.c_str(), nullptr));
+  });
+  bench::measure("  old conversion loop (parts already split)", bytes, [&]() {
+    for (const Parts &number : parts)
+      bench::doNotOptimize(
+          legacyConversion(number.isNeg, number.intPart, number.expPart));
+  });
+  size_t wrong = 0;
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    double legacy =
+        legacyConversion(parts[i].isNeg, parts[i].intPart, parts[i].expPart);
+    if (legacy != std::strtod(numbers[i].c_str(), nullptr))
+      ++wrong;
+  }
+  std::printf("  the old conversion got %zu of %zu wrong\n\n", wrong,
+              numbers.size());
+}
+
+int main() {
+  std::mt19937_64 random(42);
+  char buffer[64];
+  const int count = 100000;
+
+  std::vector<std::string> shortest, prices, huge;
+  for (int i = 0; i < count; ++i) {
+    uint64_t bits = random() & 0x7FEFFFFFFFFFFFFFull;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    shortest.push_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "%.2f", (random() % 1000000) / 100.0);
+    prices.push_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "%.6e",
+                  (random() % 1000000) * 1e-6 * (i % 2 ? 1e-200 : 1e200));
+    huge.push_back(buffer);
+  }
+  run("Random doubles, 17 digits", shortest);
+  run("Prices like 1234.56", prices);
+  run("Big exponents like 1.234567e-200", huge);
+}
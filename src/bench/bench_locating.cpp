@@ -0,0 +1,57 @@
+/// Times parsing through a LocatingIterator against the plain iterator, and
+/// how long it takes to find where an error is
+
+#include "bench.hpp"
+
+#include "../parser/LocatingIterator.hpp"
+#include "../parser/sax.hpp"
+
+#include <list>
+
+using namespace json;
+
+/// Counts the events, so the parse can't be optimized away
+struct Counter : SAXHandler {
+  size_t events = 0;
+  void onNull() { ++events; }
+  void onBoolean(bool) { ++events; }
+  void onNumber(const NumberValue &) { ++events; }
+  void onString(const SAXString &) { ++events; }
+  void onKey(const SAXString &) { ++events; }
+};
+
+int main() {
+  const std::string sample = bench::loadFile("sample.json");
+  std::string json = "[";
+  while (json.size() < (10 << 20))
+    json += sample + ",\n";
+  json += "null]";
+  std::printf("%zu bytes\n", json.size());
+
+  auto parse = [&](auto begin, auto end) {
+    Counter counter;
+    auto status = make_status(begin, end);
+    readSAX(status, counter);
+    bench::doNotOptimize(counter.events);
+  };
+
+  bench::measure("readSAX, string iterator", json.size(),
+                 [&]() { parse(json.cbegin(), json.cend()); });
+  bench::measure("readSAX, LocatingIterator<string iterator>", json.size(),
+                 [&]() {
+                   parse(makeLocating(json.cbegin()), makeLocating(json.cend()));
+                 });
+  std::list<char> list(json.begin(), json.end());
+  bench::measure("readSAX, std::list iterator", json.size(),
+                 [&]() { parse(list.cbegin(), list.cend()); });
+  bench::measure("readSAX, LocatingIterator<std::list iterator>", json.size(),
+                 [&]() {
+                   parse(makeLocating(list.cbegin()), makeLocating(list.cend()));
+                 });
+
+  // What we pay for an error at the very end
+  auto last = makeLocating(json.cbegin()) + (json.size() - 1);
+  bench::measure("location() of the last char", json.size(),
+                 [&]() { bench::doNotOptimize(last.location()); });
+  return 0;
+}
@@ -0,0 +1,95 @@
+/// Measures how much memory JSON DOMs of big arrays take
+
+#include "bench.hpp"
+
+#include "../parse_to_json_class.hpp"
+
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+// Count the bytes we've got from the global allocator and not given back.
+// Each block is prefixed with its size, so that we know how much a free gives
+// back.
+static size_t bytesInUse = 0;
+static const size_t header = alignof(std::max_align_t);
+
+void *operator new(size_t size) {
+  char *result = static_cast<char *>(std::malloc(size + header));
+  if (!result)
+    throw std::bad_alloc();
+  *reinterpret_cast<size_t *>(result) = size;
+  bytesInUse += size;
+  return result + header;
+}
+void operator delete(void *p) noexcept {
+  if (!p)
+    return;
+  char *block = static_cast<char *>(p) - header;
+  bytesInUse -= *reinterpret_cast<size_t *>(block);
+  std::free(block);
+}
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+using namespace json;
+
+/// The layout JSON nodes used to have: a Type enum next to a union holding a
+/// std::string, long double, std::map or std::vector
+struct LegacyNode {
+  enum Type { null, boolean, number, text, map, list } type;
+  union Value {
+    std::string as_string;
+    long double as_num;
+    bool as_bool;
+    std::map<std::string, int> as_map;
+    std::vector<int> as_list;
+    Value() {}
+    ~Value() {}
+  } value;
+};
+
+/// Makes a json array with 'count' elements, using 'element(i)' for each one
+template <typename F> std::string makeArray(size_t count, F element) {
+  std::string result = "[";
+  for (size_t i = 0; i < count; ++i) {
+    if (i)
+      result += ',';
+    result += element(i);
+  }
+  result += ']';
+  return result;
+}
+
+/// Parses 'json' and prints how many bytes the DOM holds on to
+void report(const char *name, const std::string &json, size_t count) {
+  const char *begin = json.data();
+  const char *end = begin + json.size();
+  size_t before = bytesInUse;
+  JSON dom = readValue(begin, end);
+  size_t used = bytesInUse - before;
+  bench::doNotOptimize(dom);
+  std::printf("%-35s %12zu bytes in use %8.1f bytes/element\n", name, used,
+              double(used) / count);
+  bench::measure(std::string("  parse ") + name, json.size(),
+                 [&]() { bench::doNotOptimize(readValue(begin, end)); });
+}
+
+int main() {
+  std::printf("sizeof(JSON) = %zu bytes (the old layout was %zu)\n\n",
+              sizeof(JSON), sizeof(LegacyNode));
+  const size_t count = 1000000;
+  report("1M integers",
+         makeArray(count, [](size_t i) { return std::to_string(i); }), count);
+  report("1M doubles", makeArray(count, [](size_t i) {
+           return std::to_string(i) + ".25";
+         }), count);
+  report("1M short strings", makeArray(count, [](size_t i) {
+           return "\"item " + std::to_string(i) + "\"";
+         }), count);
+  report("100k small objects", makeArray(count / 10, [](size_t i) {
+           return R"({"id":)" + std::to_string(i) + R"(,"name":"item )" +
+                  std::to_string(i) + R"(","ok":true})";
+         }), count / 10);
+}
@@ -0,0 +1,66 @@
+/// Times the PushParser fed in network sized chunks, against buffering the
+/// whole document and then running readSAX, and shows how much of the input
+/// each one needs before it can send the first event.
+
+#include "bench.hpp"
+
+#include "../parser/push.hpp"
+#include "../parser/sax.hpp"
+
+#include <algorithm>
+#include <string>
+
+using namespace json;
+
+/// Counts the values; remembers when it saw the first one
+struct Counter : SAXHandler {
+  size_t values = 0;
+  void onNull() { ++values; }
+  void onBoolean(bool) { ++values; }
+  void onNumber(const NumberValue &) { ++values; }
+  void onString(const SAXString &) { ++values; }
+  void onStartObject() { ++values; }
+  void onStartArray() { ++values; }
+};
+
+int main(int argc, char **argv) {
+  const std::string sample = bench::loadFile(argc > 1 ? argv[1] : "sample.json");
+  // About 10 MB: an array of copies of the sample
+  std::string json = "[";
+  while (json.size() < (10 << 20))
+    json += sample + ',';
+  json.back() = ']';
+  std::printf("%zu bytes\n", json.size());
+
+  bench::measure("buffer every chunk, then readSAX", json.size(), [&]() {
+    std::string buffer;
+    for (size_t p = 0; p < json.size(); p += 1460)
+      buffer.append(json, p, 1460);
+    Counter counter;
+    readSAX(buffer.data(), buffer.data() + buffer.size(), counter);
+    bench::doNotOptimize(counter.values);
+  });
+  for (size_t chunk : {1460, 16384, 65536}) {
+    bench::measure("PushParser, " + std::to_string(chunk) + " byte chunks",
+                   json.size(), [&]() {
+                     Counter counter;
+                     PushParser<Counter> parser(counter);
+                     for (size_t p = 0; p < json.size(); p += chunk)
+                       parser.feed(json.data() + p,
+                                   std::min(chunk, json.size() - p));
+                     parser.finish();
+                     bench::doNotOptimize(counter.values);
+                   });
+  }
+
+  // How far into the input the first event comes
+  Counter counter;
+  PushParser<Counter> parser(counter);
+  size_t fed = 0;
+  while (!counter.values)
+    parser.feed(json.data() + fed++, 1);
+  std::printf("first event after %zu bytes with the PushParser, %zu bytes "
+              "when buffering\n",
+              fed, json.size());
+  return 0;
+}
@@ -0,0 +1,281 @@
+/// Times writing numbers: the json writer against streams and printf. Then
+/// times writing all of sample.json through a sink against the old way, which
+/// streamed everything through a std::ostream a piece at a time, escaping
+/// strings a block at a time against a char at a time, and writing hana structs
+/// directly against building a JMap for them first.
+
+#include "bench.hpp"
+
+#include "../json_class.hpp"
+#include "../parse_to_json_class.hpp"
+#include "../writer/number.hpp"
+#include "../writer/struct.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace json;
+
+/// How operator<< used to write a JSON: every piece a separate call on the
+/// ostream. (Strings are copied out here as they're private; most are short
+/// enough not to allocate.)
+void legacyWrite(std::ostream &s, const JSON &j) {
+  switch (j.whatIs()) {
+  case JSON::null: s << "null"; break;
+  case JSON::boolean: s << (bool(j) ? "true" : "false"); break;
+  case JSON::number: {
+    char buffer[maxNumberChars];
+    char *end = j.isInteger() ? writeInteger(static_cast<int64_t>(j), buffer)
+                              : writeDouble(static_cast<double>(j), buffer);
+    s.write(buffer, end - buffer);
+    break;
+  }
+  case JSON::text: {
+    const std::string text = j;
+    s << '"';
+    s.write(text.data(), text.size());
+    s << '"';
+    break;
+  }
+  case JSON::map: {
+    const JMap &map = j;
+    s << '{';
+    bool first = true;
+    for (const auto &entry : map) {
+      if (!first)
+        s << ',';
+      first = false;
+      s << '"' << entry.first << R"(":)";
+      legacyWrite(s, entry.second);
+    }
+    s << '}';
+    break;
+  }
+  case JSON::list: {
+    const JList &list = j;
+    s << '[';
+    bool first = true;
+    for (const JSON &item : list) {
+      if (!first)
+        s << ',';
+      first = false;
+      legacyWrite(s, item);
+    }
+    s << ']';
+    break;
+  }
+  }
+}
+
+/// Escapes a string a char at a time, to compare writeString against
+void escapeSlowly(std::string &out, const std::string &text) {
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        out += buffer;
+      } else
+        out += c;
+    }
+  }
+  out += '"';
+}
+
+void strings() {
+  std::mt19937 random(7);
+  std::string clean(1 << 20, 'x'), someEscapes, nonASCII;
+  for (char &c : clean)
+    c = static_cast<char>('a' + random() % 26);
+  someEscapes = clean;
+  for (size_t i = 0; i < someEscapes.size(); i += 100)
+    someEscapes[i] = '\n';
+  for (size_t i = 0; i < clean.size(); i += 50)
+    nonASCII += clean.substr(i, 48) + u8"\u00e9";
+
+  std::string out;
+  out.reserve(8 << 20);
+  std::printf("\nWriting 1MB strings\n");
+  for (auto &input : {std::make_pair("clean", &clean),
+                      std::make_pair("a newline every 100 chars", &someEscapes),
+                      std::make_pair("non ASCII every 50 chars", &nonASCII)}) {
+    const std::string &text = *input.second;
+    std::printf(" %s\n", input.first);
+    bench::measure("  char at a time", text.size(), [&]() {
+      out.clear();
+      escapeSlowly(out, text);
+      bench::doNotOptimize(out);
+    });
+    bench::measure("  writeString", text.size(), [&]() {
+      out.clear();
+      StringSink<> sink(out);
+      writeString(sink, text.data(), text.size());
+      bench::doNotOptimize(out);
+    });
+    bench::measure("  writeString, Escape::nonASCII", text.size(), [&]() {
+      out.clear();
+      StringSink<> sink(out);
+      writeString(sink, text.data(), text.size(), Escape::nonASCII);
+      bench::doNotOptimize(out);
+    });
+  }
+}
+
+/// Like the endpoints in sample.json
+struct Endpoint {
+  BOOST_HANA_DEFINE_STRUCT(Endpoint,
+    (std::string, publicURL),
+    (std::string, tenantId),
+    (std::string, region),
+    (int, version),
+    (bool, enabled));
+};
+
+void structs() {
+  std::vector<Endpoint> endpoints;
+  for (int i = 0; i < 1000; ++i)
+    endpoints.push_back(
+        {"https://syd.blockstorage.api.rackspacecloud.com/v1/" +
+             std::to_string(641237 + i),
+         std::to_string(641237 + i), i % 2 ? "SYD" : "ORD", i, i % 3 != 0});
+  const size_t bytes = writeToString(endpoints).size();
+
+  // How we'd have done it before: copy everything into a JSON tree
+  auto toJSON = [&]() {
+    JList list;
+    for (const Endpoint &e : endpoints)
+      list.push_back(JMap{{"publicURL", e.publicURL},
+                          {"tenantId", e.tenantId},
+                          {"region", e.region},
+                          {"version", e.version},
+                          {"enabled", JBool(e.enabled)}});
+    return JSON(std::move(list));
+  };
+
+  std::printf("\n1000 structs (%zu bytes written)\n", bytes);
+  bench::measure("  build a JSON, then ostream <<", bytes, [&]() {
+    std::ostringstream out;
+    out << toJSON();
+    bench::doNotOptimize(out);
+  });
+  bench::measure("  build a JSON, then toString", bytes,
+                 [&]() { bench::doNotOptimize(toJSON().toString()); });
+  bench::measure("  writeToString", bytes,
+                 [&]() { bench::doNotOptimize(writeToString(endpoints)); });
+  std::string reused;
+  bench::measure("  writeValue to a reused string", bytes, [&]() {
+    reused.clear();
+    StringSink<> out(reused);
+    writeValue(out, endpoints);
+    bench::doNotOptimize(reused);
+  });
+}
+
+void document(const char *path) {
+  std::string json = bench::loadFile(path);
+  const char *begin = json.data();
+  JSON doc = readValue(begin, begin + json.size());
+  const size_t bytes = doc.toString().size();
+
+  std::printf("\n%s (%zu bytes written)\n", path, bytes);
+  bench::measure("  old ostream << then stringstream::str", bytes, [&]() {
+    std::stringstream out;
+    legacyWrite(out, doc);
+    bench::doNotOptimize(out.str());
+  });
+  bench::measure("  JSON::toString", bytes,
+                 [&]() { bench::doNotOptimize(doc.toString()); });
+  std::string reused;
+  bench::measure("  writeTo a reused string", bytes, [&]() {
+    reused.clear();
+    StringSink<> out(reused);
+    doc.writeTo(out);
+    bench::doNotOptimize(reused);
+  });
+  bench::measure("  ostream << (through a StreamSink)", bytes, [&]() {
+    std::ostringstream out;
+    out << doc;
+    bench::doNotOptimize(out);
+  });
+}
+
+int main(int argc, char **argv) {
+  std::mt19937_64 random(42);
+  const int count = 1000000;
+  std::vector<double> doubles;
+  std::vector<int64_t> integers;
+  JList doubleList, integerList;
+  for (int i = 0; i < count; ++i) {
+    uint64_t bits = random() & 0x7FEFFFFFFFFFFFFFull;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    doubles.push_back(value);
+    doubleList.push_back(value);
+    int64_t integer = static_cast<int64_t>(random()) >> (random() % 64);
+    integers.push_back(integer);
+    integerList.push_back(integer);
+  }
+  JSON doubleJSON(std::move(doubleList)), integerJSON(std::move(integerList));
+
+  std::string text;
+  text.reserve(count * maxNumberChars);
+  char buffer[64];
+
+  std::printf("1M random doubles\n");
+  bench::measure("  writeDouble", 0, [&]() {
+    text.clear();
+    for (double value : doubles) {
+      char *end = writeDouble(value, buffer);
+      text.append(buffer, end);
+    }
+  });
+  bench::measure("  snprintf %.17g (round trips, not shortest)", 0, [&]() {
+    text.clear();
+    for (double value : doubles)
+      text.append(buffer, std::snprintf(buffer, sizeof(buffer), "%.17g", value));
+  });
+  bench::measure("  ostream << long double (the old way, lossy)", 0, [&]() {
+    std::ostringstream out;
+    for (double value : doubles)
+      out << static_cast<long double>(value) << ',';
+    bench::doNotOptimize(out);
+  });
+  bench::measure("  JSON::toString of the list", 0,
+                 [&]() { bench::doNotOptimize(doubleJSON.toString()); });
+
+  std::printf("1M random integers\n");
+  bench::measure("  writeInteger", 0, [&]() {
+    text.clear();
+    for (int64_t value : integers) {
+      char *end = writeInteger(value, buffer);
+      text.append(buffer, end);
+    }
+  });
+  bench::measure("  snprintf %lld", 0, [&]() {
+    text.clear();
+    for (int64_t value : integers)
+      text.append(buffer, std::snprintf(buffer, sizeof(buffer), "%lld",
+                                        static_cast<long long>(value)));
+  });
+  bench::measure("  ostream << long double (the old way, lossy)", 0, [&]() {
+    std::ostringstream out;
+    for (int64_t value : integers)
+      out << static_cast<long double>(value) << ',';
+    bench::doNotOptimize(out);
+  });
+  bench::measure("  JSON::toString of the list", 0,
+                 [&]() { bench::doNotOptimize(integerJSON.toString()); });
+
+  strings();
+  structs();
+  document(argc > 1 ? argv[1] : "sample.json");
+}
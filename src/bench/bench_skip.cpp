@@ -0,0 +1,57 @@
+/// Times skipping a big unwanted member, against plain memory bandwidth
+
+#include "bench.hpp"
+
+#include "../parser/cursor.hpp"
+#include "../parser/skip.hpp"
+
+#include <cstring>
+#include <list>
+#include <vector>
+
+using namespace json;
+
+/// About 'size' bytes of json: {"skipped": [...], "wanted": 42}. The array
+/// holds small objects with nested arrays and strings full of brackets.
+std::string makeDocument(size_t size) {
+  std::string result = R"({"skipped": [)";
+  for (size_t i = 0; result.size() < size; ++i) {
+    if (i)
+      result += ", ";
+    result += R"({"id": )" + std::to_string(i) +
+              R"(, "tags": ["a", "b]", "c\"}"], "pos": [[1.5, -2], [3, 4e7]],)"
+              R"( "note": "some text that isn't json: {[}]", "ok": true})";
+  }
+  return result + R"(], "wanted": 42})";
+}
+
+int main() {
+  const std::string json = makeDocument(10 << 20);
+  std::printf("%zu bytes\n", json.size());
+
+  auto findWanted = [&](auto begin, auto end) {
+    auto status = make_status(begin, end);
+    auto cursor = makeCursor(status);
+    auto root = cursor.enterObject();
+    root.find("wanted");
+    bench::doNotOptimize(cursor.template readNumber<int>());
+  };
+
+  // What it costs just to read every byte once
+  std::vector<char> copy(json.size());
+  bench::measure("memcpy", json.size(), [&]() {
+    std::memcpy(copy.data(), json.data(), json.size());
+    bench::doNotOptimize(copy.data());
+  });
+  bench::measure("memchr (not found)", json.size(), [&]() {
+    bench::doNotOptimize(std::memchr(json.data(), '\x01', json.size()));
+  });
+
+  bench::measure("Cursor find, contiguous (SIMD skip)", json.size(), [&]() {
+    findWanted(json.data(), json.data() + json.size());
+  });
+  std::list<char> list(json.begin(), json.end());
+  bench::measure("Cursor find, std::list (char at a time)", json.size(),
+                 [&]() { findWanted(list.cbegin(), list.cend()); });
+  return 0;
+}
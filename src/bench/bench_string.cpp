@@ -0,0 +1,74 @@
+/// Times string decoding on the strings in sample.json
+
+#include "bench.hpp"
+
+#include "../parser/number.hpp"
+#include "../parser/outer.hpp"
+#include "../parser/status.hpp"
+#include "../parser/string.hpp"
+
+#include <vector>
+
+using namespace json;
+
+/// Returns the offset of every string in the document, just after its '"'
+std::vector<size_t> findStrings(const std::string &json) {
+  std::vector<size_t> result;
+  auto status = make_status(json.cbegin(), json.cend());
+  while (true) {
+    switch (getNextOuterToken(status)) {
+    case string:
+      result.push_back(status.p - json.cbegin());
+      decodeString(status);
+      break;
+    case number:
+      readNumber<double>(status);
+      break;
+    case null:
+      readNull(status);
+      break;
+    case boolean:
+      readBoolean(status);
+      break;
+    case HIT_END:
+    case ERROR:
+      return result;
+    default:
+      break;
+    }
+  }
+}
+
+/// How we used to do it: size the output with one pass, then decode it
+template <typename Status> std::string decodeTwoPass(Status &status) {
+  std::string result;
+  result.reserve(getDecodedStringLength(status));
+  decodeString(status, std::back_inserter(result));
+  return result;
+}
+
+int main(int argc, char **argv) {
+  std::string json = bench::loadFile(argc > 1 ? argv[1] : "sample.json");
+  std::vector<size_t> strings = findStrings(json);
+  size_t bytes = 0;
+  for (size_t offset : strings)
+    bytes += getRawStringLength(
+        make_status(json.cbegin() + offset, json.cend()));
+  std::printf("%zu strings, %zu bytes of string data\n", strings.size(), bytes);
+
+  auto decodeAll = [&](auto decoder) {
+    return [&, decoder]() {
+      for (size_t offset : strings) {
+        auto status = make_status(json.cbegin() + offset, json.cend());
+        bench::doNotOptimize(decoder(status));
+      }
+    };
+  };
+
+  using Status = decltype(make_status(json.cbegin(), json.cend()));
+  bench::measure("decodeString (length pass + decode pass)", bytes,
+                 decodeAll([](Status &s) { return decodeTwoPass(s); }));
+  bench::measure("decodeString (single pass)", bytes,
+                 decodeAll([](Status &s) { return decodeString(s); }));
+  return 0;
+}
@@ -0,0 +1,78 @@
+/// Times the bulk utf-8 checks and conversions against transformFrom8, which
+/// converts a char at a time through iterators
+
+#include "bench.hpp"
+
+#include "../unicode.hpp"
+
+#include <iterator>
+
+using namespace json;
+
+/// Times one kind of text: mostly ASCII, like json, or all non ASCII
+void run(const char *name, const std::string &text) {
+  std::printf("%s: %zu bytes\n", name, text.size());
+  auto report = [](const bench::Result &result) {
+    std::printf("%45s %12.2f GB/s\n", "", result.bytesPerSecond / 1e9);
+  };
+  const char *p = text.data();
+  const char *pe = p + text.size();
+  report(bench::measure("findBadUTF8", text.size(), [&]() {
+    bench::doNotOptimize(findBadUTF8(p, pe));
+  }));
+  report(bench::measure("findBadUTF8, a char at a time", text.size(), [&]() {
+    bench::doNotOptimize(detail::findBadUTF8Scalar(p, pe));
+  }));
+  // Whole conversions, like JSON's std::wstring operator. Making a fresh
+  // string this big costs about as much as filling it, so the kernels are
+  // timed into buffers made up front too.
+  report(bench::measure("transformFrom8 to std::wstring", text.size(), [&]() {
+    std::wstring result;
+    result.reserve(text.size() * 1.10);
+    transformFrom8(p, pe, std::back_inserter(result));
+    bench::doNotOptimize(result.data());
+  }));
+  report(bench::measure("utf8ToWide to std::wstring", text.size(), [&]() {
+    std::wstring result(wideSize<wchar_t>(p, pe), L'\0');
+    utf8ToWide(p, pe, &result[0]);
+    bench::doNotOptimize(result.data());
+  }));
+  std::u16string utf16(wideSize<char16_t>(p, pe), u'\0');
+  std::u32string utf32(wideSize<char32_t>(p, pe), U'\0');
+  std::string utf8(text.size(), '\0');
+  report(bench::measure("wideSize<char16_t>", text.size(), [&]() {
+    bench::doNotOptimize(wideSize<char16_t>(p, pe));
+  }));
+  report(bench::measure("utf8ToWide to utf-16", text.size(), [&]() {
+    bench::doNotOptimize(utf8ToWide(p, pe, &utf16[0]));
+  }));
+  report(bench::measure("utf8ToWide to utf-32", text.size(), [&]() {
+    bench::doNotOptimize(utf8ToWide(p, pe, &utf32[0]));
+  }));
+  const char16_t *from16 = utf16.data();
+  const char16_t *end16 = from16 + utf16.size();
+  const char32_t *from32 = utf32.data();
+  const char32_t *end32 = from32 + utf32.size();
+  report(bench::measure("utf8Size from utf-16", text.size(), [&]() {
+    bench::doNotOptimize(utf8Size(from16, end16));
+  }));
+  report(bench::measure("wideToUTF8 from utf-16", text.size(), [&]() {
+    bench::doNotOptimize(wideToUTF8(from16, end16, &utf8[0]));
+  }));
+  report(bench::measure("wideToUTF8 from utf-32", text.size(), [&]() {
+    bench::doNotOptimize(wideToUTF8(from32, end32, &utf8[0]));
+  }));
+}
+
+int main() {
+  const std::string sample = bench::loadFile("sample.json");
+  std::string json;
+  while (json.size() < (10 << 20))
+    json += sample;
+  run("sample.json", json);
+  std::string text;
+  while (text.size() < (10 << 20))
+    text += u8"日本語の文章 café \U0001F600 ";
+  run("Mixed non ASCII", text);
+  return 0;
+}
@@ -0,0 +1,43 @@
+/// Times validate() against memchr (about as fast as we can read the bytes)
+/// and against readSAX, which has to decode everything it checks
+
+#include "bench.hpp"
+
+#include "../parser/sax.hpp"
+#include "../parser/validate.hpp"
+
+#include <cstring>
+#include <list>
+
+using namespace json;
+
+int main() {
+  const std::string sample = bench::loadFile("sample.json");
+  std::string json = "[";
+  while (json.size() < (10 << 20))
+    json += sample + ",\n";
+  json += "null]";
+  std::printf("%zu bytes\n", json.size());
+
+  auto report = [](const bench::Result &result) {
+    std::printf("%45s %12.2f GB/s\n", "", result.bytesPerSecond / 1e9);
+  };
+
+  report(bench::measure("memchr", json.size(), [&]() {
+    bench::doNotOptimize(std::memchr(json.data(), 0, json.size()));
+  }));
+  report(bench::measure("validate", json.size(), [&]() {
+    auto result = validate(json.data(), json.data() + json.size());
+    bench::doNotOptimize(result.error);
+  }));
+  std::list<char> list(json.begin(), json.end());
+  report(bench::measure("validate, std::list iterator", json.size(), [&]() {
+    auto result = validate(list.cbegin(), list.cend());
+    bench::doNotOptimize(result.error);
+  }));
+  report(bench::measure("readSAX", json.size(), [&]() {
+    SAXHandler handler;
+    readSAX(json.data(), json.data() + json.size(), handler);
+  }));
+  return 0;
+}
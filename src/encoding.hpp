@@ -0,0 +1,234 @@
+/// Works out how json text is encoded, and turns utf-16 and utf-32 text into
+/// utf-8 for the parser a block at a time
+///
+/// RFC 4627 (section 3) says json is utf-8, utf-16 or utf-32, and that the
+/// first two chars are always ASCII, so the nulls in the first four bytes say
+/// which:
+///
+///     00 00 00 xx  UTF-32BE
+///     00 xx 00 xx  UTF-16BE
+///     xx 00 00 00  UTF-32LE
+///     xx 00 xx 00  UTF-16LE
+///     xx xx xx xx  UTF-8
+///
+/// A byte order mark, if there is one, settles it too.
+///
+/// The parser only reads utf-8, so wide text is converted a block at a time
+/// with the bulk converters in unicode.hpp and fed to a PushParser (see
+/// readValue in parse_to_json_class.hpp). There's never more than a block of
+/// converted text around, however big the input is.
+#pragma once
+
+#include "unicode.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace json {
+
+/// The ways json text can be encoded
+enum class Encoding { utf8, utf16BE, utf16LE, utf32BE, utf32LE };
+
+/// How many bytes there are in each code unit
+inline size_t unitSize(Encoding encoding) {
+  switch (encoding) {
+  case Encoding::utf16BE:
+  case Encoding::utf16LE:
+    return 2;
+  case Encoding::utf32BE:
+  case Encoding::utf32LE:
+    return 4;
+  case Encoding::utf8:
+    break;
+  }
+  return 1;
+}
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+constexpr bool bigEndianHost = true;
+#else
+constexpr bool bigEndianHost = false;
+#endif
+
+/// The encoding of text held in 'Unit's (char16_t, char32_t or wchar_t) in
+/// memory
+template <typename Unit> constexpr Encoding nativeEncoding() {
+  static_assert((sizeof(Unit) == 2) || (sizeof(Unit) == 4),
+                "Expected 16 or 32 bit units");
+  return (sizeof(Unit) == 2)
+             ? (bigEndianHost ? Encoding::utf16BE : Encoding::utf16LE)
+             : (bigEndianHost ? Encoding::utf32BE : Encoding::utf32LE);
+}
+
+/**
+ * @brief Works out the encoding of some json from its first four bytes
+ *
+ * @param p The start of the json
+ * @param pe One past the end of the json
+ * @return The encoding; utf8 if it's too short to tell
+ */
+inline Encoding detectEncoding(const char *p, const char *pe) {
+  const size_t size = pe - p;
+  auto byte = [p](size_t i) { return static_cast<unsigned char>(p[i]); };
+  // A byte order mark. FF FE 00 00 could be utf-16 with a null after the mark,
+  // but that's not json anyway.
+  if ((size >= 4) && (byte(0) == 0) && (byte(1) == 0) && (byte(2) == 0xFE) &&
+      (byte(3) == 0xFF))
+    return Encoding::utf32BE;
+  if ((size >= 4) && (byte(0) == 0xFF) && (byte(1) == 0xFE) && (byte(2) == 0) &&
+      (byte(3) == 0))
+    return Encoding::utf32LE;
+  if ((size >= 2) && (byte(0) == 0xFE) && (byte(1) == 0xFF))
+    return Encoding::utf16BE;
+  if ((size >= 2) && (byte(0) == 0xFF) && (byte(1) == 0xFE))
+    return Encoding::utf16LE;
+  // The nulls around the first char
+  if ((size >= 4) && (byte(0) == 0) && (byte(1) == 0) && (byte(2) == 0))
+    return Encoding::utf32BE;
+  if ((size >= 4) && (byte(1) == 0) && (byte(2) == 0) && (byte(3) == 0))
+    return Encoding::utf32LE;
+  if ((size >= 2) && (byte(0) == 0))
+    return Encoding::utf16BE;
+  if ((size >= 2) && (byte(1) == 0))
+    return Encoding::utf16LE;
+  return Encoding::utf8;
+}
+
+/// How many bytes of byte order mark [p, pe) starts with, if it's in
+/// 'encoding'
+inline size_t byteOrderMarkSize(const char *p, const char *pe,
+                                Encoding encoding) {
+  static const char *marks[] = {"\xEF\xBB\xBF", "\xFE\xFF", "\xFF\xFE",
+                                "\x00\x00\xFE\xFF", "\xFF\xFE\x00\x00"};
+  static const size_t sizes[] = {3, 2, 2, 4, 4};
+  const size_t i = static_cast<size_t>(encoding);
+  if ((static_cast<size_t>(pe - p) >= sizes[i]) &&
+      (std::memcmp(p, marks[i], sizes[i]) == 0))
+    return sizes[i];
+  return 0;
+}
+
+/**
+ * @brief Turns utf-16 or utf-32 text into utf-8, a block at a time
+ *
+ *     UTF8Blocks blocks(p, pe, Encoding::utf16LE);
+ *     while (blocks.next())
+ *       parser.feed(blocks.data(), blocks.size());
+ *
+ * The input can be in either byte order and needn't be aligned. Surrogate
+ * pairs are never split between blocks. Lone surrogates come out as U+FFFD,
+ * as do any bytes at the end that don't make up a whole unit.
+ */
+class UTF8Blocks {
+public:
+  /// How many code units are converted at a time
+  static constexpr size_t blockUnits = 16384;
+
+  UTF8Blocks(const char *p, const char *pe, Encoding encoding)
+      : p(p), pe(pe), start(p), encoding(encoding),
+        utf8(blockUnits * 4, '\0') {
+    assert(encoding != Encoding::utf8);
+    if (unitSize(encoding) == 2)
+      units16.resize(blockUnits);
+    else
+      units32.resize(blockUnits);
+  }
+
+  /// Converts the next block; returns false once there's nothing left
+  bool next() {
+    start = p;
+    units = 0;
+    _size = 0;
+    if (p == pe)
+      return false;
+    const size_t width = unitSize(encoding);
+    const size_t available = (pe - p) / width;
+    if (available == 0) {
+      // Not even a whole unit left
+      p = pe;
+      _size = detail::encodeUTF8(0xFFFD, &utf8[0]) - &utf8[0];
+      return true;
+    }
+    units = (available < blockUnits) ? available : blockUnits;
+    const bool swapped = ((encoding == Encoding::utf16BE) ||
+                          (encoding == Encoding::utf32BE)) != bigEndianHost;
+    if (width == 2) {
+      load(units16.data(), units, swapped);
+      // Leave a high surrogate at the end for the next block, with its pair
+      const uint16_t last = units16[units - 1];
+      if ((units > 1) && (units < available) && (last >= 0xD800) &&
+          (last < 0xDC00))
+        --units;
+      _size = wideToUTF8(units16.data(), units16.data() + units, &utf8[0]) -
+              &utf8[0];
+    } else {
+      load(units32.data(), units, swapped);
+      _size = wideToUTF8(units32.data(), units32.data() + units, &utf8[0]) -
+              &utf8[0];
+    }
+    p += units * width;
+    return true;
+  }
+
+  /// The utf-8 for the current block
+  const char *data() const { return utf8.data(); }
+  size_t size() const { return _size; }
+
+  /// Where in the input the utf-8 at 'at' came from. If 'at' isn't in the
+  /// current block, it's the start of the block, or the end of the input for
+  /// a null 'at'.
+  const char *source(const char *at) const {
+    if (!at)
+      return pe;
+    if ((at < data()) || (at > data() + _size))
+      return start;
+    const size_t offset = at - data();
+    const size_t width = unitSize(encoding);
+    size_t bytes = 0;
+    if (width == 2) {
+      const char16_t *u = units16.data();
+      const char16_t *ue = u + units;
+      while (u != ue) {
+        const char16_t *here = u;
+        bytes += detail::utf8SizeOf16(u, ue);
+        if (bytes > offset)
+          return start + (here - units16.data()) * width;
+      }
+    } else {
+      for (size_t i = 0; i != units; ++i) {
+        bytes += detail::utf8SizeOf32(units32[i]);
+        if (bytes > offset)
+          return start + i * width;
+      }
+    }
+    return start + units * width;
+  }
+
+private:
+  const char *p;
+  const char *pe;
+  /// Where the current block started in the input
+  const char *start;
+  Encoding encoding;
+  /// How many units are in the current block
+  size_t units = 0;
+  size_t _size = 0;
+  std::vector<char16_t> units16;
+  std::vector<char32_t> units32;
+  std::string utf8;
+
+  /// Copies 'count' units out of the input, swapping their bytes if they're
+  /// in the other byte order
+  template <typename Unit> void load(Unit *to, size_t count, bool swapped) {
+    std::memcpy(to, p, count * sizeof(Unit));
+    if (!swapped)
+      return;
+    for (size_t i = 0; i != count; ++i)
+      to[i] = (sizeof(Unit) == 2) ? __builtin_bswap16(to[i])
+                                  : __builtin_bswap32(to[i]);
+  }
+};
+
+} // namespace json
@@ -0,0 +1,434 @@
+/// An insertion ordered, string keyed map, stored in a few contiguous chunks
+/// of key/value pairs that never move
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace json {
+
+/// Returns the chars of a map key, whatever kind of string it is
+inline std::pair<const char *, size_t> keyChars(const char *key) {
+  return {key, std::strlen(key)};
+}
+template <typename String, typename = decltype(std::declval<String>().data())>
+inline std::pair<const char *, size_t> keyChars(const String &key) {
+  return {key.data(), key.size()};
+}
+
+/// FNV-1a hash of a run of chars
+inline uint32_t hashKey(std::pair<const char *, size_t> key) {
+  uint32_t result = 2166136261u;
+  for (size_t i = 0; i < key.second; ++i) {
+    result ^= static_cast<unsigned char>(key.first[i]);
+    result *= 16777619u;
+  }
+  return result;
+}
+
+/**
+ * @brief A map that keeps its entries in a few contiguous chunks, in the
+ * order they were added
+ *
+ * JSON objects are usually small, and for small maps a linear search through
+ * contiguous memory beats chasing tree nodes. Once a map grows past
+ * 'indexThreshold' entries we also keep a small open addressing hash table of
+ * entry positions, so big objects don't become quadratic to build.
+ *
+ * The first chunk holds 'firstChunkSize' entries, and each one after that
+ * holds as many as all the chunks before it, so there are few allocations and
+ * entries never move when the map grows. That makes the validity rules:
+ *
+ *  - Adding entries leaves references, pointers and iterators to the existing
+ *    ones valid, as with std::map, so m["new"] = m["old"] is fine. Only end()
+ *    changes, as it's a position.
+ *  - Erasing an entry moves all the ones after it down one place, so
+ *    references and pointers to those (and the erased one) are invalidated,
+ *    as with std::vector. Iterators at or after it then refer to whatever
+ *    entry moved into their place.
+ *  - clear() invalidates everything, and iterators belong to the map object,
+ *    so they don't survive it being moved.
+ *
+ * @tparam Key A std::basic_string
+ * @tparam T The mapped type
+ * @tparam Allocator Allocates the std::pair<Key, T> entries; it's rebound for
+ *                   the chunk list and the hash index
+ */
+template <typename Key, typename T,
+          typename Allocator = std::allocator<std::pair<Key, T>>>
+class flat_map {
+  template <bool Const> class Iterator;
+
+public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using allocator_type = Allocator;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using size_type = size_t;
+
+  /// Maps with more entries than this get a hash index
+  static constexpr size_t indexThreshold = 16;
+  /// How many entries the first chunk holds
+  static constexpr size_t firstChunkSize = 8;
+
+  flat_map() = default;
+  explicit flat_map(const Allocator &alloc)
+      : chunks(ChunkAllocator(alloc)), index(IndexAllocator(alloc)) {}
+  flat_map(std::initializer_list<value_type> init,
+           const Allocator &alloc = Allocator())
+      : flat_map(alloc) {
+    reserve(init.size());
+    for (const value_type &entry : init)
+      insert(entry);
+  }
+  flat_map(const flat_map &other)
+      : flat_map(std::allocator_traits<Allocator>::
+                     select_on_container_copy_construction(
+                         other.get_allocator())) {
+    *this = other;
+  }
+  flat_map(flat_map &&other) noexcept
+      : chunks(std::move(other.chunks)), _size(other._size),
+        index(std::move(other.index)) {
+    other._size = 0;
+  }
+  flat_map &operator=(const flat_map &other) {
+    if (&other == this)
+      return *this;
+    clear();
+    reserve(other.size());
+    // A plain copy of a chunk would only have room for what's in it
+    for (const value_type &entry : other)
+      append(Key(entry.first), T(entry.second));
+    return *this;
+  }
+  flat_map &operator=(flat_map &&other) {
+    chunks = std::move(other.chunks);
+    _size = other._size;
+    index = std::move(other.index);
+    other._size = 0;
+    return *this;
+  }
+
+  allocator_type get_allocator() const {
+    return Allocator(chunks.get_allocator());
+  }
+
+  iterator begin() { return {this, 0}; }
+  iterator end() { return {this, _size}; }
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, _size}; }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  void reserve(size_t n) {
+    while ((n > 0) && (chunkOf(n - 1) >= chunks.size()))
+      addChunk();
+  }
+  void clear() {
+    chunks.clear();
+    _size = 0;
+    index.clear();
+  }
+
+  /// Finds an entry; 'K' can be any kind of string
+  template <typename K> iterator find(const K &key) {
+    return {this, position(keyChars(key))};
+  }
+  template <typename K> const_iterator find(const K &key) const {
+    return {this, position(keyChars(key))};
+  }
+  template <typename K> size_t count(const K &key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  template <typename K> T &at(const K &key) {
+    auto found = find(key);
+    if (found == end())
+      throw std::out_of_range("flat_map has no such key");
+    return found->second;
+  }
+  template <typename K> const T &at(const K &key) const {
+    auto found = find(key);
+    if (found == end())
+      throw std::out_of_range("flat_map has no such key");
+    return found->second;
+  }
+
+  /// Returns the value for 'key', adding a default constructed one if needed
+  template <typename K> T &operator[](const K &key) {
+    auto chars = keyChars(key);
+    size_t found = position(chars);
+    if (found != _size)
+      return entryAt(found).second;
+    Key newKey(chars.first, chars.second,
+               typename Key::allocator_type(get_allocator()));
+    return append(std::move(newKey), T())->second;
+  }
+
+  /// Adds an entry if there isn't one with the same key already
+  std::pair<iterator, bool> insert(value_type entry) {
+    size_t found = position(keyChars(entry.first));
+    if (found != _size)
+      return {iterator(this, found), false};
+    return {append(std::move(entry.first), std::move(entry.second)), true};
+  }
+  template <typename K, typename V>
+  std::pair<iterator, bool> emplace(K &&key, V &&value) {
+    return insert(value_type(std::forward<K>(key), std::forward<V>(value)));
+  }
+  /// Adds an entry, or replaces the value of the one with the same key
+  template <typename V>
+  std::pair<iterator, bool> insert_or_assign(Key &&key, V &&value) {
+    return assign(std::move(key), std::forward<V>(value));
+  }
+  template <typename V>
+  std::pair<iterator, bool> insert_or_assign(const Key &key, V &&value) {
+    return assign(key, std::forward<V>(value));
+  }
+
+  /// Removes an entry, keeping the order of the rest
+  iterator erase(const_iterator entry) {
+    const size_t at = entry.i;
+    for (size_t i = at + 1; i < _size; ++i)
+      entryAt(i - 1) = std::move(entryAt(i));
+    // Emptied chunks are kept, so adding entries again doesn't allocate
+    chunks[chunkOf(_size - 1)].pop_back();
+    --_size;
+    rebuildIndex();
+    return {this, at};
+  }
+  iterator erase(iterator entry) { return erase(const_iterator(entry)); }
+  template <typename K, typename = decltype(keyChars(std::declval<K>()))>
+  size_t erase(const K &key) {
+    size_t found = position(keyChars(key));
+    if (found == _size)
+      return 0;
+    erase(const_iterator(this, found));
+    return 1;
+  }
+
+  /// Equal if they have the same entries, whatever order they're in
+  bool operator==(const flat_map &other) const {
+    if (size() != other.size())
+      return false;
+    for (const value_type &entry : *this) {
+      auto found = other.find(entry.first);
+      if ((found == other.end()) || !(found->second == entry.second))
+        return false;
+    }
+    return true;
+  }
+  bool operator!=(const flat_map &other) const { return !(*this == other); }
+
+private:
+  using Chunk = std::vector<value_type, Allocator>;
+  using ChunkAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Chunk>;
+  using IndexAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<uint32_t>;
+
+  // Each chunk is reserved up front and never grows past that, so its
+  // entries stay put
+  std::vector<Chunk, ChunkAllocator> chunks;
+  size_t _size = 0;
+  // Open addressing hash table of entry position + 1; 0 means empty. Only
+  // used once we have more than indexThreshold entries.
+  std::vector<uint32_t, IndexAllocator> index;
+
+  /// The chunk that holds entry 'i'
+  static size_t chunkOf(size_t i) {
+    return (i < firstChunkSize)
+               ? 0
+               : 64 - __builtin_clzll(
+                          static_cast<unsigned long long>(i / firstChunkSize));
+  }
+  /// The position of the first entry in chunk 'k'
+  static size_t chunkStart(size_t k) {
+    return k ? firstChunkSize << (k - 1) : 0;
+  }
+
+  value_type &entryAt(size_t i) {
+    const size_t k = chunkOf(i);
+    return chunks[k][i - chunkStart(k)];
+  }
+  const value_type &entryAt(size_t i) const {
+    const size_t k = chunkOf(i);
+    return chunks[k][i - chunkStart(k)];
+  }
+
+  void addChunk() {
+    const size_t k = chunks.size();
+    chunks.emplace_back(get_allocator());
+    chunks.back().reserve(k ? chunkStart(k) : firstChunkSize);
+  }
+
+  static bool keyEquals(const Key &a, std::pair<const char *, size_t> b) {
+    return (a.size() == b.second) &&
+           (std::memcmp(a.data(), b.first, b.second) == 0);
+  }
+
+  /// Returns the position of 'key', or size()
+  size_t position(std::pair<const char *, size_t> key) const {
+    if (index.empty()) {
+      size_t i = 0;
+      for (const Chunk &chunk : chunks)
+        for (const value_type &entry : chunk) {
+          if (keyEquals(entry.first, key))
+            return i;
+          ++i;
+        }
+      return _size;
+    }
+    size_t mask = index.size() - 1;
+    for (size_t slot = hashKey(key) & mask; index[slot]; slot = (slot + 1) & mask)
+      if (keyEquals(entryAt(index[slot] - 1).first, key))
+        return index[slot] - 1;
+    return _size;
+  }
+
+  template <typename K, typename V>
+  std::pair<iterator, bool> assign(K &&key, V &&value) {
+    size_t found = position(keyChars(key));
+    if (found != _size) {
+      entryAt(found).second = std::forward<V>(value);
+      return {iterator(this, found), false};
+    }
+    return {append(Key(std::forward<K>(key)), T(std::forward<V>(value))),
+            true};
+  }
+
+  iterator append(Key &&key, T &&value) {
+    const size_t k = chunkOf(_size);
+    if (k == chunks.size())
+      addChunk();
+    chunks[k].emplace_back(std::move(key), std::move(value));
+    ++_size;
+    if (_size > indexThreshold) {
+      if (_size * 2 > index.size())
+        rebuildIndex();
+      else
+        addToIndex(_size - 1);
+    }
+    return {this, _size - 1};
+  }
+
+  void addToIndex(size_t i) {
+    size_t mask = index.size() - 1;
+    size_t slot = hashKey(keyChars(entryAt(i).first)) & mask;
+    while (index[slot])
+      slot = (slot + 1) & mask;
+    index[slot] = static_cast<uint32_t>(i + 1);
+  }
+
+  void rebuildIndex() {
+    index.clear();
+    if (_size <= indexThreshold)
+      return;
+    size_t size = 64;
+    while (size < _size * 4)
+      size *= 2;
+    index.resize(size, 0);
+    for (size_t i = 0; i < _size; ++i)
+      addToIndex(i);
+  }
+};
+
+/// A position in a flat_map
+template <typename Key, typename T, typename Allocator>
+template <bool Const>
+class flat_map<Key, T, Allocator>::Iterator {
+  using Map = std::conditional_t<Const, const flat_map, flat_map>;
+
+public:
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = typename flat_map::value_type;
+  using difference_type = std::ptrdiff_t;
+  using reference = std::conditional_t<Const, const value_type &, value_type &>;
+  using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+
+  Iterator() = default;
+  Iterator(Map *map, size_t i) : map(map), i(i) {}
+  /// An iterator converts to a const_iterator
+  template <bool C, typename = std::enable_if_t<Const && !C>>
+  Iterator(const Iterator<C> &other) : map(other.map), i(other.i) {}
+
+  reference operator*() const { return map->entryAt(i); }
+  pointer operator->() const { return &map->entryAt(i); }
+  reference operator[](difference_type n) const { return map->entryAt(i + n); }
+
+  Iterator &operator++() {
+    ++i;
+    return *this;
+  }
+  Iterator operator++(int) {
+    Iterator result = *this;
+    ++i;
+    return result;
+  }
+  Iterator &operator--() {
+    --i;
+    return *this;
+  }
+  Iterator operator--(int) {
+    Iterator result = *this;
+    --i;
+    return result;
+  }
+  Iterator &operator+=(difference_type n) {
+    i += n;
+    return *this;
+  }
+  Iterator &operator-=(difference_type n) {
+    i -= n;
+    return *this;
+  }
+  Iterator operator+(difference_type n) const { return {map, i + n}; }
+  Iterator operator-(difference_type n) const { return {map, i - n}; }
+  friend Iterator operator+(difference_type n, const Iterator &it) {
+    return it + n;
+  }
+  template <bool C> difference_type operator-(const Iterator<C> &other) const {
+    return static_cast<difference_type>(i) -
+           static_cast<difference_type>(other.i);
+  }
+
+  template <bool C> bool operator==(const Iterator<C> &other) const {
+    return i == other.i;
+  }
+  template <bool C> bool operator!=(const Iterator<C> &other) const {
+    return i != other.i;
+  }
+  template <bool C> bool operator<(const Iterator<C> &other) const {
+    return i < other.i;
+  }
+  template <bool C> bool operator>(const Iterator<C> &other) const {
+    return i > other.i;
+  }
+  template <bool C> bool operator<=(const Iterator<C> &other) const {
+    return i <= other.i;
+  }
+  template <bool C> bool operator>=(const Iterator<C> &other) const {
+    return i >= other.i;
+  }
+
+private:
+  friend class flat_map;
+  template <bool> friend class Iterator;
+
+  Map *map = nullptr;
+  size_t i = 0;
+};
+
+} // namespace json
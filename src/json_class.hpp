@@ -4,297 +4,528 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <memory>
 #include <vector>
 #include <iterator>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
+#include "arena.hpp"
+#include "flat_map.hpp"
 #include "unicode.hpp"
+#include "writer/number.hpp"
+#include "writer/sink.hpp"
+#include "writer/string.hpp"
 
 namespace json {
 
-struct JSON;
+template <typename Allocator = std::allocator<char>> struct basic_JSON;
 
-using JList = std::vector<JSON>;
+/// Rebinds 'Allocator' to allocate 'T's
+template <typename Allocator, typename T>
+using rebind_alloc =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+template <typename Allocator>
+using basic_JString =
+    std::basic_string<char, std::char_traits<char>, rebind_alloc<Allocator, char>>;
+template <typename Allocator>
+using basic_JList =
+    std::vector<basic_JSON<Allocator>,
+                rebind_alloc<Allocator, basic_JSON<Allocator>>>;
+template <typename Allocator>
+using basic_JMap =
+    flat_map<basic_JString<Allocator>, basic_JSON<Allocator>,
+             rebind_alloc<Allocator, std::pair<basic_JString<Allocator>,
+                                               basic_JSON<Allocator>>>>;
+
+using JSON = basic_JSON<>;
+using JList = basic_JList<std::allocator<char>>;
 using JEntry = std::pair<std::string, JSON>;
-using JMap = std::map<std::string, JSON>;
+using JMap = basic_JMap<std::allocator<char>>;
 
-struct JSON {
+/**
+ * @brief A JSON value: null, boolean, number, text, map or list
+ *
+ * A node is 16 bytes: 14 bytes of payload, a length byte and a tag byte.
+ * Numbers are kept as int64, uint64 or double; strings of up to 14 chars live
+ * in the node itself. Longer strings, lists and maps live out of line, and get
+ * their memory from 'Allocator' (rebound as needed). The default uses the
+ * global allocator; see ArenaJSON for one that keeps a whole document in a few
+ * big blocks.
+ *
+ * @tparam Allocator A standard allocator; it's copied into every out of line
+ *                   string, list and map in the tree
+ */
+template <typename Allocator> struct basic_JSON {
 public:
     enum Type {null, boolean, number, text, map, list};
-    using string = std::string;
+    using allocator_type = Allocator;
+    using string = basic_JString<Allocator>;
+    using JList = basic_JList<Allocator>;
+    using JMap = basic_JMap<Allocator>;
+    /// Strings up to this long are stored in the node
+    static constexpr size_t shortTextCapacity = 14;
 private:
-    friend std::ostream& operator <<(std::ostream& s, const JSON& j);
-    Type type;
-    union Value {
-        std::string as_string;
-        long double as_num;
-        bool as_bool;
-        JMap as_map;
-        JList as_list;
-        Value () {}
-        Value (std::string val) { new (&as_string) std::string(val); }
-        Value (long double val) : as_num(val) {}
-        Value (bool val, int) : as_bool(val) {} // Need to pass an int to differentiate from as_num constructor
-        Value (JMap val) { new (&as_map) JMap(val); }
-        Value (JList val) { new (&as_list) JList(val); }
-        ~Value () {}
-    } value;
+    /// What's actually in 'storage'
+    enum Tag : unsigned char {
+        nullTag, boolTag, intTag, uintTag, doubleTag,
+        shortTextTag, // The chars are in 'storage', 'length' of them
+        longTextTag,  // 'storage' holds a string*
+        mapTag,       // 'storage' holds a JMap*
+        listTag       // 'storage' holds a JList*
+    };
+    alignas(8) unsigned char storage[shortTextCapacity];
+    unsigned char length;
+    Tag tag;
+
+    template <typename T> T load() const {
+        T result;
+        std::memcpy(&result, storage, sizeof(T));
+        return result;
+    }
+    template <typename T> void store(T val) {
+        std::memcpy(storage, &val, sizeof(T));
+    }
+    string *longText() const { return load<string *>(); }
+    JMap *mapPtr() const { return load<JMap *>(); }
+    JList *listPtr() const { return load<JList *>(); }
+
+    /// Moves or copies a string, list or map out of line, using its own allocator
+    template <typename Container> void storeOutOfLine(Container&& val, Tag newTag) {
+        using Decayed = typename std::decay<Container>::type;
+        using Alloc = rebind_alloc<Allocator, Decayed>;
+        using Traits = std::allocator_traits<Alloc>;
+        Alloc alloc(val.get_allocator());
+        Decayed *p = Traits::allocate(alloc, 1);
+#ifdef __cpp_exceptions
+        try {
+            Traits::construct(alloc, p, std::forward<Container>(val));
+        } catch (...) {
+            Traits::deallocate(alloc, p, 1);
+            throw;
+        }
+#else
+        Traits::construct(alloc, p, std::forward<Container>(val));
+#endif
+        store(p);
+        tag = newTag;
+    }
+    template <typename Container> static void destroyOutOfLine(Container *p) {
+        using Alloc = rebind_alloc<Allocator, Container>;
+        using Traits = std::allocator_traits<Alloc>;
+        Alloc alloc(p->get_allocator());
+        Traits::destroy(alloc, p);
+        Traits::deallocate(alloc, p, 1);
+    }
+    void setText(const char *chars, size_t size, const Allocator &alloc) {
+        if (size <= shortTextCapacity) {
+            std::memcpy(storage, chars, size);
+            length = static_cast<unsigned char>(size);
+            tag = shortTextTag;
+        } else
+            storeOutOfLine(string(chars, size, alloc), longTextTag);
+    }
+    void setText(string&& val) {
+        if (val.size() <= shortTextCapacity)
+            setText(val.data(), val.size(), Allocator(val.get_allocator()));
+        else
+            storeOutOfLine(std::move(val), longTextTag);
+    }
     void cleanup() noexcept {
-        switch (type) {
-            case null: 
-            case boolean: 
-            case number: break;
-            case text: value.as_string.~string(); break;
-            case map: value.as_map.~JMap(); break;
-            case list: value.as_list.~JList(); break;
+        switch (tag) {
+            case longTextTag: destroyOutOfLine(longText()); break;
+            case mapTag: destroyOutOfLine(mapPtr()); break;
+            case listTag: destroyOutOfLine(listPtr()); break;
+            default: break;
         }
-        type = null;
+        tag = nullTag;
     }
-    void copyFromOther(const JSON& other) {
+    void copyFromOther(const basic_JSON& other) {
         cleanup();
-        type = other.type;
-        switch (other.type) {
-            case null: value.as_num = 0; break;
-            case boolean: value.as_bool = other.value.as_bool; break;
-            case number: value.as_num = other.value.as_num; break;
-            case text:
-                new (&value.as_string) std::string;
-                value.as_string = other.value.as_string;
-                break;
-            case map:
-                new (&value.as_map) JMap;
-                value.as_map = other.value.as_map;
-                break;
-            case list:
-                new (&value.as_list) JList;
-                value.as_list = other.value.as_list;
-                break;
+        switch (other.tag) {
+            case longTextTag: storeOutOfLine(*other.longText(), longTextTag); break;
+            case mapTag: storeOutOfLine(*other.mapPtr(), mapTag); break;
+            case listTag: storeOutOfLine(*other.listPtr(), listTag); break;
+            default:
+                // Everything else is all in the node
+                std::memcpy(storage, other.storage, sizeof(storage));
+                length = other.length;
+                tag = other.tag;
         }
     }
-    void moveFromOther(JSON&& other) {
+    void moveFromOther(basic_JSON&& other) noexcept {
+        if (&other == this)
+            return;
         cleanup();
-        type = other.type;
-        switch (other.type) {
-            case null: value.as_num = 0; break;
-            case boolean: value.as_bool = other.value.as_bool; break;
-            case number: value.as_num = other.value.as_num; break;
-            case text:
-                new (&value.as_string) std::string(std::move(other.value.as_string));
-                break;
-            case map:
-                new (&value.as_map) JMap(std::move(other.value.as_map));
-                break;
-            case list:
-                new (&value.as_list) JList(std::move(other.value.as_list));
-                break;
-        }
-        other.cleanup();
+        // Out of line values are just pointers, so moving is a plain copy
+        std::memcpy(storage, other.storage, sizeof(storage));
+        length = other.length;
+        tag = other.tag;
+        other.tag = nullTag;
+    }
+    template <typename Key> basic_JSON &mapEntry(const Key &key) {
+        assert(tag == mapTag);
+        return (*mapPtr())[key];
+    }
+    const char *textData() const {
+        return tag == shortTextTag ? reinterpret_cast<const char *>(storage)
+                                   : longText()->data();
+    }
+    size_t textSize() const {
+        return tag == shortTextTag ? length : longText()->size();
+    }
+    /// Compares two numbers exactly, whatever way they're stored
+    bool numberEquals(const basic_JSON &other) const {
+        if ((tag == doubleTag) || (other.tag == doubleTag))
+            return static_cast<double>(*this) == static_cast<double>(other);
+        if (tag == other.tag)
+            return std::memcmp(storage, other.storage, 8) == 0;
+        // One is an int64 and the other a uint64
+        int64_t i = (tag == intTag) ? load<int64_t>() : other.load<int64_t>();
+        uint64_t u = (tag == uintTag) ? load<uint64_t>() : other.load<uint64_t>();
+        return (i >= 0) && (static_cast<uint64_t>(i) == u);
     }
 public:
-    JSON() : type(null), value{0} {}
+    basic_JSON() : length(0), tag(nullTag) { store<uint64_t>(0); }
     // To convert to a boolean you need to pass an extra int to differentiate between bools and numbers .. use JBool method to create a boolean
-    JSON(bool val, int) : type(boolean), value{val, 0} {} 
-    JSON(long double val) : type(number), value{val} {}
-    JSON(std::string val) : type(text), value{val} {}
-    JSON(const char* val) : type(text), value{std::string(val)} {}
-    JSON(JMap val) : type(map), value{val} {}
-    JSON(JList val) : type(list), value{val} {}
-    JSON(const JSON& other) : type(null) { copyFromOther(other); }
-    JSON(JSON&& other) noexcept : type(null) { moveFromOther(std::move(other)); };
-    ~JSON() { cleanup(); }
-    Type whatIs() const { return type; }
-    JSON& operator=(const JSON& other) {
-        copyFromOther(other);
+    basic_JSON(bool val, int) : length(0), tag(boolTag) { store<uint64_t>(val); }
+    /// Integers are stored exactly, as an int64 or uint64
+    template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                  std::is_signed<T>::value>::type * = nullptr>
+    basic_JSON(T val) : length(0), tag(intTag) { store<int64_t>(val); }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                  !std::is_signed<T>::value>::type * = nullptr>
+    basic_JSON(T val) : length(0), tag(uintTag) { store<uint64_t>(val); }
+    template <typename T, typename std::enable_if<
+                              std::is_floating_point<T>::value>::type * = nullptr>
+    basic_JSON(T val) : length(0), tag(doubleTag) { store<double>(val); }
+    basic_JSON(string val) : length(0) { setText(std::move(val)); }
+    basic_JSON(const char* val, const Allocator& alloc = Allocator()) : length(0) {
+        setText(val, std::strlen(val), alloc);
+    }
+    basic_JSON(JMap val) : length(0) { storeOutOfLine(std::move(val), mapTag); }
+    basic_JSON(JList val) : length(0) { storeOutOfLine(std::move(val), listTag); }
+    basic_JSON(const basic_JSON& other) : length(0), tag(nullTag) { copyFromOther(other); }
+    basic_JSON(basic_JSON&& other) noexcept : length(0), tag(nullTag) { moveFromOther(std::move(other)); };
+    ~basic_JSON() { cleanup(); }
+    Type whatIs() const {
+        switch (tag) {
+            case nullTag: return null;
+            case boolTag: return boolean;
+            case intTag:
+            case uintTag:
+            case doubleTag: return number;
+            case shortTextTag:
+            case longTextTag: return text;
+            case mapTag: return map;
+            case listTag: return list;
+        }
+        return null;
+    }
+    basic_JSON& operator=(const basic_JSON& other) {
+        if (&other != this)
+            copyFromOther(other);
         return *this;
     }
-    JSON& operator=(JSON&& other) {
+    basic_JSON& operator=(basic_JSON&& other) noexcept {
         moveFromOther(std::move(other));
         return *this;
     }
+    /// True if the number is held exactly as an int64 or uint64
+    bool isInteger() const { return (tag == intTag) || (tag == uintTag); }
     /// Render as number
     template <typename T>
     explicit operator T() const {
-        assert(type == number);
-        return value.as_num;
+        assert(whatIs() == number);
+        switch (tag) {
+            case intTag: return static_cast<T>(load<int64_t>());
+            case uintTag: return static_cast<T>(load<uint64_t>());
+            default: return static_cast<T>(load<double>());
+        }
     }
     /// Return as a UTF8 encoded string
     operator std::string() const {
-        assert(type == text);
-        return value.as_string;
+        assert(whatIs() == text);
+        return std::string(textData(), textSize());
     }
+    /// Return as utf-16 or utf-32, depending on the size of wchar_t
     operator std::wstring() const {
-        assert(type == text);
-        std::wstring result;
-        result.reserve(value.as_string.size()*1.10); // Assume a 10% size increase
-        json::transformFrom8(value.as_string.cbegin(), value.as_string.cend(), back_inserter(result));
+        assert(whatIs() == text);
+        const char *chars = textData();
+        const char *end = chars + textSize();
+        if (json::findBadUTF8(chars, end) != end)
+            throw UnicodeError("Bad utf-8 char");
+        std::wstring result(json::wideSize<wchar_t>(chars, end), L'\0');
+        if (!result.empty())
+            json::utf8ToWide(chars, end, &result[0]);
         return result;
     }
     operator const JMap&() const {
-        assert(type == map);
-        return value.as_map;
+        assert(tag == mapTag);
+        return *mapPtr();
     }
     operator const JList&() const {
-        assert(type == list);
-        return value.as_list;
+        assert(tag == listTag);
+        return *listPtr();
     }
     operator JMap&() {
-        assert(type == map);
-        return value.as_map;
+        assert(tag == mapTag);
+        return *mapPtr();
     }
     operator JList&() {
-        assert(type == list);
-        return value.as_list;
+        assert(tag == listTag);
+        return *listPtr();
     }
     explicit operator bool() const {
-        // If the type is null, the bool value is false
-        if (type == null)
-            return false;
-        switch (type) {
-            case null: return false;
-            case boolean: return value.as_bool;
-            case number: return value.as_num != 0;
-            case text: return !value.as_string.empty();
-            case map: return !value.as_map.empty();
-            case list: return !value.as_list.empty();
+        switch (tag) {
+            case nullTag: return false;
+            case boolTag:
+            case intTag:
+            case uintTag: return load<uint64_t>() != 0;
+            case doubleTag: return load<double>() != 0;
+            case shortTextTag: return length != 0;
+            case longTextTag: return !longText()->empty();
+            case mapTag: return !mapPtr()->empty();
+            case listTag: return !listPtr()->empty();
         }
-        return type != null;
+        return false;
     }
-    bool isNull() const { return type == null; }
-    JSON &at(size_t i) {
-      assert(type == list);
-      return value.as_list.at(i);
+    bool isNull() const { return tag == nullTag; }
+    basic_JSON &at(size_t i) {
+      assert(tag == listTag);
+      return listPtr()->at(i);
     }
-    const JSON &at(size_t i) const {
-      assert(type == list);
-      return value.as_list.at(i);
+    const basic_JSON &at(size_t i) const {
+      assert(tag == listTag);
+      return listPtr()->at(i);
     }
-    JSON &operator[](size_t i) {
-      assert(type == list);
-      return value.as_list[i];
+    basic_JSON &operator[](size_t i) {
+      assert(tag == listTag);
+      return (*listPtr())[i];
     }
-    const JSON &operator[](size_t i) const {
-      assert(type == list);
-      return value.as_list[i];
+    const basic_JSON &operator[](size_t i) const {
+      assert(tag == listTag);
+      return (*listPtr())[i];
     }
-    JSON &at(const std::string &i) {
-      assert(type == map);
-      return value.as_map.at(i);
+    /// Map access; 'Key' can be any kind of string
+    template <typename Key, typename = decltype(keyChars(std::declval<Key>()))>
+    basic_JSON &at(const Key &key) {
+      assert(tag == mapTag);
+      auto found = mapPtr()->find(key);
+      if (found == mapPtr()->end())
+        throw std::out_of_range("JSON map has no such key");
+      return found->second;
     }
-    const JSON &at(const std::string &i) const {
-      assert(type == map);
-      return value.as_map.at(i);
+    template <typename Key, typename = decltype(keyChars(std::declval<Key>()))>
+    const basic_JSON &at(const Key &key) const {
+      assert(tag == mapTag);
+      auto found = mapPtr()->find(key);
+      if (found == mapPtr()->end())
+        throw std::out_of_range("JSON map has no such key");
+      return found->second;
     }
-    typename decltype(value.as_map)::iterator find(const std::string &i) {
-      assert(type == map);
-      return value.as_map.find(i);
+    template <typename Key>
+    typename JMap::iterator find(const Key &key) {
+      assert(tag == mapTag);
+      return mapPtr()->find(key);
     }
-    typename decltype(value.as_map)::const_iterator find(const std::string &i) const {
-      assert(type == map);
-      return value.as_map.find(i);
+    template <typename Key>
+    typename JMap::const_iterator find(const Key &key) const {
+      assert(tag == mapTag);
+      return static_cast<const JMap *>(mapPtr())->find(key);
     }
-    JSON &operator[](const std::string &i) {
-      assert(type == map);
-      return value.as_map[i];
+    /// Returns the map entry for 'key', adding a null one if needed
+    template <typename Key, typename = decltype(keyChars(std::declval<Key>()))>
+    basic_JSON &operator[](const Key &key) {
+      return mapEntry(key);
     }
-    const JSON &operator[](const std::string &i) const {
-      assert(type == map);
-      return value.as_map.at(i);
+    template <typename Key, typename = decltype(keyChars(std::declval<Key>()))>
+    const basic_JSON &operator[](const Key &key) const {
+      return at(key);
     }
-    bool operator==(const JSON &other) const {
-      if (other.type == type)
-        switch (type) {
+    bool operator==(const basic_JSON &other) const {
+      if (other.whatIs() == whatIs())
+        switch (whatIs()) {
         case null:
           return true;
         case boolean:
-          return value.as_bool == other.value.as_bool;
+          return load<uint64_t>() == other.load<uint64_t>();
         case number:
-          return value.as_num == other.value.as_num;
+          return numberEquals(other);
         case text:
-          return value.as_string == other.value.as_string;
+          return (textSize() == other.textSize()) &&
+                 (std::memcmp(textData(), other.textData(), textSize()) == 0);
         case map:
-          return value.as_map == other.value.as_map;
+          return *mapPtr() == *other.mapPtr();
         case list:
-          return value.as_list == other.value.as_list;
+          return *listPtr() == *other.listPtr();
         }
       return false;
     }
-  std::string toString() const {
-    std::stringstream out;
-    out << *this;
-    return out.str();
+    /**
+     * @brief Writes this value as json text
+     *
+     * @param out A sink from writer/sink.hpp, or anything else with
+     *            put(char) and write(const char*, size_t)
+     * @param escape What to escape in strings and keys
+     */
+    template <typename Sink>
+    void writeTo(Sink &out, Escape escape = Escape::required) const {
+        switch (tag) {
+            case nullTag: out.write("null", 4); break;
+            case boolTag:
+              if (load<uint64_t>())
+                out.write("true", 4);
+              else
+                out.write("false", 5);
+              break;
+            case intTag:
+            case uintTag:
+            case doubleTag: {
+              // Shortest round trip digits, whatever the locale
+              char buffer[maxNumberChars];
+              char *end = tag == intTag
+                              ? writeInteger(load<int64_t>(), buffer)
+                              : tag == uintTag
+                                    ? writeInteger(load<uint64_t>(), buffer)
+                                    : writeDouble(load<double>(), buffer);
+              out.write(buffer, end - buffer);
+              break;
+            }
+            case shortTextTag:
+            case longTextTag:
+              writeString(out, textData(), textSize(), escape);
+              break;
+            case mapTag: writeMap(out, *mapPtr(), escape); break;
+            case listTag: writeList(out, *listPtr(), escape); break;
+        }
+    }
+    template <typename Sink>
+    static void writeMap(Sink &out, const JMap &map,
+                         Escape escape = Escape::required) {
+        out.put('{');
+        bool first = true;
+        for (const auto &entry : map) {
+            if (!first)
+                out.put(',');
+            first = false;
+            writeString(out, entry.first.data(), entry.first.size(), escape);
+            out.put(':');
+            entry.second.writeTo(out, escape);
+        }
+        out.put('}');
+    }
+    template <typename Sink>
+    static void writeList(Sink &out, const JList &list,
+                          Escape escape = Escape::required) {
+        out.put('[');
+        bool first = true;
+        for (const basic_JSON &item : list) {
+            if (!first)
+                out.put(',');
+            first = false;
+            item.writeTo(out, escape);
+        }
+        out.put(']');
+    }
+  std::string toString(Escape escape = Escape::required) const {
+    std::string result;
+    StringSink<> out(result);
+    writeTo(out, escape);
+    return result;
   }
 };
 
-inline std::ostream &operator<<(std::ostream &s, const JMap &j) {
-  s << '{';
-  auto entry = j.cbegin();
-  auto end = j.cend();
-  if (entry != end) {
-    --end; // Second to last one so that we don't put a comma after the last one
-    while (entry != end) {
-      s << '"' << entry->first << R"(":)" << entry->second << ',';
-      ++entry;
-    }
-    // The last entry in the map doesn't have a comma after it
-    s << '"' << entry->first << R"(":)" << entry->second;
-  }
-  s << '}';
+static_assert(sizeof(basic_JSON<>) == 16, "JSON nodes should be 16 bytes");
+
+template <typename Allocator>
+inline std::ostream &operator<<(std::ostream &s,
+                                const basic_JMap<Allocator> &j) {
+  StreamSink out(s);
+  basic_JSON<Allocator>::writeMap(out, j);
   return s;
 }
 
-inline std::ostream &operator<<(std::ostream &s, const JList &j) {
-  s << '[';
-  auto entry = j.cbegin();
-  auto end = j.cend();
-  if (entry != end) {
-    --end; // Second to last one so that we don't put a comma after the last one
-    while (entry != end) {
-      s << *entry << ',';
-      ++entry;
-    }
-    s << *entry;
-  }
-  s << ']';
+template <typename Allocator>
+inline std::ostream &operator<<(std::ostream &s,
+                                const basic_JList<Allocator> &j) {
+  StreamSink out(s);
+  basic_JSON<Allocator>::writeList(out, j);
   return s;
 }
 
-inline std::ostream& operator <<(std::ostream& s, const JSON& j) {
-    switch(j.type) {
-        case JSON::null: s << "null"; break;
-        case JSON::boolean: s << (j.value.as_bool ? "true" : "false"); break;
-        case JSON::number: s << j.value.as_num; break;
-        case JSON::text: s << '"' << j.value.as_string << '"'; break;
-        case JSON::map: {
-          s << j.value.as_map;
-          break;
-        }
-        case JSON::list: {
-          s << j.value.as_list;
-          break;
-        }
-    };
-    return s;
+template <typename Allocator>
+inline std::ostream& operator <<(std::ostream& s, const basic_JSON<Allocator>& j) {
+  StreamSink out(s);
+  j.writeTo(out);
+  return s;
+}
+
+/**
+ * @brief Writes 'j' as json text through an output iterator
+ *
+ * @returns The iterator after the last char written
+ */
+template <typename Allocator, typename OutputIterator>
+OutputIterator write(const basic_JSON<Allocator> &j, OutputIterator out) {
+  IteratorSink<OutputIterator> sink(out);
+  j.writeTo(sink);
+  return sink.position();
 }
 
 inline JSON JBool(bool val) { return JSON(val, 1); }
 
-template <typename T>
-std::vector<T> jsonToHomogenousList(const JSON& j) {
+template <typename T, typename Allocator>
+std::vector<T> jsonToHomogenousList(const basic_JSON<Allocator>& j) {
   std::vector<T> result;
-  const JList& input = j;
+  const basic_JList<Allocator>& input = j;
   result.reserve(input.size());
-  for (const JSON& item : input)
+  for (const basic_JSON<Allocator>& item : input)
     result.push_back(static_cast<T>(item));
   return result;
 }
 
-template <typename T>
-std::map<std::string, T> jsonToHomogenousMap(const JSON& j) {
+template <typename T, typename Allocator>
+std::map<std::string, T> jsonToHomogenousMap(const basic_JSON<Allocator>& j) {
   std::map<std::string, T> result;
-  const JMap& input = j;
+  const basic_JMap<Allocator>& input = j;
   for (auto i = input.cbegin(); i != input.cend(); ++i)
-    result.insert(make_pair(i->first, static_cast<T>(i->second)));
+    result.insert(make_pair(std::string(i->first.data(), i->first.size()),
+                            static_cast<T>(i->second)));
   return result;
 }
 
+/**
+ * @brief A JSON tree that lives entirely in its own Arena
+ *
+ * Every node, string, list and map is allocated from the arena. The tree is
+ * never taken apart node by node: destroying an ArenaJSON just frees the
+ * arena's blocks, so it costs the same however big the document is.
+ */
+class ArenaJSON {
+public:
+  using value_type = basic_JSON<ArenaAllocator<char>>;
+
+  explicit ArenaJSON(size_t firstBlockSize = 4096)
+      : _arena(new Arena(firstBlockSize)),
+        _root(new (_arena->allocateArray<value_type>(1)) value_type()) {}
+
+  value_type &root() { return *_root; }
+  const value_type &root() const { return *_root; }
+  ArenaAllocator<char> allocator() const { return {*_arena}; }
+  const Arena &arena() const { return *_arena; }
+
+private:
+  // Held by pointer so that moving an ArenaJSON doesn't move the Arena out
+  // from under the allocators in the tree
+  std::unique_ptr<Arena> _arena;
+  value_type *_root;
+};
+
 }
@@ -0,0 +1,205 @@
+/// A read only JSON DOM that borrows its strings from the parsed text.
+///
+/// Strings with no escapes point straight into the input buffer; only escaped
+/// strings are decoded, into the document's arena. The arrays and objects
+/// live in the arena too, so a whole document is freed in one go. The input
+/// buffer must outlive the JDocument.
+#pragma once
+
+#include "arena.hpp"
+#include "parser/number.hpp"
+#include "parser/string.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace json {
+
+/// A string that lives in the input text, or in a JDocument's arena
+using StringView = string_reference<const char *>;
+
+/// Compares a StringView to a run of chars
+inline bool equals(const StringView &a, const char *b, size_t bSize) {
+  return (a.size() == bSize) &&
+         ((bSize == 0) || (std::memcmp(a.begin(), b, bSize) == 0));
+}
+
+/// A pair of pointers that can be used in a range based for loop
+template <typename T> struct ViewRange {
+  const T *_begin;
+  const T *_end;
+  const T *begin() const { return _begin; }
+  const T *end() const { return _end; }
+  size_t size() const { return _end - _begin; }
+  bool empty() const { return _begin == _end; }
+};
+
+struct JViewMember;
+
+/// One value in a borrowed JSON document. It's small, trivially copyable, and
+/// only ever points at memory that someone else owns.
+class JView {
+public:
+  enum Type { null, boolean, number, text, map, list };
+
+private:
+  Type type;
+  // Chars in a string, entries in a list or map, or the NumberValue::Kind of
+  // a number
+  size_t length;
+  union Value {
+    bool as_bool;
+    int64_t as_int;
+    uint64_t as_uint;
+    double as_num;
+    const char *as_text;
+    const JView *as_list;
+    const JViewMember *as_map;
+  } value;
+
+public:
+  JView() : type(null), length(0) { value.as_num = 0; }
+  // Pass an extra int to make a boolean, like JSON does
+  JView(bool val, int) : type(boolean), length(0) { value.as_bool = val; }
+  JView(double val) : type(number), length(NumberValue::floating) {
+    value.as_num = val;
+  }
+  JView(const NumberValue &val) : type(number), length(val.kind) {
+    switch (val.kind) {
+    case NumberValue::signedInt:
+      value.as_int = val.asInt;
+      break;
+    case NumberValue::unsignedInt:
+      value.as_uint = val.asUInt;
+      break;
+    case NumberValue::floating:
+      value.as_num = val.asDouble;
+      break;
+    }
+  }
+  JView(StringView val) : type(text), length(val.size()) {
+    value.as_text = val.begin();
+  }
+  JView(const JView *items, size_t size) : type(list), length(size) {
+    value.as_list = items;
+  }
+  JView(const JViewMember *members, size_t size) : type(map), length(size) {
+    value.as_map = members;
+  }
+
+  Type whatIs() const { return type; }
+  bool isNull() const { return type == null; }
+
+  /// True if the number is held exactly as an int64 or uint64
+  bool isInteger() const {
+    return (type == number) && (length != NumberValue::floating);
+  }
+  /// Render as number
+  template <typename T> explicit operator T() const {
+    assert(type == number);
+    switch (length) {
+    case NumberValue::signedInt:
+      return static_cast<T>(value.as_int);
+    case NumberValue::unsignedInt:
+      return static_cast<T>(value.as_uint);
+    default:
+      return static_cast<T>(value.as_num);
+    }
+  }
+  explicit operator bool() const {
+    switch (type) {
+    case null:
+      return false;
+    case boolean:
+      return value.as_bool;
+    case number:
+      return isInteger() ? value.as_uint != 0 : value.as_num != 0;
+    case text:
+    case map:
+    case list:
+      return length != 0;
+    }
+    return false;
+  }
+  /// The string, without copying it
+  StringView str() const {
+    assert(type == text);
+    return {value.as_text, value.as_text + length};
+  }
+  /// Copies the string out
+  operator std::string() const { return str(); }
+
+  /// Number of entries in a list or map
+  size_t size() const {
+    assert((type == list) || (type == map));
+    return length;
+  }
+  ViewRange<JView> items() const {
+    assert(type == list);
+    return {value.as_list, value.as_list + length};
+  }
+  inline ViewRange<JViewMember> members() const;
+
+  const JView &operator[](size_t i) const {
+    assert(type == list);
+    assert(i < length);
+    return value.as_list[i];
+  }
+  const JView &at(size_t i) const {
+    assert(type == list);
+    if (i >= length)
+      throw std::out_of_range("JView list index out of range");
+    return value.as_list[i];
+  }
+
+  /// Returns the member called 'key', or members().end() if there isn't one
+  inline const JViewMember *find(const std::string &key) const;
+  inline const JView &at(const std::string &key) const;
+  const JView &operator[](const std::string &key) const { return at(key); }
+};
+
+/// An entry in a JView map
+struct JViewMember {
+  StringView key;
+  JView value;
+};
+
+inline ViewRange<JViewMember> JView::members() const {
+  assert(type == map);
+  return {value.as_map, value.as_map + length};
+}
+
+inline const JViewMember *JView::find(const std::string &key) const {
+  assert(type == map);
+  for (const JViewMember &member : members())
+    if (equals(member.key, key.data(), key.size()))
+      return &member;
+  return members().end();
+}
+
+inline const JView &JView::at(const std::string &key) const {
+  const JViewMember *found = find(key);
+  if (found == members().end())
+    throw std::out_of_range("JView map has no key '" + key + "'");
+  return found->value;
+}
+
+/// Owns the memory behind a tree of JViews (but not the input text)
+class JDocument {
+public:
+  JDocument() = default;
+  JDocument(JDocument &&) = default;
+  JDocument &operator=(JDocument &&) = default;
+
+  const JView &root() const { return _root; }
+  Arena &arena() { return _arena; }
+  const Arena &arena() const { return _arena; }
+  void setRoot(JView root) { _root = root; }
+
+private:
+  Arena _arena;
+  JView _root;
+};
+
+} // namespace json
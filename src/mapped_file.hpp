@@ -0,0 +1,140 @@
+/// Reads json files by mapping them into memory
+///
+/// Loading a file into a std::string through an istreambuf_iterator copies it
+/// a char at a time and grows the string over and over on the way. Mapping it
+/// instead lets the kernel page it in as the parser walks through it, and
+/// hands the parser a plain const char* range, so it gets the vectorized
+/// scanners too.
+///
+///     JSON config = readFile("config.json");
+///
+///     // Or with any of the other readers:
+///     MappedFile file("big.json");
+///     auto status = make_status(file.begin(), file.end());
+///     readSAX(status, handler);
+#pragma once
+
+#include "parse_to_json_class.hpp"
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace json {
+
+/// A read only view of a whole file. Where there's no mmap, the file is read
+/// into memory instead.
+class MappedFile {
+public:
+  /// Maps the file at 'path'; throws std::system_error if it can't
+  explicit MappedFile(const std::string &path) {
+#ifdef JSON_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      fail(path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      int error = errno;
+      ::close(fd);
+      errno = error;
+      fail(path);
+    }
+    _size = static_cast<size_t>(info.st_size);
+    if (_size) {
+      void *mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        fail(path);
+      }
+      // We read it front to back, so the kernel can read ahead and drop the
+      // pages behind us
+      ::madvise(mapped, _size, MADV_SEQUENTIAL);
+      _data = static_cast<const char *>(mapped);
+    }
+    ::close(fd); // The mapping keeps the file open
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      fail(path);
+    contents.assign(std::istreambuf_iterator<char>(file.rdbuf()),
+                    std::istreambuf_iterator<char>());
+    _data = contents.data();
+    _size = contents.size();
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept { swap(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~MappedFile() {
+#ifdef JSON_HAVE_MMAP
+    if (_size)
+      ::munmap(const_cast<char *>(_data), _size);
+#endif
+  }
+
+  const char *data() const { return _data; }
+  size_t size() const { return _size; }
+  const char *begin() const { return _data; }
+  const char *end() const { return _data + _size; }
+
+private:
+  const char *_data = "";
+  size_t _size = 0;
+#ifndef JSON_HAVE_MMAP
+  std::string contents;
+#endif
+
+  void swap(MappedFile &other) noexcept {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+#ifndef JSON_HAVE_MMAP
+    contents.swap(other.contents);
+    // Short strings live inside the std::string, so they moved
+    _data = contents.data();
+    other._data = other.contents.data();
+#endif
+  }
+
+  [[noreturn]] static void fail(const std::string &path) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Couldn't read " + path);
+  }
+};
+
+/**
+ * @brief Reads a json file into a JSON tree
+ *
+ * @param path The file to read; it's mapped into memory rather than copied
+ * @param onError Called with parser errors
+ *
+ * @return The read value
+ */
+inline JSON readFile(const std::string &path,
+                     ErrorThrower<const char *> onError =
+                         throwError<const char *>) {
+  MappedFile file(path);
+  return readValue(file.begin(), file.end(), onError);
+}
+
+} // namespace json
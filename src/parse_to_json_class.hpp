@@ -1,6 +1,11 @@
 /// Parses incoming json into json_classes
+///
+/// readValue() reads utf-8, utf-16 and utf-32 (see encoding.hpp). utf-8 is
+/// parsed where it lies; wide text is converted to utf-8 a block at a time and
+/// pushed through a PushParser, so it's never all copied.
 #pragma once
 
+#include "encoding.hpp"
 #include "json_class.hpp"
 
 #include "parser/array.hpp"
@@ -8,19 +13,49 @@
 #include "parser/number.hpp"
 #include "parser/object.hpp"
 #include "parser/outer.hpp"
+#include "parser/push.hpp"
+#include "parser/sax.hpp"
 #include "parser/status.hpp"
 #include "parser/string.hpp"
 #include "parser/utils.hpp"
 
 #include <cassert>
+#include <type_traits>
+#include <vector>
 
 namespace json {
 
-template <typename Status>
-inline JSON readValue(Status& status, Token token=ERROR) {
+/// Makes a JSON number, keeping integers exact
+template <typename JSON> inline JSON toJSON(const NumberValue &number) {
+  switch (number.kind) {
+  case NumberValue::signedInt:
+    return number.asInt;
+  case NumberValue::unsignedInt:
+    return number.asUInt;
+  case NumberValue::floating:
+    return number.asDouble;
+  }
+  return {};
+}
+
+/**
+* @brief Reads the next value into a JSON tree that uses 'alloc'
+*
+* @param status The parser status
+* @param alloc Every string, list and map in the result gets a copy of this
+* @param token The token for the value, if the caller already read it
+*/
+template <typename Allocator, typename Status>
+inline basic_JSON<Allocator> readValue(Status &status, const Allocator &alloc,
+                                       Token token = ERROR) {
   BOOST_HANA_CONSTANT_ASSERT(is_valid_status(status));
   BOOST_HANA_CONSTANT_ASSERT(is_forward_iterator(status.p));
 
+  using JSON = basic_JSON<Allocator>;
+  using JList = typename JSON::JList;
+  using JMap = typename JSON::JMap;
+  using String = typename JSON::string;
+
   if (token == ERROR)
     token = require(valueTokens(), status);
   switch (token) {
@@ -30,25 +65,35 @@ inline JSON readValue(Status& status, Token token=ERROR) {
   case boolean:
     return {readBoolean(status), 0};
   case array: {
-    JList result;
+    JList result{typename JList::allocator_type(alloc)};
     readArray(status, [&](Token t) {
-      result.push_back(readValue(status, t));
+      result.push_back(readValue(status, alloc, t));
     });
     return result;
   }
   case object: {
-    JMap result;
-    std::string lastAttr;
-    readObject(status, [&](std::string attr) { lastAttr = attr; },
-    [&](Token t) {
-      result[lastAttr] = readValue(status, t);
-    });
+    // Keys are decoded straight into strings that use 'alloc'. Entries stay
+    // in source order; a repeated key keeps its first position and last value
+    JMap result{typename JMap::allocator_type(alloc)};
+    for (;;) {
+      if (require({OBJECT_END, string}, status) != string)
+        break;
+      String key{typename String::allocator_type(alloc)};
+      appendDecodedString(status, key);
+      require(COLON, status);
+      result.insert_or_assign(std::move(key), readValue(status, alloc));
+      if (require({COMMA, OBJECT_END}, status) != COMMA)
+        break;
+    }
     return result;
   }
   case number:
-    return readNumber<double>(status);
-  case string:
-    return decodeString(status);
+    return toJSON<JSON>(readNumberValue(status));
+  case string: {
+    String result{typename String::allocator_type(alloc)};
+    appendDecodedString(status, result);
+    return result;
+  }
   case HIT_END:
   case COMMA:
   case COLON:
@@ -56,15 +101,135 @@ inline JSON readValue(Status& status, Token token=ERROR) {
   case OBJECT_END:
   case ERROR:
     assert("Code shouldn't reach here because 'requrie' should throw on bad tokens");
-    return ERROR;
+    return {};
   }
   assert("Code shouldn't reach here because 'requrie' should throw on bad tokens");
-  return ERROR;
+  return {};
+}
+
+template <typename Status>
+inline JSON readValue(Status& status, Token token=ERROR) {
+  return readValue(status, std::allocator<char>(), token);
+}
+
+/**
+ * @brief A SAX handler that builds a JSON tree from the events it gets
+ *
+ * It keeps the first top level value, and ignores any that come after it.
+ */
+template <typename Allocator> class JSONBuilder : public SAXHandler {
+public:
+  using JSON = basic_JSON<Allocator>;
+  using JList = typename JSON::JList;
+  using JMap = typename JSON::JMap;
+  using String = typename JSON::string;
+
+  explicit JSONBuilder(const Allocator &alloc = Allocator()) : alloc(alloc) {}
+
+  void onNull() { add(JSON()); }
+  void onBoolean(bool value) { add(JSON(value, 0)); }
+  void onNumber(const NumberValue &value) { add(toJSON<JSON>(value)); }
+  void onString(const SAXString &value) {
+    add(String(value.begin(), value.end(), alloc));
+  }
+  void onKey(const SAXString &key) { keys.back().assign(key.begin(), key.end()); }
+  void onStartObject() {
+    open.emplace_back(JMap{typename JMap::allocator_type(alloc)});
+    keys.emplace_back(typename String::allocator_type(alloc));
+  }
+  void onEndObject() {
+    keys.pop_back();
+    close();
+  }
+  void onStartArray() {
+    open.emplace_back(JList{typename JList::allocator_type(alloc)});
+  }
+  void onEndArray() { close(); }
+
+  /// True once a whole top level value has been read
+  bool done() const { return _done; }
+  JSON &result() { return _result; }
+
+private:
+  Allocator alloc;
+  JSON _result;
+  bool _done = false;
+  /// The arrays and objects that we're inside
+  std::vector<JSON> open;
+  /// The latest key of each object that we're inside
+  std::vector<String> keys;
+
+  void add(JSON &&value) {
+    if (open.empty()) {
+      if (!_done)
+        _result = std::move(value);
+      _done = true;
+    } else if (open.back().whatIs() == JSON::list)
+      static_cast<JList &>(open.back()).push_back(std::move(value));
+    else
+      static_cast<JMap &>(open.back())
+          .insert_or_assign(String(keys.back()), std::move(value));
+  }
+
+  void close() {
+    JSON value = std::move(open.back());
+    open.pop_back();
+    add(std::move(value));
+  }
+};
+
+/**
+* @brief Reads utf-16 or utf-32 json, converting it to utf-8 a block at a time
+*
+* @param begin The first byte of the json
+* @param end One past its last byte
+* @param encoding How it's encoded; see detectEncoding()
+* @param onError Called with parser errors, and where in [begin, end) they
+*                came from
+*
+* @return The read object
+*/
+inline JSON readWideValue(const char *begin, const char *end, Encoding encoding,
+                          ErrorThrower<const char *> onError =
+                              throwError<const char *>) {
+  UTF8Blocks blocks(begin + byteOrderMarkSize(begin, end, encoding), end,
+                    encoding);
+  JSONBuilder<std::allocator<char>> builder;
+  // How much utf-8 came before the current block
+  size_t fed = 0;
+  PushParser<JSONBuilder<std::allocator<char>>> push(
+      builder, [&](std::string msg, const char *at) {
+        // Like the utf-8 reader, we stop after the first value, so anything
+        // after it in the same block isn't an error
+        if (!onError || builder.done())
+          return;
+        // Errors in tokens that started in an earlier block get the start of
+        // this one; that block's gone
+        const size_t offset = push.offsetOf(at);
+        if (!at)
+          onError(std::move(msg), end);
+        else if (offset < fed)
+          onError(std::move(msg), blocks.source(blocks.data()));
+        else
+          onError(std::move(msg),
+                  blocks.source(blocks.data() + (offset - fed)));
+      });
+  while (!builder.done() && blocks.next()) {
+    push.feed(blocks.data(), blocks.size());
+    fed += blocks.size();
+  }
+  if (!builder.done())
+    push.finish();
+  return std::move(builder.result());
 }
 
 /**
 * @brief Reads json using iterators. Outputs a json::JSON object
 *
+* If the iterators point into one contiguous block of chars, the encoding is
+* worked out from the first few bytes (see encoding.hpp); utf-16 and utf-32
+* are converted as they're read. Other iterators are read as utf-8.
+*
 * @tparam Iterator The type of iterator that we'll be reading from
 * @param jsonStart The start of the json stream
 * @param jsonEnd The end of the json stream
@@ -74,8 +239,77 @@ inline JSON readValue(Status& status, Token token=ERROR) {
 template <typename Iterator>
 JSON readValue(Iterator jsonStart, Iterator jsonEnd,
                ErrorThrower<Iterator> onError = throwError<Iterator>) {
-  auto status = make_status(jsonStart, jsonEnd, onError);
-  return readValue(status);
+  return hana::if_(
+      is_contiguous_iterator(jsonStart),
+      [](auto jsonStart, auto jsonEnd, const auto &onError) {
+        const char *begin = (jsonStart == jsonEnd) ? nullptr : &*jsonStart;
+        const char *end = begin + (jsonEnd - jsonStart);
+        const Encoding encoding = detectEncoding(begin, end);
+        if (encoding != Encoding::utf8)
+          return readWideValue(begin, end, encoding,
+                               [&](std::string msg, const char *at) {
+                                 if (onError)
+                                   onError(std::move(msg),
+                                           jsonStart + (at - begin));
+                               });
+        auto status = make_status(
+            jsonStart + byteOrderMarkSize(begin, end, encoding), jsonEnd,
+            onError);
+        return readValue(status);
+      },
+      [](auto jsonStart, auto jsonEnd, const auto &onError) {
+        auto status = make_status(jsonStart, jsonEnd, onError);
+        return readValue(status);
+      })(jsonStart, jsonEnd, onError);
+}
+
+/// Types that hold utf-16 or utf-32 text
+template <typename T>
+struct is_wide_char
+    : std::integral_constant<bool, std::is_same<T, char16_t>::value ||
+                                       std::is_same<T, char32_t>::value ||
+                                       std::is_same<T, wchar_t>::value> {};
+
+/**
+* @brief Reads json held in char16_t (as utf-16), char32_t (as utf-32) or
+* wchar_t (as whichever fits)
+*
+* @param jsonStart The start of the json
+* @param jsonEnd One past the end of the json
+*
+* @return The read object
+*/
+template <typename Unit,
+          typename std::enable_if<is_wide_char<Unit>::value>::type * = nullptr>
+JSON readValue(const Unit *jsonStart, const Unit *jsonEnd,
+               ErrorThrower<const Unit *> onError = throwError<const Unit *>) {
+  const char *begin = reinterpret_cast<const char *>(jsonStart);
+  const char *end = reinterpret_cast<const char *>(jsonEnd);
+  return readWideValue(begin, end, nativeEncoding<Unit>(),
+                       [&](std::string msg, const char *at) {
+                         if (onError)
+                           onError(std::move(msg),
+                                   jsonStart + (at - begin) / sizeof(Unit));
+                       });
+}
+
+/**
+* @brief Reads json using iterators, reporting bad json in the result instead of
+* throwing
+*
+* @return The read object, or null and the first error with its offset
+*/
+template <typename Iterator>
+ParseResult<JSON> tryReadValue(Iterator jsonStart, Iterator jsonEnd) {
+  FirstError<Iterator> error;
+  auto status =
+      make_status(jsonStart, jsonEnd, RecordErrors<Iterator>(error));
+  ParseResult<JSON> result;
+  result.value = readValue(status);
+  setError(result, jsonStart, error);
+  if (!result)
+    result.value = JSON();
+  return result;
 }
 
 auto is_container = hana::is_valid(
@@ -98,4 +332,22 @@ JSON readValue(T &&source, ErrorThrower<decltype(source.begin())> onError =
                                throwError<decltype(source.begin())>) {
   return readValue(source.begin(), source.end(), onError);
 }
+
+/**
+* @brief Reads json into a tree that lives in its own arena
+*
+* @param jsonStart The start of the json stream
+* @param jsonEnd The end of the json stream
+*
+* @return The read document; its nodes are freed all at once when it's
+*         destroyed
+*/
+template <typename Iterator>
+ArenaJSON readArenaValue(Iterator jsonStart, Iterator jsonEnd,
+                         ErrorThrower<Iterator> onError = throwError<Iterator>) {
+  ArenaJSON result;
+  auto status = make_status(jsonStart, jsonEnd, onError);
+  result.root() = readValue(status, result.allocator());
+  return result;
+}
 }
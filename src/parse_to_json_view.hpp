@@ -0,0 +1,149 @@
+/// Parses incoming json into a borrowed JDocument, without copying strings
+#pragma once
+
+#include "json_view.hpp"
+
+#include "parser/array.hpp"
+#include "parser/error.hpp"
+#include "parser/number.hpp"
+#include "parser/outer.hpp"
+#include "parser/status.hpp"
+#include "parser/string.hpp"
+#include "parser/utils.hpp"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace json {
+
+/// Scratch space used while reading a JDocument. The vectors are used as
+/// stacks, so one allocation serves every list and map in the document.
+struct ViewBuilder {
+  ViewBuilder(Arena &arena) : arena(arena) {}
+  Arena &arena;
+  std::vector<JView> items;         // Entries of the lists being read
+  std::vector<JViewMember> members; // Entries of the maps being read
+  std::string scratch;              // Escaped strings are decoded here first
+};
+
+/**
+ * @brief Reads a string without copying it, if it has no escapes
+ *
+ * @param status The parser status, just after the opening '"'
+ * @param builder Escaped strings are decoded into the builder's arena
+ * @returns A view of the string in the input, or in the arena
+ */
+template <typename Status>
+StringView readStringView(Status &status, ViewBuilder &builder) {
+  BOOST_HANA_CONSTANT_ASSERT(is_contiguous_iterator(status.p));
+  auto begin = status.p;
+  auto end = findEndOfUnchangedCharBlock(begin, status.pe);
+  if ((end != status.pe) && (*end == '"')) {
+    status.p = end + 1;
+    return {&*begin, &*begin + (end - begin)};
+  }
+  builder.scratch.clear();
+  decodeContiguousString(status, builder.scratch);
+  const char *copy =
+      builder.arena.copy(builder.scratch.data(), builder.scratch.size());
+  return {copy, copy + builder.scratch.size()};
+}
+
+/// Moves the top 'count' entries of a builder stack into the arena
+template <typename T>
+const T *moveToArena(std::vector<T> &stack, size_t first, Arena &arena) {
+  size_t count = stack.size() - first;
+  T *result = arena.allocateArray<T>(count);
+  std::uninitialized_copy(stack.begin() + first, stack.end(), result);
+  stack.resize(first);
+  return result;
+}
+
+template <typename Status>
+inline JView readView(Status &status, ViewBuilder &builder,
+                      Token token = ERROR) {
+  BOOST_HANA_CONSTANT_ASSERT(is_valid_status(status));
+
+  if (token == ERROR)
+    token = require(valueTokens(), status);
+  switch (token) {
+  case null:
+    readNull(status);
+    return {};
+  case boolean:
+    return {readBoolean(status), 0};
+  case array: {
+    size_t first = builder.items.size();
+    readArray(status, [&](Token t) {
+      JView item = readView(status, builder, t);
+      builder.items.push_back(item);
+    });
+    size_t size = builder.items.size() - first;
+    return {moveToArena(builder.items, first, builder.arena), size};
+  }
+  case object: {
+    size_t first = builder.members.size();
+    for (;;) {
+      if (require({OBJECT_END, string}, status) != string)
+        break;
+      StringView key = readStringView(status, builder);
+      require(COLON, status);
+      JView value = readView(status, builder);
+      builder.members.push_back({key, value});
+      if (require({COMMA, OBJECT_END}, status) != COMMA)
+        break;
+    }
+    size_t size = builder.members.size() - first;
+    return {moveToArena(builder.members, first, builder.arena), size};
+  }
+  case number:
+    return readNumberValue(status);
+  case string:
+    return readStringView(status, builder);
+  case HIT_END:
+  case COMMA:
+  case COLON:
+  case ARRAY_END:
+  case OBJECT_END:
+  case ERROR:
+    assert("Code shouldn't reach here because 'require' should throw on bad tokens");
+    return {};
+  }
+  assert("Code shouldn't reach here because 'require' should throw on bad tokens");
+  return {};
+}
+
+/**
+* @brief Reads json into a borrowed document
+*
+* Strings without escapes are not copied; the document points into
+* [jsonStart, jsonEnd), which must stay alive (and unchanged) for as long as
+* the document is used.
+*
+* @param jsonStart The start of the json text
+* @param jsonEnd One past the end of the json text
+*
+* @return The document that owns the tree of values
+*/
+inline JDocument readDocument(const char *jsonStart, const char *jsonEnd,
+                              ErrorThrower<const char *> onError =
+                                  throwError<const char *>) {
+  JDocument result;
+  ViewBuilder builder(result.arena());
+  auto status = make_status(jsonStart, jsonEnd, onError);
+  result.setRoot(readView(status, builder));
+  return result;
+}
+
+inline JDocument readDocument(const std::string &source,
+                              ErrorThrower<const char *> onError =
+                                  throwError<const char *>) {
+  return readDocument(source.data(), source.data() + source.size(), onError);
+}
+
+/// The document would point into a string that's about to be destroyed
+JDocument readDocument(std::string &&source,
+                       ErrorThrower<const char *> onError =
+                           throwError<const char *>) = delete;
+}
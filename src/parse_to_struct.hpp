@@ -0,0 +1,340 @@
+/// Parses json straight into your own structs, with no JSON tree in between
+///
+/// Declare the members with BOOST_HANA_DEFINE_STRUCT, and readStruct() fills
+/// them in from the object members with the same names:
+///
+///     struct AuthToken {
+///       BOOST_HANA_DEFINE_STRUCT(AuthToken,
+///         (std::string, id),
+///         (std::string, expires));
+///     };
+///     AuthToken token = readStruct<AuthToken>(json.begin(), json.end());
+///
+/// Members can be bools, numbers, std::string, std::vector and
+/// std::map<std::string, ...> of those, other such structs, or JSON for parts
+/// with no fixed shape. Keys are looked up in a perfect hash table that is
+/// worked out at compile time. Members that aren't in the json keep their
+/// value, as do members whose json value is null. Keys that aren't members are
+/// skipped without being decoded.
+#pragma once
+
+#include "parse_to_json_class.hpp"
+
+#include "parser/array.hpp"
+#include "parser/error.hpp"
+#include "parser/number.hpp"
+#include "parser/outer.hpp"
+#include "parser/skip.hpp"
+#include "parser/status.hpp"
+#include "parser/string.hpp"
+#include "parser/utils.hpp"
+
+#include <boost/hana.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace json {
+
+namespace hana = boost::hana;
+
+namespace detail {
+
+/// Hashes a key; the seed is picked at compile time so that a struct's keys
+/// don't collide
+constexpr uint32_t hashKey(const char *key, size_t size, uint32_t seed) {
+  uint32_t hash = seed ^ (static_cast<uint32_t>(size) * 0x9e3779b9u);
+  for (size_t i = 0; i < size; ++i)
+    hash = (hash ^ static_cast<unsigned char>(key[i])) * 16777619u;
+  return hash ^ (hash >> 15);
+}
+
+/// Fits 'count' keys with few enough seeds to try: the power of 2 that's at
+/// least twice as big
+constexpr size_t hashTableSize(size_t count) {
+  size_t size = 1;
+  while (size < count * 2)
+    size *= 2;
+  return size;
+}
+
+/**
+ * @brief A perfect hash table from key to member index, made at compile time
+ *
+ * @tparam Count How many keys
+ */
+template <size_t Count> struct KeyTable {
+  static constexpr size_t tableSize = hashTableSize(Count);
+
+  const char *names[Count ? Count : 1] = {};
+  size_t sizes[Count ? Count : 1] = {};
+  /// The member index for each hash slot, or -1
+  int slots[tableSize] = {};
+  uint32_t seed = 0;
+
+  constexpr KeyTable(const char *const (&keys)[Count ? Count : 1]) {
+    for (size_t i = 0; i < Count; ++i) {
+      names[i] = keys[i];
+      sizes[i] = length(keys[i]);
+    }
+    // Try seeds until no two keys land in the same slot
+    while (!tryPlace())
+      ++seed;
+  }
+
+  /// The index of the member called [key, key + size), or -1 if there isn't
+  /// one
+  int find(const char *key, size_t size) const {
+    const int index = slots[hashKey(key, size, seed) & (tableSize - 1)];
+    if ((index >= 0) && (sizes[index] == size) &&
+        (std::memcmp(names[index], key, size) == 0))
+      return index;
+    return -1;
+  }
+
+private:
+  static constexpr size_t length(const char *key) {
+    size_t result = 0;
+    while (key[result])
+      ++result;
+    return result;
+  }
+
+  constexpr bool tryPlace() {
+    for (int &slot : slots)
+      slot = -1;
+    for (size_t i = 0; i < Count; ++i) {
+      int &slot = slots[hashKey(names[i], sizes[i], seed) & (tableSize - 1)];
+      if (slot != -1)
+        return false;
+      slot = static_cast<int>(i);
+    }
+    return true;
+  }
+};
+
+template <typename T>
+using StructKeys = decltype(hana::keys(std::declval<T>()));
+
+template <typename T>
+constexpr size_t structSize = hana::value<decltype(
+    hana::length(std::declval<StructKeys<T>>()))>();
+
+template <typename T, size_t... I>
+constexpr KeyTable<structSize<T>> makeKeyTable(std::index_sequence<I...>) {
+  const char *const keys[structSize<T> ? structSize<T> : 1] = {hana::to<
+      const char *>(std::decay_t<decltype(
+      hana::at_c<I>(std::declval<StructKeys<T>>()))>{})...};
+  return KeyTable<structSize<T>>(keys);
+}
+
+/// The key table for a hana struct
+template <typename T> struct StructInfo {
+  static constexpr KeyTable<structSize<T>> keys =
+      makeKeyTable<T>(std::make_index_sequence<structSize<T>>());
+};
+template <typename T>
+constexpr KeyTable<structSize<T>> StructInfo<T>::keys;
+
+} // namespace detail
+
+template <typename Status>
+void readInto(Status &status, bool &out, Token token = ERROR);
+template <typename Status, typename T>
+std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+readInto(Status &status, T &out, Token token = ERROR);
+template <typename Status, typename Traits, typename Allocator>
+void readInto(Status &status, std::basic_string<char, Traits, Allocator> &out,
+              Token token = ERROR);
+template <typename Status, typename T, typename Allocator>
+void readInto(Status &status, std::vector<T, Allocator> &out,
+              Token token = ERROR);
+template <typename Status, typename T, typename Compare, typename Allocator>
+void readInto(Status &status,
+              std::map<std::string, T, Compare, Allocator> &out,
+              Token token = ERROR);
+template <typename Status, typename Allocator>
+void readInto(Status &status, basic_JSON<Allocator> &out, Token token = ERROR);
+template <typename Status, typename T>
+std::enable_if_t<hana::Struct<T>::value> readInto(Status &status, T &out,
+                                                  Token token = ERROR);
+
+namespace detail {
+
+/// Reads the next value's token, if the caller hasn't. Returns false for null,
+/// which leaves the value as it was.
+template <typename Status>
+inline bool startValue(Status &status, Token &token, Token expected) {
+  if (token == ERROR)
+    token = require(valueTokens(), status);
+  if (token == null) {
+    readNull(status);
+    return false;
+  }
+  if (token != expected) {
+    status.onError(ErrorCode::unexpectedToken, [expected, token]() {
+      return std::string("Expected '") + static_cast<char>(expected) +
+             "' but got '" + static_cast<char>(token) + "' instead";
+    });
+    return false;
+  }
+  return true;
+}
+
+/// Reads the value of member 'I'
+template <size_t I, typename Status, typename T>
+void readMember(Status &status, T &out) {
+  auto &&accessor = hana::second(hana::at_c<I>(hana::accessors<T>()));
+  readInto(status, accessor(out));
+}
+
+/// Reads the value of a member, picked by index at runtime
+template <typename Status, typename T, size_t... I>
+void readMemberAt(Status &status, T &out, int index,
+                  std::index_sequence<I...>) {
+  using Reader = void (*)(Status &, T &);
+  static const Reader readers[] = {&readMember<I, Status, T>...};
+  readers[index](status, out);
+}
+
+} // namespace detail
+
+/// Reads a boolean
+template <typename Status>
+void readInto(Status &status, bool &out, Token token) {
+  if (detail::startValue(status, token, boolean))
+    out = readBoolean(status);
+}
+
+/// Reads a number of any c++ number type; numbers out of its range are an
+/// error
+template <typename Status, typename T>
+std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+readInto(Status &status, T &out, Token token) {
+  if (!detail::startValue(status, token, number))
+    return;
+  const NumberValue value = readNumberValue(status);
+  if (value.template fits<T>())
+    out = value.template as<T>();
+  else
+    status.onError(ErrorCode::badNumber,
+                   "Number is out of range for the type it's read into");
+}
+
+/// Reads a string
+template <typename Status, typename Traits, typename Allocator>
+void readInto(Status &status, std::basic_string<char, Traits, Allocator> &out,
+              Token token) {
+  if (detail::startValue(status, token, string)) {
+    out.clear();
+    appendDecodedString(status, out);
+  }
+}
+
+/// Reads an array, replacing what was in 'out'
+template <typename Status, typename T, typename Allocator>
+void readInto(Status &status, std::vector<T, Allocator> &out, Token token) {
+  if (!detail::startValue(status, token, array))
+    return;
+  out.clear();
+  readArray(status, [&](Token t) {
+    // Not straight into out.back(), which is a proxy for std::vector<bool>
+    T value{};
+    readInto(status, value, t);
+    out.push_back(std::move(value));
+  });
+}
+
+/// Reads an object with any keys, replacing what was in 'out'
+template <typename Status, typename T, typename Compare, typename Allocator>
+void readInto(Status &status,
+              std::map<std::string, T, Compare, Allocator> &out, Token token) {
+  if (!detail::startValue(status, token, object))
+    return;
+  out.clear();
+  std::string key;
+  readObject(status, [&](std::string &&name) { key = std::move(name); },
+             [&](Token t) { readInto(status, out[key], t); });
+}
+
+/// Reads a value with no fixed shape into a JSON tree
+template <typename Status, typename Allocator>
+void readInto(Status &status, basic_JSON<Allocator> &out, Token token) {
+  out = readValue(status, Allocator(), token);
+}
+
+/**
+ * @brief Reads an object into a struct declared with BOOST_HANA_DEFINE_STRUCT
+ *
+ * @param status The parser status
+ * @param out Each member whose name is a key in the object gets its value
+ * @param token The value's token, if the caller already read it
+ */
+template <typename Status, typename T>
+std::enable_if_t<hana::Struct<T>::value> readInto(Status &status, T &out,
+                                                  Token token) {
+  if (!detail::startValue(status, token, object))
+    return;
+  const auto &keys = detail::StructInfo<T>::keys;
+  // Reused for each key; short keys don't allocate at all
+  std::string key;
+  for (;;) {
+    if (require({OBJECT_END, string}, status) != string)
+      break;
+    key.clear();
+    appendDecodedString(status, key);
+    require(COLON, status);
+    const int index = keys.find(key.data(), key.size());
+    if (index < 0)
+      skipValue(status);
+    else
+      detail::readMemberAt(
+          status, out, index,
+          std::make_index_sequence<detail::structSize<T>>());
+    if (require({COMMA, OBJECT_END}, status) != COMMA)
+      break;
+  }
+}
+
+/**
+ * @brief Reads json into a struct declared with BOOST_HANA_DEFINE_STRUCT
+ *
+ * @tparam T The struct type; it must be default constructible
+ * @param jsonStart The start of the json stream
+ * @param jsonEnd The end of the json stream
+ *
+ * @return The read struct
+ */
+template <typename T, typename Iterator>
+T readStruct(Iterator jsonStart, Iterator jsonEnd,
+             ErrorThrower<Iterator> onError = throwError<Iterator>) {
+  T result{};
+  auto status = make_status(jsonStart, jsonEnd, onError);
+  readInto(status, result);
+  return result;
+}
+
+/**
+ * @brief Reads json into a struct, reporting bad json in the result instead of
+ * throwing
+ *
+ * @return The struct, and the first error with its offset if there was one.
+ *         On an error the members read before it have been filled in.
+ */
+template <typename T, typename Iterator>
+ParseResult<T> tryReadStruct(Iterator jsonStart, Iterator jsonEnd) {
+  FirstError<Iterator> error;
+  auto status =
+      make_status(jsonStart, jsonEnd, RecordErrors<Iterator>(error));
+  ParseResult<T> result;
+  readInto(status, result.value);
+  setError(result, jsonStart, error);
+  return result;
+}
+
+} // namespace json
@@ -1,19 +1,104 @@
-/* To make an iteratooTo make an iterator*t An iterator wrapper that records a location in column and row coordinates */
+/// An iterator wrapper that can tell you the row and column it's at, so parser
+/// errors can say where they happened
+///
+/// Working out the row and column as we go costs a compare and a branch on
+/// every char, even though we only want them when something goes wrong. So
+/// for forward iterators we just remember where the input started; when an
+/// error is thrown, location() counts the newlines between there and here (64
+/// bytes at a time when the input is contiguous). Input iterators can't be
+/// walked twice, so those still count as they go.
+///
+/// Build with NO_LOCATIONS (cmake -DLOCATIONS=OFF) and LocatingIterator is
+/// just the iterator it wraps; errors come without a location.
 #pragma once
 
 #include "../utils.hpp"
+#include "simd.hpp"
+
+#include <iterator>
+#include <type_traits>
 
 namespace json {
 
+#ifdef NO_LOCATIONS
+
+template <typename Iter, typename traits = std::iterator_traits<Iter>>
+using LocatingIterator = Iter;
+
+template <typename Iter> Iter makeLocating(Iter iter) { return iter; }
+
+#else
+
+namespace detail {
+
+/// Remembers where the input started, and counts rows and columns from there
+/// when it's asked
+template <typename Iter, bool forward = std::is_base_of<
+                             std::forward_iterator_tag,
+                             typename std::iterator_traits<
+                                 Iter>::iterator_category>::value>
+struct Locator {
+  Iter start;
+
+  Locator() = default;
+  Locator(const Iter &start) : start(start) {}
+
+  void step(const Iter &) {}
+
+  simd::TextLocation locate(const Iter &here) const {
+    return hana::if_(is_contiguous_iterator(here),
+                     [](const auto &start, const auto &here) {
+                       if (start == here)
+                         return simd::TextLocation{1, 1};
+                       const char *begin = &*start;
+                       return simd::locate(begin, begin + (here - start));
+                     },
+                     [](auto p, const auto &here) {
+                       simd::TextLocation result{1, 1};
+                       for (; p != here; ++p) {
+                         if (*p == '\n') {
+                           ++result.row;
+                           result.col = 1;
+                         } else
+                           ++result.col;
+                       }
+                       return result;
+                     })(start, here);
+  }
+};
+
+/// Input iterators can only be read once, so we have to count as we go
+template <typename Iter> struct Locator<Iter, false> {
+  simd::TextLocation where{1, 1};
+
+  Locator() = default;
+  Locator(const Iter &) {}
+
+  /// Called just before 'here' moves on
+  void step(const Iter &here) {
+    if (*here == '\n') {
+      ++where.row;
+      where.col = 1;
+    } else
+      ++where.col;
+  }
+
+  simd::TextLocation locate(const Iter &) const { return where; }
+};
+
+} // namespace detail
+
 /* I didn't use boost::iterator_adaptor because it had doesn't work with ifstream_iterator.
  * DIY Iterator based on the chart: http://www.cplusplus.com/reference/iterator/
  *
  * # All Categories
- *  1. Copy Constructable, assignable and deconstructible 
+ *  1. Copy Constructable, assignable and deconstructible
  *  2. Can be incremented
  * # Input
  *  3. == and !=
  *  4. *a and a->m
+ * # Random access (only usable if Iter is random access)
+ *  5. a + n, a - n, a += n, a -= n and a - b
  */
 
 template <typename Iter, typename traits = std::iterator_traits<Iter>>
@@ -25,48 +110,28 @@ struct LocatingIterator : public Iter  {
   using reference = typename traits::reference;
   using iterator_category = typename traits::iterator_category;
 
-  int row = 1;
-  int col = 1;
-
   // 1. Copy constructible and copy assignable
 
   LocatingIterator() : Iter() {}
-  LocatingIterator(const Iter &iter) : Iter(iter) {}
-  LocatingIterator(const LocatingIterator &other)
-      : Iter(static_cast<Iter>(other)), row(other.row), col(other.col)  {}
+  LocatingIterator(const Iter &iter) : Iter(iter), locator(iter) {}
+  LocatingIterator(const LocatingIterator &other) = default;
+  LocatingIterator &operator=(const LocatingIterator &other) = default;
 
-  LocatingIterator& operator=(const LocatingIterator& other) {
-    Iter& base(*this);
-    const Iter& otherBase(other);
-    base = otherBase;
-    row = other.row;
-    col = other.col;
-    return *this;
-  }
+  /// The row and column (both from 1) of the char we're pointing at
+  simd::TextLocation location() const { return locator.locate(*this); }
 
   // 2. Can be incremented
-  
-  void inline advance() {
-    if (**this == '\n') {
-      ++row;
-      col = 1;
-    } else {
-      ++col;
-    }
-  }
 
   inline LocatingIterator operator ++(int) {
     LocatingIterator result(*this);
-    Iter& base(*this);
-    ++base;
-    advance();
+    ++*this;
     return result;
   }
 
   inline LocatingIterator &operator++() {
+    locator.step(*this);
     Iter& base(*this);
-    base++;
-    advance();
+    ++base;
     return *this;
   }
 
@@ -85,12 +150,52 @@ struct LocatingIterator : public Iter  {
   }
 
   // 4. *a and a->m (already provided by base class)
-  
+
+  // 5. Random access. These keep the start, where the base class's would
+  // lose it.
+
+  inline LocatingIterator &operator+=(difference_type n) {
+    Iter& base(*this);
+    base += n;
+    return *this;
+  }
+
+  inline LocatingIterator &operator-=(difference_type n) {
+    Iter& base(*this);
+    base -= n;
+    return *this;
+  }
+
+  inline LocatingIterator operator+(difference_type n) const {
+    LocatingIterator result(*this);
+    return result += n;
+  }
+
+  inline LocatingIterator operator-(difference_type n) const {
+    LocatingIterator result(*this);
+    return result -= n;
+  }
+
+  inline difference_type operator-(const LocatingIterator &other) const {
+    const Iter& base(*this);
+    const Iter& otherBase(other);
+    return base - otherBase;
+  }
+
+private:
+  detail::Locator<Iter> locator;
 };
 
+/// A LocatingIterator is as contiguous as the iterator it wraps
+template <typename Iter, typename traits>
+struct is_contiguous_char_iterator<LocatingIterator<Iter, traits>>
+    : is_contiguous_char_iterator<Iter> {};
+
 template <typename Iter>
 LocatingIterator<Iter> makeLocating(Iter iter) {
   return LocatingIterator<Iter>(iter);
 }
 
+#endif
+
 }
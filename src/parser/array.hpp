@@ -8,32 +8,33 @@
 
 namespace json {
 
-/// Convenience function to read an object.
-/// @onVal will be read when the stream is ready to read a value. The function
-///        needs to consume that value from the stream.
-template <typename Status>
-void readArray(Status &status, std::function<void(Token)> onVal) {
-  auto& p = status.p;
-  auto& pe = status.pe;
-  while (p != pe) {
+/// Convenience function to read an array.
+/// @onVal will be called with the value's token when the stream is ready to
+///        read a value. It needs to consume that value from the stream. It's
+///        a template parameter, so lambdas are called directly (and can be
+///        inlined); std::function works too.
+template <typename Status, typename OnVal>
+void readArray(Status &status, OnVal &&onVal) {
+  constexpr TokenSet acceptable = valueTokens() | ARRAY_END;
+  // Each require() either gets a token we want or reports an error; if the
+  // error doesn't throw, we stop there
+  for (;;) {
     // Read the next value
-    auto acceptable = valueTokens();
-    acceptable.insert(ARRAY_END);
     Token token = require(acceptable, status);
-    if (token == ARRAY_END)
+    if ((token == ARRAY_END) || (token == ERROR))
       return;
 #ifndef NDEBUG
     // Forward iterators can be copied then compared
-    auto b4 = p;
+    auto b4 = status.p;
     onVal(token);
-    assert(b4 != p); // onVal must consume one value
+    // onVal must consume one value, unless an error sent us to the end
+    assert((b4 != status.p) || (status.p == status.pe));
 #else
     onVal(token);
 #endif
     // Read the comma or the end of the object
-    token = require({COMMA, ARRAY_END}, status);
-    if (token == ARRAY_END)
-      break;
+    if (require({COMMA, ARRAY_END}, status) != COMMA)
+      return;
   }
 }
 
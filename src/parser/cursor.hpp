@@ -0,0 +1,255 @@
+/// Reads json on demand: step into the objects and arrays you want, read the
+/// values you need, and skip the rest without decoding it
+///
+/// A Cursor sits on one value in the input. Reading it (readString(),
+/// readNumber() ...) consumes it. enterArray() and enterObject() step inside
+/// and return an ArrayCursor or ObjectCursor; their next() moves the same
+/// Cursor on to each element or member in turn. Anything you didn't read, and
+/// anything left in a container you stopped reading, is skipped over when you
+/// move on, with skipValue() from skip.hpp. That only looks at brackets and
+/// string boundaries, so it doesn't check that the skipped json is valid.
+///
+/// Example:
+///
+///     auto status = make_status(json.begin(), json.end());
+///     Cursor<decltype(status)> cursor(status);
+///     auto root = cursor.enterObject();
+///     if (root.find("name"))
+///       name = cursor.readString();
+#pragma once
+
+#include "error.hpp"
+#include "number.hpp"
+#include "outer.hpp"
+#include "skip.hpp"
+#include "status.hpp"
+#include "string.hpp"
+#include "utils.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+namespace json {
+
+template <typename Status> class ArrayCursor;
+template <typename Status> class ObjectCursor;
+
+/// Reads the value that a Status points at, on demand
+template <typename Status> class Cursor {
+public:
+  explicit Cursor(Status &status) : status(status) {}
+
+  /// The type of the value at the cursor: null, boolean, number, string,
+  /// array or object
+  Token type() {
+    if (state == atValue) {
+      token = require(valueTokens(), status);
+      state = tokenRead;
+    }
+    assert(state == tokenRead); // The value was already read
+    return token;
+  }
+
+  void readNull() {
+    expect(null);
+    json::readNull(status);
+  }
+  bool readBoolean() {
+    expect(boolean);
+    return json::readBoolean(status);
+  }
+  NumberValue readNumber() {
+    expect(number);
+    return readNumberValue(status);
+  }
+  template <typename T> T readNumber() {
+    return readNumber().template as<T>();
+  }
+  std::string readString() {
+    std::string result;
+    appendString(result);
+    return result;
+  }
+  /// Decodes the string at the cursor onto the end of 'out'
+  template <typename String> void appendString(String &out) {
+    expect(string);
+    appendDecodedString(status, out);
+  }
+
+  /// Moves past the value at the cursor without decoding it
+  void skip() {
+    type();
+    state = done;
+    skipValue(status, token);
+  }
+
+  /// Steps into the array at the cursor
+  ArrayCursor<Status> enterArray() {
+    expect(array);
+    return ArrayCursor<Status>(*this, ++depth);
+  }
+  /// Steps into the object at the cursor
+  ObjectCursor<Status> enterObject() {
+    expect(object);
+    return ObjectCursor<Status>(*this, ++depth);
+  }
+
+private:
+  friend class ArrayCursor<Status>;
+  friend class ObjectCursor<Status>;
+
+  enum State {
+    atValue,   // Just before a value
+    tokenRead, // We've read the value's token, but not the value
+    done       // The value has been read or skipped
+  };
+
+  Status &status;
+  State state = atValue;
+  Token token = ERROR;
+  /// How many arrays and objects we're inside
+  size_t depth = 0;
+
+  /// Starts reading a value, which must be of type 'expected'
+  void expect(Token expected) {
+    if (type() != expected)
+      status.onError(ErrorCode::unexpectedToken, [expected, this]() {
+        return std::string("Expected '") + static_cast<char>(expected) +
+               "' but got '" + static_cast<char>(token) + "' instead";
+      });
+    state = done;
+  }
+
+  /// Skips whatever's left at this depth and in any containers inside it, so
+  /// that the next token is the next one of the container at 'target'
+  void finishUpTo(size_t target) {
+    if (depth > target) {
+      // An inner array or object was left part way through
+      if (state != done)
+        skip();
+      skipContainers(status, depth - target);
+      depth = target;
+    } else if (state != done)
+      skip();
+  }
+};
+
+/// Walks the elements of an array; see Cursor::enterArray()
+template <typename Status> class ArrayCursor {
+public:
+  ArrayCursor(Cursor<Status> &cursor, size_t depth)
+      : cursor(cursor), depth(depth) {}
+
+  /**
+   * @brief Moves the cursor on to the next element
+   *
+   * Skips whatever's left of the last element first.
+   *
+   * @returns false, with the cursor after the ']', if there are no more
+   */
+  bool next() {
+    if (finished)
+      return false;
+    cursor.finishUpTo(depth);
+    auto &status = cursor.status;
+    Token token = first ? require(valueTokens() | ARRAY_END, status)
+                        : require({COMMA, ARRAY_END}, status);
+    if (token == ARRAY_END) {
+      finished = true;
+      --cursor.depth;
+      cursor.state = Cursor<Status>::done;
+      return false;
+    }
+    if (first) {
+      cursor.token = token;
+      cursor.state = Cursor<Status>::tokenRead;
+    } else
+      cursor.state = Cursor<Status>::atValue;
+    first = false;
+    return true;
+  }
+
+  /// The cursor that each element is read with
+  Cursor<Status> &value() { return cursor; }
+
+private:
+  Cursor<Status> &cursor;
+  size_t depth;
+  bool first = true;
+  bool finished = false;
+};
+
+/// Walks the members of an object; see Cursor::enterObject()
+template <typename Status> class ObjectCursor {
+public:
+  ObjectCursor(Cursor<Status> &cursor, size_t depth)
+      : cursor(cursor), depth(depth) {}
+
+  /**
+   * @brief Moves the cursor on to the value of the next member
+   *
+   * Skips whatever's left of the last value first.
+   *
+   * @returns false, with the cursor after the '}', if there are no more
+   */
+  bool next() {
+    if (finished)
+      return false;
+    cursor.finishUpTo(depth);
+    auto &status = cursor.status;
+    Token token = first ? require({OBJECT_END, string}, status)
+                        : require({COMMA, OBJECT_END}, status);
+    if (token == COMMA)
+      token = require(string, status);
+    first = false;
+    if (token == OBJECT_END) {
+      finished = true;
+      --cursor.depth;
+      cursor.state = Cursor<Status>::done;
+      return false;
+    }
+    _key.clear();
+    appendDecodedString(status, _key);
+    require(COLON, status);
+    cursor.state = Cursor<Status>::atValue;
+    return true;
+  }
+
+  /**
+   * @brief Moves on to the member called 'name', skipping the ones before it
+   *
+   * Members that came before the cursor's current position aren't looked at
+   * again.
+   *
+   * @returns false, with the cursor after the '}', if there's no such member
+   */
+  bool find(const char *name) {
+    const size_t size = std::strlen(name);
+    while (next())
+      if ((_key.size() == size) && (_key.compare(0, size, name) == 0))
+        return true;
+    return false;
+  }
+  bool find(const std::string &name) { return find(name.c_str()); }
+
+  /// The current member's name
+  const std::string &key() const { return _key; }
+
+  /// The cursor that each value is read with
+  Cursor<Status> &value() { return cursor; }
+
+private:
+  Cursor<Status> &cursor;
+  size_t depth;
+  std::string _key;
+  bool first = true;
+  bool finished = false;
+};
+
+/// Makes a Cursor on the next value in 'status'
+template <typename Status> Cursor<Status> makeCursor(Status &status) {
+  return Cursor<Status>(status);
+}
+
+} // namespace json
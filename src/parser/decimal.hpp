@@ -0,0 +1,449 @@
+/// Correctly rounded decimal to double conversion.
+///
+/// Three tiers, fastest first:
+///  1. Clinger's fast path: when the significand and the power of ten are both
+///     exact doubles, one multiply or divide gives the right answer.
+///  2. Eisel-Lemire: multiply the significand by a 128 bit approximation of
+///     the power of ten; it knows when its answer might be wrong.
+///  3. BigDecimal: exact arithmetic on up to 800 decimal digits (the simple
+///     decimal conversion used by Go's strconv). Slow, but only needed for
+///     halfway cases and very long inputs.
+#pragma once
+
+#include "pow10_table.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace json {
+
+static_assert(std::numeric_limits<double>::is_iec559,
+              "We build doubles bit by bit, so they must be IEEE 754");
+
+/// Reinterprets the bits of an IEEE 754 double
+inline double bitsToDouble(uint64_t bits) {
+  double result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+/// Number of leading zero bits in a (non zero) uint64
+inline int countLeadingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#else
+  int result = 0;
+  for (uint64_t bit = uint64_t(1) << 63; !(x & bit); bit >>= 1)
+    ++result;
+  return result;
+#endif
+}
+
+/// The full 128 bit product of two uint64s
+inline void multiply128(uint64_t a, uint64_t b, uint64_t &hi, uint64_t &lo) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  hi = static_cast<uint64_t>(product >> 64);
+  lo = static_cast<uint64_t>(product);
+#else
+  uint64_t aLo = a & 0xFFFFFFFF, aHi = a >> 32;
+  uint64_t bLo = b & 0xFFFFFFFF, bHi = b >> 32;
+  uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+  uint64_t middle = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+  lo = (middle << 32) | (ll & 0xFFFFFFFF);
+  hi = hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+#endif
+}
+
+/**
+ * @brief Clinger's fast path
+ *
+ * @param w The decimal significand
+ * @param q The decimal exponent; the number is w * 10^q
+ * @param result Set to the (correctly rounded) result, if we return true
+ * @returns false if the fast path doesn't apply
+ */
+inline bool clingerFastPath(uint64_t w, int q, bool isNeg, double &result) {
+  // 10^0 .. 10^22 are all exact doubles
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+  const uint64_t maxExact = uint64_t(1) << 53;
+  if (w > maxExact)
+    return false;
+  if ((q < -22) || (q > 22 + 15))
+    return false;
+  double value;
+  if (q < 0)
+    value = static_cast<double>(w) / powers[-q];
+  else if (q <= 22)
+    value = static_cast<double>(w) * powers[q];
+  else {
+    // Move some of the exponent into the significand, if it stays exact
+    for (; q > 22; --q) {
+      if (w > maxExact / 10)
+        return false;
+      w *= 10;
+    }
+    value = static_cast<double>(w) * powers[22];
+  }
+  result = isNeg ? -value : value;
+  return true;
+}
+
+/**
+ * @brief The Eisel-Lemire algorithm
+ *
+ * Works for any w and q, but gives up (returns false) when the 128 bit
+ * approximation isn't enough to be sure of the rounding, and for subnormal
+ * results.
+ */
+inline bool eiselLemire(uint64_t w, int q, bool isNeg, double &result) {
+  if (w == 0) {
+    result = isNeg ? -0.0 : 0.0;
+    return true;
+  }
+  if ((q < pow10TableMin) || (q > pow10TableMax))
+    return false;
+  const uint64_t *power = pow10Table()[q - pow10TableMin];
+
+  // Normalize the significand so its top bit is set
+  int leadingZeros = countLeadingZeros(w);
+  w <<= leadingZeros;
+  // 217706 / 2^16 is log2(10); the shift is floor division
+  uint64_t exponent2 =
+      uint64_t(((217706 * q) >> 16) + 64 + 1023) - uint64_t(leadingZeros);
+
+  uint64_t hi, lo;
+  multiply128(w, power[1], hi, lo);
+  // If the low bits are all ones, the error in the table could carry into
+  // them; bring in the low word of the power of ten too
+  if (((hi & 0x1FF) == 0x1FF) && (lo + w < w)) {
+    uint64_t hi2, lo2;
+    multiply128(w, power[0], hi2, lo2);
+    uint64_t mergedHi = hi, mergedLo = lo + hi2;
+    if (mergedLo < lo)
+      ++mergedHi;
+    if (((mergedHi & 0x1FF) == 0x1FF) && (mergedLo + 1 == 0) && (lo2 + w < w))
+      return false;
+    hi = mergedHi;
+    lo = mergedLo;
+  }
+
+  // Keep 54 bits, then round to 53
+  uint64_t msb = hi >> 63;
+  uint64_t mantissa = hi >> (msb + 9);
+  exponent2 -= 1 ^ msb;
+  // Exactly halfway; we can't tell which way to round
+  if ((lo == 0) && ((hi & 0x1FF) == 0) && ((mantissa & 3) == 1))
+    return false;
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+  if (mantissa >> 53) {
+    mantissa >>= 1;
+    ++exponent2;
+  }
+  // Subnormal, infinite, or out of range
+  if (exponent2 - 1 >= 0x7FF - 1)
+    return false;
+  uint64_t bits = (exponent2 << 52) | (mantissa & 0x000FFFFFFFFFFFFF);
+  if (isNeg)
+    bits |= uint64_t(1) << 63;
+  result = bitsToDouble(bits);
+  return true;
+}
+
+/**
+ * @brief An exact decimal number of up to 800 digits, that can be shifted by
+ * powers of two
+ *
+ * Used to convert the decimals that the fast algorithms can't. The number is
+ * 0.digits * 10^decimalPoint.
+ */
+class BigDecimal {
+public:
+  /// Enough digits to hold any double exactly, and then some
+  static constexpr int maxDigits = 800;
+
+  /// Reads json number text (as already checked by readNumberValue)
+  BigDecimal(const char *p, const char *pe) {
+    if ((p != pe) && (*p == '-')) {
+      isNeg = true;
+      ++p;
+    }
+    bool sawDot = false;
+    for (; p != pe; ++p) {
+      char c = *p;
+      if (c == '.') {
+        sawDot = true;
+        continue;
+      }
+      if ((c < '0') || (c > '9'))
+        break;
+      if (c == '0' && count == 0) {
+        // Leading zeros only move the decimal point, if they're after it
+        if (sawDot)
+          --decimalPoint;
+        continue;
+      }
+      if (!sawDot)
+        ++decimalPoint;
+      if (count < maxDigits)
+        digits[count++] = c - '0';
+      else if (c != '0')
+        truncated = true;
+    }
+    if ((p != pe) && ((*p == 'e') || (*p == 'E'))) {
+      ++p;
+      bool expIsNeg = false;
+      if ((p != pe) && ((*p == '+') || (*p == '-')))
+        expIsNeg = *p++ == '-';
+      int exponent = 0;
+      for (; (p != pe) && (*p >= '0') && (*p <= '9'); ++p)
+        if (exponent < 100000) // Way past infinity or zero already
+          exponent = exponent * 10 + (*p - '0');
+      decimalPoint += expIsNeg ? -exponent : exponent;
+    }
+    trim();
+  }
+
+  /// w * 10^q
+  BigDecimal(uint64_t w, int q, bool isNeg) : isNeg(isNeg) {
+    char buffer[20];
+    int n = 0;
+    for (; w; w /= 10)
+      buffer[n++] = static_cast<char>(w % 10);
+    for (int i = n - 1; i >= 0; --i)
+      digits[count++] = buffer[i];
+    decimalPoint = n + q;
+    trim();
+  }
+
+  /// Converts to the nearest double, rounding halfway cases to even
+  double toDouble() {
+    const int bias = -1023;
+    const int mantissaBits = 52;
+    int exponent = 0;
+    uint64_t mantissa = 0;
+    if (count == 0)
+      exponent = bias;
+    else if (decimalPoint > 310)
+      return infinity();
+    else if (decimalPoint < -330)
+      exponent = bias;
+    else {
+      // How many bits we can shift by to move the decimal point by n digits
+      static const int powers[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+      const int lastPower = sizeof(powers) / sizeof(powers[0]) - 1;
+      // Scale by powers of two until we're in [0.5, 1)
+      while (decimalPoint > 0) {
+        int n = decimalPoint > lastPower ? 27 : powers[decimalPoint];
+        shift(-n);
+        exponent += n;
+      }
+      while ((decimalPoint < 0) || ((decimalPoint == 0) && (digits[0] < 5))) {
+        int n = -decimalPoint > lastPower ? 27 : powers[-decimalPoint];
+        shift(n);
+        exponent -= n;
+      }
+      // Doubles are in [1, 2), not [0.5, 1)
+      --exponent;
+      // Too small for a normal double; make it subnormal
+      if (exponent < bias + 1) {
+        int n = bias + 1 - exponent;
+        shift(-n);
+        exponent += n;
+      }
+      if (exponent - bias >= 0x7FF)
+        return infinity();
+      shift(1 + mantissaBits);
+      mantissa = roundedInteger();
+      // Rounding might have added a bit
+      if (mantissa == uint64_t(2) << mantissaBits) {
+        mantissa >>= 1;
+        ++exponent;
+        if (exponent - bias >= 0x7FF)
+          return infinity();
+      }
+      if (!(mantissa & (uint64_t(1) << mantissaBits)))
+        exponent = bias; // Subnormal
+    }
+    uint64_t bits = mantissa & ((uint64_t(1) << mantissaBits) - 1);
+    bits |= uint64_t((exponent - bias) & 0x7FF) << mantissaBits;
+    if (isNeg)
+      bits |= uint64_t(1) << 63;
+    return bitsToDouble(bits);
+  }
+
+private:
+  /// Biggest shift we can do in one go without overflowing a uint64
+  static constexpr int maxShift = 60;
+
+  // Room for the digits, plus what a left shift can add before we trim
+  unsigned char digits[maxDigits + maxShift / 3 + 1];
+  int count = 0;        // Digits in use
+  int decimalPoint = 0; // Where the decimal point goes, relative to digits[0]
+  bool isNeg = false;
+  bool truncated = false; // True if we dropped non zero digits off the end
+
+  double infinity() const {
+    return isNeg ? -std::numeric_limits<double>::infinity()
+                 : std::numeric_limits<double>::infinity();
+  }
+
+  void trim() {
+    while ((count > 0) && (digits[count - 1] == 0))
+      --count;
+    if (count == 0)
+      decimalPoint = 0;
+  }
+
+  /// Multiplies (k > 0) or divides (k < 0) by 2^|k|
+  void shift(int k) {
+    if (count == 0)
+      return;
+    for (; k > maxShift; k -= maxShift)
+      leftShift(maxShift);
+    for (; k < -maxShift; k += maxShift)
+      rightShift(maxShift);
+    if (k > 0)
+      leftShift(k);
+    else if (k < 0)
+      rightShift(-k);
+  }
+
+  void rightShift(int k) {
+    int read = 0, write = 0;
+    uint64_t n = 0;
+    // Pick up enough leading digits to cover the first shift
+    for (; (n >> k) == 0; ++read) {
+      if (read >= count) {
+        if (n == 0) {
+          count = 0;
+          return;
+        }
+        while ((n >> k) == 0) {
+          n *= 10;
+          ++read;
+        }
+        break;
+      }
+      n = n * 10 + digits[read];
+    }
+    decimalPoint -= read - 1;
+    uint64_t mask = (uint64_t(1) << k) - 1;
+    // Pick up a digit, put down a digit
+    for (; read < count; ++read) {
+      digits[write++] = static_cast<unsigned char>(n >> k);
+      n = (n & mask) * 10 + digits[read];
+    }
+    // Put down the extra digits
+    while (n > 0) {
+      unsigned char digit = static_cast<unsigned char>(n >> k);
+      n = (n & mask) * 10;
+      if (write < maxDigits)
+        digits[write++] = digit;
+      else if (digit > 0)
+        truncated = true;
+    }
+    count = write;
+    trim();
+  }
+
+  void leftShift(int k) {
+    // 2^k has at most k/3 + 1 digits, so that's all the room we need
+    int room = k / 3 + 1;
+    int write = count + room;
+    uint64_t n = 0;
+    for (int read = count - 1; read >= 0; --read) {
+      n += uint64_t(digits[read]) << k;
+      digits[--write] = static_cast<unsigned char>(n % 10);
+      n /= 10;
+    }
+    while (n > 0) {
+      digits[--write] = static_cast<unsigned char>(n % 10);
+      n /= 10;
+    }
+    // 'write' is now the first digit; move everything to the front
+    int added = room - write;
+    count += added;
+    std::memmove(digits, digits + write, count);
+    decimalPoint += added;
+    if (count > maxDigits) {
+      for (int i = maxDigits; i < count; ++i)
+        if (digits[i])
+          truncated = true;
+      count = maxDigits;
+    }
+    trim();
+  }
+
+  /// True if we should round up when keeping only the first 'n' digits
+  bool shouldRoundUp(int n) const {
+    if ((n < 0) || (n >= count))
+      return false;
+    if ((digits[n] == 5) && (n + 1 == count)) {
+      // Exactly halfway (unless we dropped digits); round to even
+      if (truncated)
+        return true;
+      return (n > 0) && (digits[n - 1] % 2 == 1);
+    }
+    return digits[n] >= 5;
+  }
+
+  /// The integer part, rounded to nearest
+  uint64_t roundedInteger() const {
+    if (decimalPoint > 20)
+      return std::numeric_limits<uint64_t>::max();
+    uint64_t result = 0;
+    int i = 0;
+    for (; (i < decimalPoint) && (i < count); ++i)
+      result = result * 10 + digits[i];
+    for (; i < decimalPoint; ++i)
+      result *= 10;
+    if (shouldRoundUp(decimalPoint))
+      ++result;
+    return result;
+  }
+};
+
+/**
+ * @brief Converts w * 10^q to the nearest double
+ *
+ * @param isNeg true for negative numbers
+ * @param w The first (up to) 19 significant digits
+ * @param q The decimal exponent
+ * @param truncated true if there were more digits after the ones in 'w'. Then
+ *                  we might need the whole text to get the rounding right.
+ * @param text Returns the json number text, if we need it
+ */
+template <typename GetText>
+inline double decimalToDouble(bool isNeg, uint64_t w, int q, bool truncated,
+                              GetText text) {
+  double result;
+  if (!truncated) {
+    if (clingerFastPath(w, q, isNeg, result))
+      return result;
+    if (eiselLemire(w, q, isNeg, result))
+      return result;
+    return BigDecimal(w, q, isNeg).toDouble();
+  }
+  // The real number is between w and w + 1 (times 10^q); if they round to the
+  // same double, that's the answer
+  double upper;
+  if (eiselLemire(w, q, isNeg, result) && eiselLemire(w + 1, q, isNeg, upper) &&
+      (result == upper))
+    return result;
+  std::string chars = text();
+  return BigDecimal(chars.data(), chars.data() + chars.size()).toDouble();
+}
+
+/// Converts w * 10^q to the nearest double
+inline double decimalToDouble(bool isNeg, uint64_t w, int q) {
+  return decimalToDouble(isNeg, w, q, false, []() { return std::string(); });
+}
+
+} // namespace json
@@ -4,15 +4,60 @@
 #include <type_traits>
 #include <cstring>
 #include <functional>
+#include <iterator>
 #include <sstream>
 
 #include "../utils.hpp"
 
+/// Marks the functions that report errors, so the compiler moves them and the
+/// branches that lead to them out of the way of the parser's hot loops
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_COLD __attribute__((cold, noinline))
+#else
+#define JSON_COLD
+#endif
+
 namespace json {
 
-// An iterator may provide an 'int row; int col;' that specify the row and
-// column of the input text that it's currently reading. If it does, we'll
-// report that info when we throw the exception.
+/// What kind of thing went wrong; for when you'd rather not parse the message
+enum class ErrorCode {
+  none,
+  unexpectedEnd,   ///< The input stopped in the middle of a value
+  unexpectedToken, ///< Some char that can't go where it is
+  badLiteral,      ///< Something that started like true, false or null but wasn't
+  badNumber,
+  badString,       ///< A bad escape, or a control char that wasn't escaped
+  badUTF8,         ///< Bytes in a string that aren't well formed UTF-8
+  tooDeep          ///< More nested arrays and objects than we'll keep track of
+};
+
+/// A short description of an ErrorCode
+inline const char *describe(ErrorCode code) {
+  switch (code) {
+  case ErrorCode::none:
+    return "No error";
+  case ErrorCode::unexpectedEnd:
+    return "Hit the end of input";
+  case ErrorCode::unexpectedToken:
+    return "Unexpected token";
+  case ErrorCode::badLiteral:
+    return "Bad true, false or null";
+  case ErrorCode::badNumber:
+    return "Bad number";
+  case ErrorCode::badString:
+    return "Bad string";
+  case ErrorCode::badUTF8:
+    return "Bad UTF-8";
+  case ErrorCode::tooDeep:
+    return "Nested too deep";
+  }
+  return "Unknown error";
+}
+
+// An iterator may provide a 'location()' that returns the row and column of
+// the input text that it's currently reading (see LocatingIterator.hpp). If it
+// does, we'll report that info when we throw the exception. It's only called
+// here, so working it out can be slow.
 
 /// The base parser Error, doesn't return any location information
 struct ParserError : std::runtime_error {
@@ -40,14 +85,17 @@ public:
 // A couple of throwError template functions, that will help choose the correct
 // ParserError class to throw
 
-auto has_row = hana::is_valid([](auto &&x) -> decltype((void)x.row) {});
-auto has_col = hana::is_valid([](auto &&x) -> decltype((void)x.col) {});
+auto has_location =
+    hana::is_valid([](auto &&x) -> decltype((void)x.location().row) {});
 
 /// Throws the LocatingParserError or ParserError
 template <typename Iterator> void throwError(std::string msg, Iterator iter) {
-  hana::if_(has_row(iter) && has_col(iter),
+  hana::if_(has_location(iter),
             [=](auto &&msg, auto iter) {
-              throw LocatingParserError(std::move(msg), iter.row, iter.col);
+              auto where = iter.location();
+              throw LocatingParserError(std::move(msg),
+                                        static_cast<int>(where.row),
+                                        static_cast<int>(where.col));
             },
             [=](auto &&msg, auto) { throw ParserError(std::move(msg)); })(std::move(msg), iter);
 };
@@ -55,4 +103,131 @@ template <typename Iterator> void throwError(std::string msg, Iterator iter) {
 /// A callable type that can throw errors for us
 template <typename Iterator>
 using ErrorThrower = std::function<void(std::string msg, Iterator)>;
+
+/**
+ * Error policies
+ *
+ * A Status hands its errors to an error policy. By default that's an
+ * ErrorThrower, which is a std::function so you can pass any callable at run
+ * time. If you know what you want at compile time, use one of these instead;
+ * they're called directly and are marked cold, so the error branches are kept
+ * off the fast path:
+ *
+ *  - ThrowErrors throws the same ParserError as throwError
+ *  - RecordErrors stores the first error's code and position and then jumps
+ *    the parser to the end of its input, so it winds up without throwing.
+ *    Nothing is thrown, so it works with exceptions turned off.
+ *
+ * A policy is called with (ErrorCode, message, Iterator& p, const Iterator&
+ * pe). The message is a string, or something that returns one when called, so
+ * policies that don't need it never build it. Its failed() says if there's
+ * been an error that it didn't throw.
+ */
+struct ErrorPolicy {};
+
+/// Makes the message text that's passed to an ErrorThrower
+template <typename Message> std::string messageText(Message &&msg) {
+  return hana::if_(hana::is_valid([](auto &&f) -> decltype(f()) {})(msg),
+                   [](auto &&msg) { return std::string(msg()); },
+                   [](auto &&msg) { return std::string(msg); })(msg);
+}
+
+/// Throws a ParserError or LocatingParserError, like throwError
+template <typename Iterator> struct ThrowErrors : ErrorPolicy {
+  /// We never get to carry on after an error
+  constexpr bool failed() const { return false; }
+
+  template <typename Message>
+  JSON_COLD void operator()(ErrorCode, Message &&msg, Iterator &p,
+                            const Iterator &) const {
+    throwError<Iterator>(messageText(msg), p);
+  }
+};
+
+/// Where RecordErrors puts the first error it sees
+template <typename Iterator> struct FirstError {
+  ErrorCode code = ErrorCode::none;
+  Iterator where{};
+};
+
+/// Records the first error without throwing; see FirstError
+template <typename Iterator> struct RecordErrors : ErrorPolicy {
+  FirstError<Iterator> *first;
+
+  explicit RecordErrors(FirstError<Iterator> &first) : first(&first) {}
+
+  bool failed() const { return first->code != ErrorCode::none; }
+
+  template <typename Message>
+  JSON_COLD void operator()(ErrorCode code, Message &&, Iterator &p,
+                            const Iterator &pe) const {
+    if (first->code == ErrorCode::none) {
+      first->code = code;
+      first->where = p;
+    }
+    // Every loop in the parser stops at the end of input, and everything that
+    // finds itself there without a value reports another error, which we
+    // ignore. So this unwinds the parse without needing an exception.
+    p = pe;
+  }
+};
+
+/// Sends an error to an ErrorThrower. It only gets the message and position.
+template <typename Iterator, typename Message>
+JSON_COLD void reportError(const ErrorThrower<Iterator> &onError, ErrorCode,
+                           Message &&msg, Iterator &p, const Iterator &) {
+  if (onError)
+    onError(messageText(msg), p);
+}
+
+/// True if an error has been reported and we carried on anyway. ErrorThrowers
+/// don't keep track, so the caller's function has to if it doesn't throw.
+template <typename Iterator>
+constexpr bool hasFailed(const ErrorThrower<Iterator> &) {
+  return false;
+}
+
+template <typename Policy> bool hasFailed(const Policy &policy) {
+  return policy.failed();
+}
+
+/// Sends an error to one of the ErrorPolicy types
+template <typename Policy, typename Iterator, typename Message>
+inline void reportError(const Policy &policy, ErrorCode code, Message &&msg,
+                        Iterator &p, const Iterator &pe) {
+  policy(code, std::forward<Message>(msg), p, pe);
+}
+
+/**
+ * @brief What a parse that reports errors instead of throwing them returns
+ *
+ * @tparam T The type that was read; void if the results went somewhere else,
+ *           like to a SAX handler
+ */
+template <typename T> struct ParseResult {
+  T value{};
+  ErrorCode error = ErrorCode::none;
+  /// How far into the input the error was
+  size_t offset = 0;
+
+  bool ok() const { return error == ErrorCode::none; }
+  explicit operator bool() const { return ok(); }
+};
+
+template <> struct ParseResult<void> {
+  ErrorCode error = ErrorCode::none;
+  size_t offset = 0;
+
+  bool ok() const { return error == ErrorCode::none; }
+  explicit operator bool() const { return ok(); }
+};
+
+/// Copies the error that RecordErrors found into a ParseResult
+template <typename T, typename Iterator>
+void setError(ParseResult<T> &result, const Iterator &begin,
+              const FirstError<Iterator> &first) {
+  result.error = first.code;
+  if (first.code != ErrorCode::none)
+    result.offset = static_cast<size_t>(std::distance(begin, first.where));
+}
 }
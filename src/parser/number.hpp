@@ -1,12 +1,17 @@
 /// Parses JSON numbers
 #pragma once
 
+#include "decimal.hpp"
 #include "error.hpp"
 #include "../utils.hpp"
 #include "status.hpp"
 
 #include <type_traits>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
 
 namespace json {
 
@@ -27,36 +32,179 @@ inline NumberType json_num2cpp_num(bool isNeg, UIntType int_part, int expPart) {
       !std::is_signed<UIntType>::value,
       "Should be an unsigned int as big as is needed to not loose data");
 
-  NumberType result = int_part;
-  if (expPart < 0)
-    while (expPart++ < 0)
-      result *= 0.1;
-  else
-    while (expPart-- > 0)
-      result *= 10;
-  return isNeg ? -result : result;
+  static_assert(sizeof(UIntType) <= sizeof(uint64_t),
+                "The significand has to fit in a uint64_t");
+
+  return static_cast<NumberType>(decimalToDouble(isNeg, int_part, expPart));
 }
 
-/// Parses a JSON number
-/// @tparam iterator an Input Iterator to chars
-/// @tparam Output the output number type
-/// @tparam iterator_traits iterator traits for 'iterator'
-/// @param p Points to the first character of the number
-/// @param pe Points to one past the end of the JSON input
-/// @param output will be filled with the value of the number we parse
-template <typename Output, typename Status>
-inline Output readNumber(Status &status) {
+/// A json number. Integers that fit in 64 bits are kept exactly; everything
+/// else is a double.
+struct NumberValue {
+  enum Kind { signedInt, unsignedInt, floating };
+  Kind kind;
+  union {
+    int64_t asInt;
+    uint64_t asUInt;
+    double asDouble;
+  };
+
+  static NumberValue fromInt(int64_t val) {
+    NumberValue result;
+    result.kind = signedInt;
+    result.asInt = val;
+    return result;
+  }
+  static NumberValue fromUInt(uint64_t val) {
+    NumberValue result;
+    result.kind = unsignedInt;
+    result.asUInt = val;
+    return result;
+  }
+  static NumberValue fromDouble(double val) {
+    NumberValue result;
+    result.kind = floating;
+    result.asDouble = val;
+    return result;
+  }
+
+  /// Converts to any c++ number type
+  template <typename T> T as() const {
+    static_assert(std::is_arithmetic<T>::value,
+                  "We can only generate number types");
+    switch (kind) {
+    case signedInt:
+      return static_cast<T>(asInt);
+    case unsignedInt:
+      return static_cast<T>(asUInt);
+    case floating:
+      return static_cast<T>(asDouble);
+    }
+    return T(0);
+  }
+
+  /// Whether the value is in range for T, so as<T>() doesn't wrap or
+  /// overflow. Fractions are still cut off when T is an integer type.
+  template <typename T> bool fits() const {
+    static_assert(std::is_arithmetic<T>::value,
+                  "We can only generate number types");
+    return fits<T>(std::is_integral<T>());
+  }
+
+private:
+  template <typename T> bool fits(std::true_type /* integral */) const {
+    using limits = std::numeric_limits<T>;
+    switch (kind) {
+    case signedInt:
+      if (asInt < 0)
+        return limits::is_signed &&
+               (asInt >= static_cast<int64_t>(limits::min()));
+      return static_cast<uint64_t>(asInt) <=
+             static_cast<uint64_t>(limits::max());
+    case unsignedInt:
+      return asUInt <= static_cast<uint64_t>(limits::max());
+    case floating: {
+      // 2 to the power of the number of value bits; exact as a double
+      const double limit = std::ldexp(1.0, limits::digits);
+      return (asDouble < limit) &&
+             (limits::is_signed ? (asDouble >= -limit) : (asDouble > -1.0));
+    }
+    }
+    return false;
+  }
+
+  template <typename T> bool fits(std::false_type /* floating */) const {
+    return (kind != floating) ||
+           (std::fabs(asDouble) <= std::numeric_limits<T>::max());
+  }
+};
+
+/// Turns the magnitude of an integer (and its sign) into a NumberValue, as a
+/// signed int if it fits in one. Returns false if it doesn't fit at all.
+inline bool makeInteger(bool isNeg, uint64_t magnitude, NumberValue &out) {
+  const uint64_t maxSigned = std::numeric_limits<int64_t>::max();
+  if (!isNeg) {
+    out = magnitude <= maxSigned ? NumberValue::fromInt(magnitude)
+                                 : NumberValue::fromUInt(magnitude);
+    return true;
+  }
+  // -0 isn't an integer; it's kept as a double so it keeps its sign
+  if ((magnitude == 0) || (magnitude > maxSigned + 1))
+    return false;
+  out = NumberValue::fromInt(-static_cast<int64_t>(magnitude - 1) - 1);
+  return true;
+}
+
+/**
+ * @brief The fast path: reads a plain integer of up to 19 digits
+ *
+ * Most numbers in the wild are short integers, so we try this first. It
+ * leaves status.p alone, and returns false, if the number has a fraction, an
+ * exponent, too many digits, or anything else unusual; readNumberValue then
+ * reads it the long way.
+ */
+template <typename Status>
+inline bool readShortInteger(Status &status, NumberValue &out) {
+  auto p = status.p;
+  const auto &pe = status.pe;
+  bool isNeg = false;
+  if ((p != pe) && (*p == '-')) {
+    isNeg = true;
+    ++p;
+  }
+  uint64_t magnitude = 0;
+  int digits = 0;
+  while (p != pe) {
+    unsigned digit = static_cast<unsigned char>(*p) - unsigned('0');
+    if (digit > 9)
+      break;
+    // 19 digits always fit in a uint64
+    if (++digits > 19)
+      return false;
+    magnitude = magnitude * 10 + digit;
+    ++p;
+  }
+  if (digits == 0)
+    return false;
+  if (p != pe) {
+    switch (*p) {
+    case '.':
+    case 'e':
+    case 'E':
+    case '-':
+    case '+':
+      return false;
+    default:
+      break;
+    }
+  }
+  if (!makeInteger(isNeg, magnitude, out))
+    return false;
+  status.p = p;
+  return true;
+}
+
+/// Parses a JSON number, keeping integers exact when they fit in 64 bits
+/// @param status the parser status; status.p points to the first character of
+///        the number, and is left one past its end
+template <typename Status>
+inline NumberValue readNumberValue(Status &status) {
 
   BOOST_HANA_CONSTANT_CHECK(is_valid_status(status));
-  static_assert(std::is_arithmetic<Output>::value,
-                "We can only generate number types");
+
+  NumberValue result;
+  if (readShortInteger(status, result))
+    return result;
 
   auto& p = status.p;
   const auto& pe = status.pe;
 
   // Check that we have some input
-  if (p == pe)
-    status.onError("No number found. At end of input");
+  if (p == pe) {
+    status.onError(ErrorCode::unexpectedEnd,
+                   "No number found. At end of input");
+    return NumberValue::fromInt(0);
+  }
 
   // Types ////////////////////
 
@@ -74,14 +222,18 @@ inline Output readNumber(Status &status) {
 
   // Varibales ////////////////////
 
-  bool intIsNeg = false;          // true if the int part is negative
-  bool expIsNeg = false;          // true if the exponent part is negative
-  unsigned long long intPart = 0; // The integer part of the number
-  int expPart1 = 0; // The inferred exponent part gotten from counting the
-                    // decimal digits
-  int expPart2 = 0; // The explicit exponent part from the number itself,
-                    // added to the inferred exponent part
+  const auto start = p;     // So we can re-read it, for the slowest path
+  bool intIsNeg = false;    // true if the int part is negative
+  uint64_t intPart = 0;     // The integer part of the number
+  bool isInteger = true;    // false once we see a '.' or an 'e'
+  bool overflowed = false;  // true if the integer part didn't fit in intPart
   bool gotAtLeastOneDigit = false;
+  uint64_t significand = 0; // The first 19 significant digits
+  int significantDigits = 0;
+  bool truncated = false;   // true if we dropped non zero digits
+  int decimalExponent = 0;  // The number is significand * 10^decimalExponent
+  bool expIsNeg = false;    // true if the exponent part is negative
+  int expPart = 0;          // The explicit exponent part
 
   // Helper functions ////////////////////
 
@@ -114,65 +266,68 @@ inline Output readNumber(Status &status) {
     }
   };
 
+  /// Adds a digit to the significand, if it has room for it. Returns false
+  /// if it didn't.
+  auto addSignificant = [&](unsigned digit) {
+    if ((significand == 0) && (digit == 0))
+      return true; // Leading zeros don't count
+    if (significantDigits == 19) {
+      truncated |= digit != 0;
+      return false;
+    }
+    significand = significand * 10 + digit;
+    ++significantDigits;
+    return true;
+  };
+
   /// Records a single integer
   auto recordInt = [&]() {
     gotAtLeastOneDigit = true;
-    intPart *= 10;
-    intPart += *p - '0';
+    unsigned digit = *p - '0';
+    if (intPart > (std::numeric_limits<uint64_t>::max() - digit) / 10)
+      overflowed = true;
+    intPart = intPart * 10 + digit;
+    if (!addSignificant(digit))
+      ++decimalExponent;
     ++p;
   };
 
   /// Records a single digit of the decimal part of the number
   auto recordDecimal = [&]() {
-    intPart *= 10;
-    intPart += *p - '0';
-    --expPart1; // the 'actual' end exponent will be way at the end
+    if (addSignificant(*p - '0'))
+      --decimalExponent;
     ++p;
   };
 
   /// Records a single digit of the exponent part of the number
   auto recordExponent = [&]() {
-    expPart2 *= 10;
-    expPart2 += *p - '0';
+    if (expPart < 100000) // Way past infinity or zero already
+      expPart = expPart * 10 + (*p - '0');
     ++p;
   };
 
-  /// Reads the entire decimale part of the number
-  auto readDecimalPart = [&]() {
-    ++p; // Skip over the '.'
-    while (p != pe) {
-      switch (Token token = getToken()) {
-      case digit:
-        recordDecimal();
-        break;
-      case dot:
-        status.onError("Second '.' found in a number");
-      case exponent:
-        return token;
-      case negative:
-        status.onError("Didn't expect a '-' in the middle of a number");
-      case positive:
-        status.onError("Didn't expect a '+' in the middle of a number");
-      default:
-        return END;
-      };
-    }
-    return END;
-  };
-
   /// Reads the entire exponent part of the JSON number
   auto readExponentPart = [&]() {
+    isInteger = false;
     // See if the first thing after the 'e' is a positive or minus sign
     ++p;
+    if (p == pe) {
+      status.onError(ErrorCode::badNumber,
+                     "Expected a '+', '-', or a digit after the 'e' for exponent");
+      return END;
+    }
     switch (getToken()) {
     case negative:
       expIsNeg = true; // break; omitted here on purpose
     case positive:
-      ++p; // break; omitted here on purpose
+      ++p;
+      break;
     case digit:
       break;
     default:
-      status.onError("Expected a '+', '-', or a digit after the 'e' for exponent");
+      status.onError(ErrorCode::badNumber,
+                     "Expected a '+', '-', or a digit after the 'e' for exponent");
+      return END;
     }
     // Now read the rest of the exponent digits
     while (p != pe) {
@@ -182,13 +337,20 @@ inline Output readNumber(Status &status) {
         recordExponent();
         break;
       case dot:
-        status.onError("'.' found in a exponent");
+        status.onError(ErrorCode::badNumber, "'.' found in a exponent");
+        return END;
       case exponent:
-        status.onError("Second 'e' for exponent found in number");
+        status.onError(ErrorCode::badNumber,
+                       "Second 'e' for exponent found in number");
+        return END;
       case negative:
-        status.onError("Didn't expect a '-' in the middle of a number");
+        status.onError(ErrorCode::badNumber,
+                       "Didn't expect a '-' in the middle of a number");
+        return END;
       case positive:
-        status.onError("Didn't expect a '+' in the middle of a number");
+        status.onError(ErrorCode::badNumber,
+                       "Didn't expect a '+' in the middle of a number");
+        return END;
       default:
         return END;
       }
@@ -196,93 +358,102 @@ inline Output readNumber(Status &status) {
     return END;
   };
 
-  /// Reads the entire integer part of the number
-  auto readIntegerPart = [&]() -> Token {
-    // Read the first digit
-    Token token = getToken();
-    switch (token) {
-    case digit:
-      recordInt();
-      break;
-    case negative:
-      ++p;
-      intIsNeg = true;
-      break;
-    default:
-      status.onError("Expected a digit or a '-'");
-    };
-    // Read the rest of the integer part
+  /// Reads the entire decimale part of the number
+  auto readDecimalPart = [&]() {
+    isInteger = false;
+    ++p; // Skip over the '.'
     while (p != pe) {
-      switch (token = getToken()) {
+      switch (getToken()) {
       case digit:
-        recordInt();
+        recordDecimal();
         break;
       case dot:
-        return readDecimalPart();
+        status.onError(ErrorCode::badNumber, "Second '.' found in a number");
+        return END;
       case exponent:
         return readExponentPart();
       case negative:
-        status.onError("Didn't expect a '-' in the middle of a number");
+        status.onError(ErrorCode::badNumber,
+                       "Didn't expect a '-' in the middle of a number");
+        return END;
       case positive:
-        status.onError("Didn't expect a '+' in the middle of a number");
+        status.onError(ErrorCode::badNumber,
+                       "Didn't expect a '+' in the middle of a number");
+        return END;
       default:
         return END;
       };
     }
     return END;
   };
-  /// Turns all our gathered data into useable result
-  auto make_number = [&]() -> Output {
-    // parse the string
-    if (gotAtLeastOneDigit) {
-      long expPart = expIsNeg ? expPart1 - expPart2 : expPart1 + expPart2;
-      return json_num2cpp_num<Output>(intIsNeg, intPart, expPart);
-    } else {
-      // Might reach here if we find for example, a standalone + or - in the
-      // json
-      status.onError("Couldn't read a number");
-    }
-    assert("Code flow should never get here. onError should throw");
-    return (Output)0;
-  };
 
   // Actual Parsing Code ////////////////////
 
-  Token token = readIntegerPart(); // First part of the number
-
-  // Now we should see a decimal or an exponent part
-  bool haveExponent = false;
-  switch (token) {
-  case dot:
-    token = readDecimalPart(); // 2nd part of the number
+  // Read the first digit
+  switch (getToken()) {
+  case digit:
+    recordInt();
     break;
-  case exponent:
-    token = readExponentPart();
-    haveExponent = true;
+  case negative:
+    ++p;
+    intIsNeg = true;
     break;
-  case END:
-    return make_number();
   default:
-    assert("Should never reach here");
-    status.onError("Unexpected token in number");
+    status.onError(ErrorCode::badNumber, "Expected a digit or a '-'");
+    return NumberValue::fromInt(0);
   };
+  // Read the rest of the integer part, then the decimal and exponent parts
+  bool done = false;
+  while ((p != pe) && !done) {
+    switch (getToken()) {
+    case digit:
+      recordInt();
+      break;
+    case dot:
+      readDecimalPart();
+      done = true;
+      break;
+    case exponent:
+      readExponentPart();
+      done = true;
+      break;
+    case negative:
+      status.onError(ErrorCode::badNumber,
+                     "Didn't expect a '-' in the middle of a number");
+      return NumberValue::fromInt(0);
+    case positive:
+      status.onError(ErrorCode::badNumber,
+                     "Didn't expect a '+' in the middle of a number");
+      return NumberValue::fromInt(0);
+    default:
+      done = true;
+    };
+  }
 
-  switch (token) {
-  case exponent:
-    if (haveExponent)
-      status.onError("found two exponents in a json number");
-    token = readExponentPart();
-    break;
-  case END:
-    return make_number();
-  default:
-    assert("Should never get here. All error conditions should have been "
-           "handled above");
-    status.onError("Unexpected token in number");
+  // Turn all our gathered data into a useable result
+  if (!gotAtLeastOneDigit) {
+    // Might reach here if we find for example, a standalone + or - in the
+    // json
+    status.onError(ErrorCode::badNumber, "Couldn't read a number");
+    assert("Code flow should never get here. onError should throw");
+    return NumberValue::fromInt(0);
   }
+  if (isInteger && !overflowed && makeInteger(intIsNeg, intPart, result))
+    return result;
+  decimalExponent += expIsNeg ? -expPart : expPart;
+  return NumberValue::fromDouble(
+      decimalToDouble(intIsNeg, significand, decimalExponent, truncated,
+                      [&]() { return std::string(start, p); }));
+}
 
-  assert("Should never get here. All error conditions should have been "
-         "handled above");
-  return make_number();
+/// Parses a JSON number
+/// @tparam Output the output number type
+/// @param status the parser status; status.p points to the first character of
+///        the number
+template <typename Output, typename Status>
+inline Output readNumber(Status &status) {
+  static_assert(std::is_arithmetic<Output>::value,
+                "We can only generate number types");
+  return readNumberValue(status).template as<Output>();
 }
 }
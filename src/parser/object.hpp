@@ -22,29 +22,28 @@ template <typename Status> std::string best_string_decoder(Status &status) {
 
 /// Convenience function to read an object.
 /// @onAttribute will be called when an attribute name is read
-/// @onVal will be read when the stream is ready to read a value. The function
-///        needs to consume that value from the stream.
-template <typename Status>
-void readObject(Status &status, std::function<void(std::string &&)> onAttribute,
-                std::function<void(Token)> onVal) {
+/// @onVal will be called with the value's token when the stream is ready to
+///        read a value. It needs to consume that value from the stream.
+/// Both are template parameters, so lambdas are called directly; see sax.hpp
+/// for a reader that doesn't copy the attribute names either.
+template <typename Status, typename OnAttribute, typename OnVal>
+void readObject(Status &status, OnAttribute &&onAttribute, OnVal &&onVal) {
 
   BOOST_HANA_CONSTANT_ASSERT(is_forward_iterator(status.p));
 
-  auto& p = status.p;
-  auto& pe = status.pe;
-  while (p != pe) {
-    // We need an attribute, or the end of the object
+  for (;;) {
+    // We need an attribute, or the end of the object (or an error that didn't
+    // throw)
     Token token = require({OBJECT_END, string}, status);
-    if (token == OBJECT_END)
-      // We're done
+    if (token != string)
       break;
     // Read the first attribute name
     std::string attrName = decodeString(status);
 #ifndef NDEBUG
     // Forward iterators can be copied then compared
-    auto b4 = p;
+    auto b4 = status.p;
     onAttribute(std::move(attrName));
-    assert(b4 == p); // onAttribute must not consume anything
+    assert(b4 == status.p); // onAttribute must not consume anything
 #else
     onAttribute(std::move(attrName));
 #endif
@@ -53,16 +52,16 @@ void readObject(Status &status, std::function<void(std::string &&)> onAttribute,
     // Read the value
     token = require(valueTokens(), status);
 #ifndef NDEBUG
-    b4 = p;
+    b4 = status.p;
     onVal(token);
-    assert(b4 != p); // onVal must consume one value
+    // onVal must consume one value, unless an error sent us to the end
+    assert((b4 != status.p) || (status.p == status.pe));
 #else
     onVal(token);
 #endif
     // Read the comma or the end of the object
-    token = require({COMMA, OBJECT_END}, status);
-    // We're done
-    if (token == OBJECT_END)
+    // We're done, unless there's a comma
+    if (require({COMMA, OBJECT_END}, status) != COMMA)
       break;
   }
 }
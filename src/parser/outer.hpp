@@ -3,6 +3,7 @@
 #pragma once
 
 #include "status.hpp"
+#include "simd.hpp"
 
 #include <cassert>
 
@@ -24,6 +25,37 @@ enum Token {
   ERROR = 'x'
 };
 
+/**
+ * Moves 'p' past any white space
+ *
+ * Contiguous char input is handed to the vectorized scanner; everything else
+ * is walked one char at a time.
+ *
+ * @param p The iterator to move forward
+ * @param pe One past the end of the input
+ */
+template <typename Iterator>
+inline void skipWS(Iterator &p, const Iterator &pe) {
+  hana::if_(is_contiguous_iterator(p),
+            [](auto &p, const auto &pe) {
+              simd::scanContiguous(p, pe, simd::skipWhitespace);
+            },
+            [](auto &p, const auto &pe) {
+              while ((p != pe)) {
+                switch ((*p)) {
+                case 9:
+                case 10:
+                case 13:
+                case ' ':
+                  ++p;
+                  continue;
+                default:
+                  return;
+                }
+              }
+            })(p, pe);
+}
+
 /**
  * Finds the type of the next JSON in the stream
  *
@@ -41,23 +73,7 @@ getNextOuterToken(Status& status) {
   auto& p = status.p;
   const auto& pe = status.pe;
 
-  /// Skips over white space
-  auto skipWS = [&]() {
-    while ((p != pe)) {
-      switch ((*p)) {
-      case 9:
-      case 10:
-      case 13:
-      case ' ':
-        ++p;
-        continue;
-      default:
-        return;
-      }
-    }
-  };
-
-  skipWS();
+  skipWS(p, pe);
   while ((p != pe)) {
     switch ((*p)) {
     case '"':
@@ -139,7 +155,7 @@ template <typename Status> inline bool readBoolean(Status &status) {
     requireStaticString(status, "alse");
     return false;
   default:
-    status.onError("Expected 'true' or 'false'");
+    status.onError(ErrorCode::badLiteral, "Expected 'true' or 'false'");
   }
   assert("Code flow should never reach here, as onError should throw");
   return false;
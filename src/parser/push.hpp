@@ -0,0 +1,457 @@
+/// Reads json that arrives a piece at a time, like from a socket
+///
+/// Everything else in the parser wants the whole document between 'p' and
+/// 'pe'. A PushParser is fed chunks as they come, and sends SAX events (see
+/// sax.hpp) as soon as each value is complete, so the handler can start work
+/// before the rest of the document turns up. Between chunks it keeps the
+/// nesting stack and whatever part of a string, number, true, false or null
+/// the chunk ended in.
+///
+///     PushParser<MyHandler> parser(handler);
+///     while (socket.read(buffer, size))
+///       parser.feed(buffer, size);
+///     parser.finish();
+///
+/// The input can hold any number of top level values, one after the other
+/// (like newline delimited json); the handler's onEndDocument() is called after
+/// each one. A number can only be seen to have ended when something comes
+/// after it, so a top level number is only sent on the next chunk, or by
+/// finish().
+#pragma once
+
+#include "error.hpp"
+#include "number.hpp"
+#include "outer.hpp"
+#include "sax.hpp"
+#include "simd.hpp"
+#include "status.hpp"
+#include "string.hpp"
+#include "utils.hpp"
+
+#include <string>
+#include <vector>
+
+namespace json {
+
+/**
+ * @brief A resumable SAX parser that's fed the json a chunk at a time
+ *
+ * Strings without escapes that start and end in the same chunk are handed to
+ * the handler straight out of that chunk; others are copied or decoded into a
+ * buffer first. Either way they're only good until the handler returns.
+ *
+ * @tparam Handler Something with the same members as SAXHandler
+ */
+template <typename Handler> class PushParser {
+public:
+  explicit PushParser(Handler &handler,
+                      ErrorThrower<const char *> onError =
+                          throwError<const char *>)
+      : handler(handler), _onError(onError) {}
+
+  /// Parses the next 'size' bytes of input. They only need to stay alive
+  /// until this returns.
+  void feed(const char *p, size_t size) {
+    const char *pe = p + size;
+    chunk = p;
+    chunkSize = size;
+    while ((p != pe) && !failed) {
+      switch (partial) {
+      case inString:
+      case inKey:
+        p = continueString(p, pe);
+        break;
+      case inNumber:
+        p = continueNumber(p, pe);
+        break;
+      case inLiteral:
+        p = continueLiteral(p, pe);
+        break;
+      case none:
+        p = simd::skipWhitespace(p, pe);
+        if (p != pe)
+          p = structural(p, pe);
+        break;
+      }
+    }
+    consumed += size;
+  }
+  void feed(const std::string &chunk) { feed(chunk.data(), chunk.size()); }
+
+  /// Tells the parser that there's no more input. Finishes off a top level
+  /// number, and complains if the input stopped part way through a value.
+  void finish() {
+    if (failed)
+      return;
+    switch (partial) {
+    case inNumber:
+      endNumber(nullptr, nullptr);
+      break;
+    case inLiteral:
+      endLiteral();
+      break;
+    case inString:
+    case inKey:
+      fail("Hit the end of input inside a string", nullptr);
+      return;
+    case none:
+      break;
+    }
+    if (!failed && ((expect != value) || !stack.empty()))
+      fail(unexpectedTokenMessage(expected(), HIT_END), nullptr);
+  }
+
+  /// How many bytes we've been fed
+  size_t position() const { return consumed; }
+
+  /// How far into all the input an error that was reported at 'at' is. Errors
+  /// in tokens that were split between chunks point into our copy of the
+  /// token; this sees through that. Null is the end of the input.
+  size_t offsetOf(const char *at) const {
+    if (at && (at >= chunk) && (at <= chunk + chunkSize))
+      return consumed + (at - chunk);
+    if (at && (at >= pending.data()) && (at <= pending.data() + pending.size()))
+      return pendingStart + (at - pending.data());
+    return consumed;
+  }
+  /// True if the input ended between top level values
+  bool atDocumentEnd() const {
+    return (partial == none) && (expect == value) && stack.empty();
+  }
+
+private:
+  /// What can come next, outside of any string, number or literal
+  enum Expect {
+    value,
+    valueOrArrayEnd,
+    commaOrArrayEnd,
+    keyOrObjectEnd,
+    colon,
+    commaOrObjectEnd
+  };
+  /// The kind of token that the last chunk ended in the middle of
+  enum Partial { none, inString, inKey, inNumber, inLiteral };
+
+  Handler &handler;
+  ErrorThrower<const char *> _onError;
+  Expect expect = value;
+  Partial partial = none;
+  /// '[' or '{' for each array and object that we're inside
+  std::vector<char> stack;
+  /// The part of a string, number or literal that's come so far
+  std::string pending;
+  /// Where decoded strings go
+  std::string scratch;
+  /// The string we're in has escapes in it
+  bool hasEscapes = false;
+  /// The last chunk ended just after a backslash in a string
+  bool escapePending = false;
+  bool failed = false;
+  /// How many bytes came before the chunk we're reading
+  size_t consumed = 0;
+  const char *chunk = nullptr;
+  size_t chunkSize = 0;
+  /// How far into the input 'pending' starts
+  size_t pendingStart = 0;
+
+  void fail(std::string msg, const char *at) {
+    failed = true;
+    if (_onError)
+      _onError(std::move(msg), at);
+  }
+
+  /// A status for the readers in number.hpp, string.hpp and outer.hpp
+  Status<const char *> statusFor(const char *p, const char *pe) {
+    return make_status(p, pe,
+                       ErrorThrower<const char *>(
+                           [this](std::string msg, const char *at) {
+                             fail(std::move(msg), at);
+                           }));
+  }
+
+  TokenSet expected() const {
+    switch (expect) {
+    case value:
+      return valueTokens();
+    case valueOrArrayEnd:
+      return valueTokens() | ARRAY_END;
+    case commaOrArrayEnd:
+      return {COMMA, ARRAY_END};
+    case keyOrObjectEnd:
+      return {OBJECT_END, string};
+    case colon:
+      return COLON;
+    case commaOrObjectEnd:
+      return {COMMA, OBJECT_END};
+    }
+    return {};
+  }
+
+  /// Complains about the char at 'p', like require() would
+  void unexpected(const char *p) {
+    auto status = statusFor(p, p + 1);
+    fail(unexpectedTokenMessage(expected(), getNextOuterToken(status)), p);
+  }
+
+  /// Starts saving a token that starts at 'p'
+  void startPending(const char *p) {
+    pending.clear();
+    pendingStart = consumed + (p - chunk);
+  }
+
+  /// Moves on after a whole value
+  void endValue() {
+    if (stack.empty()) {
+      expect = value;
+      handler.onEndDocument();
+    } else
+      expect = stack.back() == '[' ? commaOrArrayEnd : commaOrObjectEnd;
+  }
+
+  /// Reads one token that starts at 'p'
+  const char *structural(const char *p, const char *pe) {
+    const char c = *p;
+    switch (expect) {
+    case value:
+    case valueOrArrayEnd:
+      switch (c) {
+      case '{':
+        handler.onStartObject();
+        stack.push_back('{');
+        expect = keyOrObjectEnd;
+        return p + 1;
+      case '[':
+        handler.onStartArray();
+        stack.push_back('[');
+        expect = valueOrArrayEnd;
+        return p + 1;
+      case ']':
+        if (expect == valueOrArrayEnd)
+          return endContainer(p);
+        break;
+      case '"':
+        return startString(p + 1, pe, inString);
+      case '-': case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        startPending(p);
+        partial = inNumber;
+        return continueNumber(p, pe);
+      case 't': case 'f': case 'n':
+        startPending(p);
+        partial = inLiteral;
+        return continueLiteral(p, pe);
+      }
+      break;
+    case keyOrObjectEnd:
+      if (c == '}')
+        return endContainer(p);
+      if (c == '"')
+        return startString(p + 1, pe, inKey);
+      break;
+    case colon:
+      if (c == ':') {
+        expect = value;
+        return p + 1;
+      }
+      break;
+    // Like readArray() and readObject(), we let a ']' or '}' follow a comma
+    case commaOrArrayEnd:
+      if (c == ',') {
+        expect = valueOrArrayEnd;
+        return p + 1;
+      }
+      if (c == ']')
+        return endContainer(p);
+      break;
+    case commaOrObjectEnd:
+      if (c == ',') {
+        expect = keyOrObjectEnd;
+        return p + 1;
+      }
+      if (c == '}')
+        return endContainer(p);
+      break;
+    }
+    unexpected(p);
+    return pe;
+  }
+
+  /// Closes the array or object whose end is at 'p'
+  const char *endContainer(const char *p) {
+    if (stack.back() == '[')
+      handler.onEndArray();
+    else
+      handler.onEndObject();
+    stack.pop_back();
+    endValue();
+    return p + 1;
+  }
+
+  const char *startString(const char *p, const char *pe, Partial kind) {
+    partial = kind;
+    startPending(p);
+    hasEscapes = false;
+    escapePending = false;
+    // Most strings start and end in the same chunk, without escapes; hand
+    // those over without copying them
+    const char *end = simd::findStringSpecial(p, pe);
+    if ((end != pe) && (*end == '"')) {
+      endString(p, end);
+      return end + 1;
+    }
+    return continueString(p, pe);
+  }
+
+  /// Finds the end of the string we're in, saving what's in this chunk
+  const char *continueString(const char *p, const char *pe) {
+    const char *start = p;
+    if (escapePending) {
+      ++p; // The char after the backslash
+      escapePending = false;
+    }
+    while (p != pe) {
+      p = simd::findStringSpecial(p, pe);
+      if (p == pe)
+        break;
+      switch (*p) {
+      case '"':
+        pending.append(start, p + 1);
+        endString(nullptr, nullptr);
+        return p + 1;
+      case '\\':
+        hasEscapes = true;
+        if (++p == pe)
+          escapePending = true;
+        else
+          ++p;
+        break;
+      default:
+        ++p; // A control char; the decoder will complain about it
+        hasEscapes = true;
+      }
+    }
+    pending.append(start, pe);
+    return pe;
+  }
+
+  /// Sends a whole string to the handler: [begin, end) if it's straight out of
+  /// the chunk, or what's in 'pending' (with its closing quote)
+  void endString(const char *begin, const char *end) {
+    const Partial kind = partial;
+    partial = none;
+    SAXString text;
+    if (begin)
+      text = SAXString{begin, end};
+    else if (!hasEscapes)
+      text = SAXString{pending.data(), pending.data() + pending.size() - 1};
+    else {
+      scratch.clear();
+      auto status = statusFor(pending.data(), pending.data() + pending.size());
+      decodeContiguousString(status, scratch);
+      if (failed)
+        return;
+      text = SAXString{scratch.data(), scratch.data() + scratch.size()};
+    }
+    if (kind == inKey) {
+      handler.onKey(text);
+      expect = colon;
+    } else {
+      handler.onString(text);
+      endValue();
+    }
+  }
+
+  static bool isNumberChar(char c) {
+    switch (c) {
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+    case '-': case '+': case '.': case 'e': case 'E':
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  const char *continueNumber(const char *p, const char *pe) {
+    const char *start = p;
+    while ((p != pe) && isNumberChar(*p))
+      ++p;
+    if (p == pe) {
+      pending.append(start, pe);
+      return pe;
+    }
+    if (pending.empty())
+      endNumber(start, p);
+    else {
+      pending.append(start, p);
+      endNumber(nullptr, nullptr);
+    }
+    return p;
+  }
+
+  /// Reads a whole number: [begin, end) if it's straight out of the chunk, or
+  /// what's in 'pending'
+  void endNumber(const char *begin, const char *end) {
+    partial = none;
+    if (!begin) {
+      begin = pending.data();
+      end = begin + pending.size();
+    }
+    auto status = statusFor(begin, end);
+    NumberValue number = readNumberValue(status);
+    if (failed)
+      return;
+    if (status.p != end) {
+      endValue();
+      unexpected(status.p);
+      return;
+    }
+    handler.onNumber(number);
+    endValue();
+  }
+
+  static bool isLetter(char c) { return (c >= 'a') && (c <= 'z'); }
+
+  const char *continueLiteral(const char *p, const char *pe) {
+    const char *start = p;
+    while ((p != pe) && isLetter(*p))
+      ++p;
+    pending.append(start, p);
+    if (p != pe)
+      endLiteral();
+    return p;
+  }
+
+  /// Reads the true, false or null in 'pending'
+  void endLiteral() {
+    partial = none;
+    const char *begin = pending.data();
+    const char *end = begin + pending.size();
+    auto status = statusFor(begin, end);
+    if (*begin == 'n') {
+      ++status.p; // readNull wants the 'n' read already
+      readNull(status);
+      if (failed)
+        return;
+      handler.onNull();
+    } else {
+      bool value = readBoolean(status);
+      if (failed)
+        return;
+      handler.onBoolean(value);
+    }
+    endValue();
+    if (status.p != end)
+      unexpected(status.p);
+  }
+};
+
+/// Makes a PushParser that sends its events to 'handler'
+template <typename Handler>
+PushParser<Handler>
+makePushParser(Handler &handler,
+               ErrorThrower<const char *> onError = throwError<const char *>) {
+  return PushParser<Handler>(handler, onError);
+}
+
+} // namespace json
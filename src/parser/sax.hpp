@@ -0,0 +1,198 @@
+/// Reads json as a stream of events, without building a tree
+///
+/// The handler is a template parameter, so every event is a plain (usually
+/// inlined) member call. Strings and keys are handed over as borrowed
+/// string_reference<const char*>s: for contiguous input, strings without
+/// escapes point straight into the input; anything else is decoded into a
+/// scratch buffer that's reused for the next string. Either way, the data is
+/// only good until the handler returns; copy it if you need to keep it.
+#pragma once
+
+#include "array.hpp"
+#include "error.hpp"
+#include "number.hpp"
+#include "outer.hpp"
+#include "status.hpp"
+#include "string.hpp"
+#include "utils.hpp"
+
+#include <cassert>
+#include <iterator>
+#include <string>
+
+namespace json {
+
+/// Borrowed string data given to a SAX handler
+using SAXString = string_reference<const char *>;
+
+/**
+ * @brief A SAX handler that ignores everything
+ *
+ * Derive from it and hide just the events that you care about. The reader
+ * calls the derived class's members directly; nothing here is virtual.
+ */
+struct SAXHandler {
+  void onNull() {}
+  void onBoolean(bool) {}
+  void onNumber(const NumberValue &) {}
+  void onString(const SAXString &) {}
+  /// A key in an object; the key's value comes next
+  void onKey(const SAXString &) {}
+  void onStartObject() {}
+  void onEndObject() {}
+  void onStartArray() {}
+  void onEndArray() {}
+  /// After each whole top level value; only PushParser sends this one
+  void onEndDocument() {}
+};
+
+/// Walks the json and sends each value to a handler. Use readSAX() rather
+/// than this directly.
+template <typename Status, typename Handler> class SAXReader {
+public:
+  SAXReader(Status &status, Handler &handler)
+      : status(status), handler(handler) {}
+
+  void readValue(Token token = ERROR) {
+    if (token == ERROR)
+      token = require(valueTokens(), status);
+    // With an error policy that doesn't throw, the parse winds up after an
+    // error; status.failed() stops us passing on anything read after it
+    switch (token) {
+    case null:
+      readNull(status);
+      if (!status.failed())
+        handler.onNull();
+      break;
+    case boolean: {
+      bool value = readBoolean(status);
+      if (!status.failed())
+        handler.onBoolean(value);
+      break;
+    }
+    case array:
+      handler.onStartArray();
+      readArray(status, [this](Token t) { readValue(t); });
+      if (!status.failed())
+        handler.onEndArray();
+      break;
+    case object: {
+      handler.onStartObject();
+      for (;;) {
+        if (require({OBJECT_END, string}, status) != string)
+          break;
+        SAXString key = readString();
+        if (status.failed())
+          return;
+        handler.onKey(key);
+        require(COLON, status);
+        readValue();
+        if (require({COMMA, OBJECT_END}, status) != COMMA)
+          break;
+      }
+      if (!status.failed())
+        handler.onEndObject();
+      break;
+    }
+    case number: {
+      NumberValue value = readNumberValue(status);
+      if (!status.failed())
+        handler.onNumber(value);
+      break;
+    }
+    case string: {
+      SAXString value = readString();
+      if (!status.failed())
+        handler.onString(value);
+      break;
+    }
+    case HIT_END:
+    case COMMA:
+    case COLON:
+    case ARRAY_END:
+    case OBJECT_END:
+    case ERROR:
+      assert("Code shouldn't reach here because 'require' should throw on bad tokens");
+      break;
+    }
+  }
+
+private:
+  Status &status;
+  Handler &handler;
+  /// Decoded strings live here until the next string is read
+  std::string scratch;
+
+  /// Reads a string, just after its opening '"'
+  SAXString readString() {
+    return hana::if_(
+        is_contiguous_iterator(status.p),
+        [](auto &status, std::string &scratch) -> SAXString {
+          auto begin = status.p;
+          auto end = findEndOfUnchangedCharBlock(begin, status.pe);
+          if ((end != status.pe) && (*end == '"')) {
+            status.p = end + 1;
+            const char *chars = &*begin;
+            return {chars, chars + (end - begin)};
+          }
+          scratch.clear();
+          decodeContiguousString(status, scratch);
+          return {scratch.data(), scratch.data() + scratch.size()};
+        },
+        [](auto &status, std::string &scratch) -> SAXString {
+          scratch.clear();
+          decodeString(status, std::back_inserter(scratch));
+          return {scratch.data(), scratch.data() + scratch.size()};
+        })(status, scratch);
+  }
+};
+
+/**
+ * @brief Reads the next json value, sending its events to 'handler'
+ *
+ * @param status The parser status
+ * @param handler Something with the same members as SAXHandler
+ * @param token The token for the value, if the caller already read it
+ */
+template <typename Status, typename Handler>
+void readSAX(Status &status, Handler &handler, Token token = ERROR) {
+  BOOST_HANA_CONSTANT_ASSERT(is_valid_status(status));
+  BOOST_HANA_CONSTANT_ASSERT(is_forward_iterator(status.p));
+  SAXReader<Status, Handler> reader(status, handler);
+  reader.readValue(token);
+}
+
+/**
+ * @brief Reads json from a pair of iterators, sending its events to 'handler'
+ *
+ * @returns Where reading stopped; just after the value
+ */
+template <typename Iterator, typename Handler>
+Iterator readSAX(Iterator jsonStart, Iterator jsonEnd, Handler &handler,
+                 ErrorThrower<Iterator> onError = throwError<Iterator>) {
+  auto status = make_status(jsonStart, jsonEnd, onError);
+  readSAX(status, handler);
+  return status.p;
+}
+
+/**
+ * @brief Reads json from a pair of iterators without throwing on bad json
+ *
+ * The handler gets the events up to the error. Nothing in the parser throws on
+ * this path, so it can be built with exceptions turned off.
+ *
+ * @returns The first error and its offset from jsonStart, if there was one
+ */
+template <typename Iterator, typename Handler>
+ParseResult<void> tryReadSAX(Iterator jsonStart, Iterator jsonEnd,
+                             Handler &handler) {
+  FirstError<Iterator> error;
+  auto status =
+      make_status(jsonStart, jsonEnd, RecordErrors<Iterator>(error));
+  readSAX(status, handler);
+  ParseResult<void> result;
+  setError(result, jsonStart, error);
+  return result;
+}
+
+} // namespace json
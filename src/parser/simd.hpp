@@ -0,0 +1,857 @@
+/// Vectorized scanners for contiguous char input
+///
+/// The parser works on any forward iterator, but when the Status iterators
+/// point into one contiguous block of chars (char*, std::string::iterator,
+/// etc.) we can look at 64 bytes at a time. Each instruction set provides a
+/// 'classify' function that turns a 64 byte block into bitmasks; the best one
+/// for the CPU we're running on is picked once, at runtime.
+#pragma once
+
+#include "../utils.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if !defined(NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) &&        \
+    (defined(__GNUC__) || defined(__clang__))
+#define JSON_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace json {
+namespace simd {
+
+/// Number of bytes that the classifiers look at in one go
+constexpr size_t blockSize = 64;
+
+/// The different implementations we can pick from at runtime
+enum InstructionSet { scalar, sse42, avx2 };
+
+/// Bitmasks describing a block of 64 chars. Bit 'n' refers to the n'th char.
+struct BlockMasks {
+  uint64_t whitespace; // ' ', '\t', '\n', '\r'
+  uint64_t structural; // ',', ':', '[', ']', '{', '}'
+  uint64_t quote;      // '"'
+};
+
+/// Returns the index of the lowest set bit. 'bits' must not be zero.
+inline int firstBit(uint64_t bits) {
+  assert(bits != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#else
+  int result = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+/// Returns the number of set bits
+inline int popCount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(bits);
+#else
+  int result = 0;
+  for (; bits; bits &= bits - 1)
+    ++result;
+  return result;
+#endif
+}
+
+/// Returns the index of the highest set bit. 'bits' must not be zero.
+inline int lastBit(uint64_t bits) {
+  assert(bits != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(bits);
+#else
+  int result = 63;
+  while ((bits >> result) == 0)
+    --result;
+  return result;
+#endif
+}
+
+/// Classifies a block one char at a time. Works everywhere.
+inline BlockMasks classifyScalar(const char *block) {
+  BlockMasks result{0, 0, 0};
+  for (size_t i = 0; i < blockSize; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    switch (block[i]) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      result.whitespace |= bit;
+      break;
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+      result.structural |= bit;
+      break;
+    case '"':
+      result.quote |= bit;
+      break;
+    }
+  }
+  return result;
+}
+
+/// Bitmasks of the chars that matter when skipping over arrays and objects
+struct BracketMasks {
+  uint64_t open;      // '[', '{'
+  uint64_t close;     // ']', '}'
+  uint64_t quote;     // '"'
+  uint64_t backslash; // '\\'
+};
+
+inline BracketMasks classifyBracketsScalar(const char *block) {
+  BracketMasks result{0, 0, 0, 0};
+  for (size_t i = 0; i < blockSize; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    switch (block[i]) {
+    case '[':
+    case '{':
+      result.open |= bit;
+      break;
+    case ']':
+    case '}':
+      result.close |= bit;
+      break;
+    case '"':
+      result.quote |= bit;
+      break;
+    case '\\':
+      result.backslash |= bit;
+      break;
+    }
+  }
+  return result;
+}
+
+/// Bitmasks of everything validate() needs to know about a block
+struct ValidationMasks {
+  uint64_t whitespace; // ' ', '\t', '\n', '\r'
+  uint64_t structural; // ',', ':', '[', ']', '{', '}'
+  uint64_t quote;      // '"'
+  uint64_t backslash;  // '\\'
+  uint64_t control;    // Below 0x20 (so whitespace other than ' ' too)
+  uint64_t nonASCII;   // 0x80 and up
+};
+
+inline ValidationMasks classifyForValidationScalar(const char *block) {
+  ValidationMasks result{0, 0, 0, 0, 0, 0};
+  for (size_t i = 0; i < blockSize; ++i) {
+    const uint64_t bit = uint64_t(1) << i;
+    const unsigned char c = static_cast<unsigned char>(block[i]);
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      result.whitespace |= bit;
+      break;
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+      result.structural |= bit;
+      break;
+    case '"':
+      result.quote |= bit;
+      break;
+    case '\\':
+      result.backslash |= bit;
+      break;
+    }
+    if (c < 0x20)
+      result.control |= bit;
+    else if (c >= 0x80)
+      result.nonASCII |= bit;
+  }
+  return result;
+}
+
+/// Finds the '\n's in a block
+inline uint64_t newlinesScalar(const char *block) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < blockSize; ++i)
+    if (block[i] == '\n')
+      result |= uint64_t(1) << i;
+  return result;
+}
+
+/// Returns true for the chars that may not appear unescaped in a JSON string
+template <typename Char> inline bool isControlChar(Char c) {
+  return static_cast<typename std::make_unsigned<Char>::type>(c) < 0x20;
+}
+
+/// Finds the first '"', '\\' or control char in [p, pe); returns pe if
+/// there isn't one
+inline const char *findStringSpecialScalar(const char *p, const char *pe) {
+  for (; p != pe; ++p)
+    if ((*p == '"') || (*p == '\\') || isControlChar(*p))
+      return p;
+  return p;
+}
+
+/// Finds the first char that a json writer has to escape to produce pure
+/// ASCII: '"', '\\', a control char or anything from 0x80 up
+inline const char *findNonASCIISpecialScalar(const char *p, const char *pe) {
+  for (; p != pe; ++p)
+    if ((*p == '"') || (*p == '\\') ||
+        (static_cast<unsigned char>(*p) - 0x20u >= 0x60u))
+      return p;
+  return p;
+}
+
+#ifdef JSON_SIMD_X86
+
+/// Classifies a block 16 chars at a time, using the SSE4.2 string compare
+/// instruction to match against the whitespace and structural char sets
+__attribute__((target("sse4.2"))) inline BlockMasks
+classifySSE42(const char *block) {
+  const __m128i whitespace = _mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i structural = _mm_setr_epi8(',', ':', '[', ']', '{', '}', 0, 0,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i quote = _mm_set1_epi8('"');
+  const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+  BlockMasks result{0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+    uint64_t ws = static_cast<uint16_t>(
+        _mm_cvtsi128_si32(_mm_cmpestrm(whitespace, 4, chunk, 16, mode)));
+    uint64_t st = static_cast<uint16_t>(
+        _mm_cvtsi128_si32(_mm_cmpestrm(structural, 6, chunk, 16, mode)));
+    uint64_t qu = static_cast<uint16_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)));
+    result.whitespace |= ws << (i * 16);
+    result.structural |= st << (i * 16);
+    result.quote |= qu << (i * 16);
+  }
+  return result;
+}
+
+/// Returns a mask of the chars in 'chunk' that equal 'c'
+__attribute__((target("avx2"))) inline __m256i avx2Equal(__m256i chunk,
+                                                         char c) {
+  return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(c));
+}
+
+/// Packs the top bit of each byte of a compare result into an int
+__attribute__((target("avx2"))) inline uint64_t avx2Bits(__m256i mask) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(mask));
+}
+
+/// Classifies a block 32 chars at a time
+__attribute__((target("avx2"))) inline BlockMasks
+classifyAVX2(const char *block) {
+  BlockMasks result{0, 0, 0};
+  for (int i = 0; i < 2; ++i) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i * 32));
+    __m256i ws =
+        _mm256_or_si256(_mm256_or_si256(avx2Equal(chunk, ' '), avx2Equal(chunk, '\t')),
+                        _mm256_or_si256(avx2Equal(chunk, '\n'), avx2Equal(chunk, '\r')));
+    // '[' and '{' (and ']' and '}') only differ in bit 0x20; set it so that
+    // two compares catch all four brackets
+    __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    __m256i st = _mm256_or_si256(
+        _mm256_or_si256(avx2Equal(chunk, ','), avx2Equal(chunk, ':')),
+        _mm256_or_si256(avx2Equal(folded, '{'), avx2Equal(folded, '}')));
+    __m256i qu = avx2Equal(chunk, '"');
+    result.whitespace |= avx2Bits(ws) << (i * 32);
+    result.structural |= avx2Bits(st) << (i * 32);
+    result.quote |= avx2Bits(qu) << (i * 32);
+  }
+  return result;
+}
+
+/// Finds the first '"', '\\' or control char, 16 chars at a time
+__attribute__((target("sse4.2"))) inline const char *
+findStringSpecialSSE42(const char *p, const char *pe) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+  while (pe - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    // min(chunk, 0x1F) == chunk means chunk <= 0x1F (unsigned)
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, backslash)),
+        _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+    int bits = _mm_movemask_epi8(special);
+    if (bits)
+      return p + firstBit(bits);
+    p += 16;
+  }
+  return findStringSpecialScalar(p, pe);
+}
+
+/// Finds the first '"', '\\' or control char, 32 chars at a time
+__attribute__((target("avx2"))) inline const char *
+findStringSpecialAVX2(const char *p, const char *pe) {
+  const __m256i control = _mm256_set1_epi8(0x1F);
+  while (pe - p >= 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i special = _mm256_or_si256(
+        _mm256_or_si256(avx2Equal(chunk, '"'), avx2Equal(chunk, '\\')),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+    uint64_t bits = avx2Bits(special);
+    if (bits)
+      return p + firstBit(bits);
+    p += 32;
+  }
+  return findStringSpecialSSE42(p, pe);
+}
+
+/// Finds the first '"', '\\', control char or non ASCII char, 16 at a time
+__attribute__((target("sse4.2"))) inline const char *
+findNonASCIISpecialSSE42(const char *p, const char *pe) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+  while (pe - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, backslash)),
+        _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+    // Non ASCII chars have the top bit set, which is what movemask reads
+    int bits = _mm_movemask_epi8(_mm_or_si128(special, chunk));
+    if (bits)
+      return p + firstBit(bits);
+    p += 16;
+  }
+  return findNonASCIISpecialScalar(p, pe);
+}
+
+/// Finds the first '"', '\\', control char or non ASCII char, 32 at a time
+__attribute__((target("avx2"))) inline const char *
+findNonASCIISpecialAVX2(const char *p, const char *pe) {
+  const __m256i control = _mm256_set1_epi8(0x1F);
+  while (pe - p >= 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i special = _mm256_or_si256(
+        _mm256_or_si256(avx2Equal(chunk, '"'), avx2Equal(chunk, '\\')),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+    uint64_t bits = avx2Bits(_mm256_or_si256(special, chunk));
+    if (bits)
+      return p + firstBit(bits);
+    p += 32;
+  }
+  return findNonASCIISpecialSSE42(p, pe);
+}
+
+/// Finds the brackets, quotes and backslashes in a block, 16 chars at a time
+__attribute__((target("sse4.2"))) inline BracketMasks
+classifyBracketsSSE42(const char *block) {
+  BracketMasks result{0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+    // '[' and '{' (and ']' and '}') only differ in bit 0x20
+    __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    auto bits = [](__m128i mask) -> uint64_t {
+      return static_cast<uint16_t>(_mm_movemask_epi8(mask));
+    };
+    result.open |= bits(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{'))) << (i * 16);
+    result.close |= bits(_mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))) << (i * 16);
+    result.quote |= bits(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))) << (i * 16);
+    result.backslash |= bits(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')))
+                        << (i * 16);
+  }
+  return result;
+}
+
+/// Finds the brackets, quotes and backslashes in a block, 32 chars at a time
+__attribute__((target("avx2"))) inline BracketMasks
+classifyBracketsAVX2(const char *block) {
+  BracketMasks result{0, 0, 0, 0};
+  for (int i = 0; i < 2; ++i) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i * 32));
+    __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    result.open |= avx2Bits(avx2Equal(folded, '{')) << (i * 32);
+    result.close |= avx2Bits(avx2Equal(folded, '}')) << (i * 32);
+    result.quote |= avx2Bits(avx2Equal(chunk, '"')) << (i * 32);
+    result.backslash |= avx2Bits(avx2Equal(chunk, '\\')) << (i * 32);
+  }
+  return result;
+}
+
+/// Classifies a block for validate(), 16 chars at a time
+__attribute__((target("sse4.2"))) inline ValidationMasks
+classifyForValidationSSE42(const char *block) {
+  ValidationMasks result{0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+    auto equal = [chunk](char c) {
+      return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+    };
+    auto bits = [i](__m128i mask) -> uint64_t {
+      return static_cast<uint64_t>(
+                 static_cast<uint16_t>(_mm_movemask_epi8(mask)))
+             << (i * 16);
+    };
+    __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    __m128i control = _mm_cmpeq_epi8(
+        _mm_min_epu8(chunk, _mm_set1_epi8(0x1F)), chunk);
+    result.whitespace |= bits(_mm_or_si128(_mm_or_si128(equal(' '), equal('\t')),
+                                           _mm_or_si128(equal('\n'), equal('\r'))));
+    result.structural |= bits(_mm_or_si128(
+        _mm_or_si128(equal(','), equal(':')),
+        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                     _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')))));
+    result.quote |= bits(equal('"'));
+    result.backslash |= bits(equal('\\'));
+    result.control |= bits(control);
+    result.nonASCII |= bits(chunk);
+  }
+  return result;
+}
+
+/// Classifies a block for validate(), 32 chars at a time
+__attribute__((target("avx2"))) inline ValidationMasks
+classifyForValidationAVX2(const char *block) {
+  ValidationMasks result{0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < 2; ++i) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i * 32));
+    __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    __m256i ws =
+        _mm256_or_si256(_mm256_or_si256(avx2Equal(chunk, ' '), avx2Equal(chunk, '\t')),
+                        _mm256_or_si256(avx2Equal(chunk, '\n'), avx2Equal(chunk, '\r')));
+    __m256i st = _mm256_or_si256(
+        _mm256_or_si256(avx2Equal(chunk, ','), avx2Equal(chunk, ':')),
+        _mm256_or_si256(avx2Equal(folded, '{'), avx2Equal(folded, '}')));
+    __m256i control = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(chunk, _mm256_set1_epi8(0x1F)), chunk);
+    result.whitespace |= avx2Bits(ws) << (i * 32);
+    result.structural |= avx2Bits(st) << (i * 32);
+    result.quote |= avx2Bits(avx2Equal(chunk, '"')) << (i * 32);
+    result.backslash |= avx2Bits(avx2Equal(chunk, '\\')) << (i * 32);
+    result.control |= avx2Bits(control) << (i * 32);
+    result.nonASCII |= avx2Bits(chunk) << (i * 32);
+  }
+  return result;
+}
+
+/// Finds the '\n's in a block, 16 chars at a time
+__attribute__((target("sse4.2"))) inline uint64_t
+newlinesSSE42(const char *block) {
+  uint64_t result = 0;
+  for (int i = 0; i < 4; ++i) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+    result |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(
+                  _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')))))
+              << (i * 16);
+  }
+  return result;
+}
+
+/// Finds the '\n's in a block, 32 chars at a time
+__attribute__((target("avx2"))) inline uint64_t
+newlinesAVX2(const char *block) {
+  uint64_t result = 0;
+  for (int i = 0; i < 2; ++i) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i * 32));
+    result |= avx2Bits(avx2Equal(chunk, '\n')) << (i * 32);
+  }
+  return result;
+}
+
+#endif
+
+/// Works out the best instruction set that this CPU supports
+inline InstructionSet detectInstructionSet() {
+#ifdef JSON_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return avx2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return sse42;
+#endif
+  return scalar;
+}
+
+/// The instruction set that we use; worked out on the first call
+inline InstructionSet instructionSet() {
+  static const InstructionSet result = detectInstructionSet();
+  return result;
+}
+
+using Classifier = BlockMasks (*)(const char *);
+
+/// Returns the classify function for an instruction set
+inline Classifier classifierFor(InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case avx2:
+    return classifyAVX2;
+  case sse42:
+    return classifySSE42;
+  case scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return classifyScalar;
+}
+
+/// Classifies a block with the best classifier for this CPU
+inline BlockMasks classify(const char *block) {
+  static const Classifier classifier = classifierFor(instructionSet());
+  return classifier(block);
+}
+
+using StringScanner = const char *(*)(const char *, const char *);
+
+/// Returns the string scanner for an instruction set
+inline StringScanner stringScannerFor(InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case avx2:
+    return findStringSpecialAVX2;
+  case sse42:
+    return findStringSpecialSSE42;
+  case scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return findStringSpecialScalar;
+}
+
+/**
+ * @brief Finds the end of a run of chars that can be copied out of a JSON
+ * string as they are
+ *
+ * @param p The start of the input
+ * @param pe One past the end of the input
+ * @returns The first '"', '\\' or control char, or pe if there isn't one
+ */
+inline const char *findStringSpecial(const char *p, const char *pe) {
+  static const StringScanner scanner = stringScannerFor(instructionSet());
+  return scanner(p, pe);
+}
+
+/// Returns the non ASCII scanner for an instruction set
+inline StringScanner nonASCIIScannerFor(InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case avx2:
+    return findNonASCIISpecialAVX2;
+  case sse42:
+    return findNonASCIISpecialSSE42;
+  case scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return findNonASCIISpecialScalar;
+}
+
+/**
+ * @brief Finds the end of a run of chars that can be written into an ASCII
+ * only JSON string as they are
+ *
+ * @param p The start of the input
+ * @param pe One past the end of the input
+ * @returns The first '"', '\\', control char or byte from 0x80 up, or pe if
+ *          there isn't one
+ */
+inline const char *findNonASCIISpecial(const char *p, const char *pe) {
+  static const StringScanner scanner = nonASCIIScannerFor(instructionSet());
+  return scanner(p, pe);
+}
+
+using BracketClassifier = BracketMasks (*)(const char *);
+
+/// Returns the bracket classifier for an instruction set
+inline BracketClassifier bracketClassifierFor(InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case avx2:
+    return classifyBracketsAVX2;
+  case sse42:
+    return classifyBracketsSSE42;
+  case scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return classifyBracketsScalar;
+}
+
+using ValidationClassifier = ValidationMasks (*)(const char *);
+
+/// Returns the validate() classifier for an instruction set
+inline ValidationClassifier validationClassifierFor(InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case avx2:
+    return classifyForValidationAVX2;
+  case sse42:
+    return classifyForValidationSSE42;
+  case scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return classifyForValidationScalar;
+}
+
+using NewlineFinder = uint64_t (*)(const char *);
+
+/// Returns the newline finder for an instruction set
+inline NewlineFinder newlineFinderFor(InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case avx2:
+    return newlinesAVX2;
+  case sse42:
+    return newlinesSSE42;
+  case scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return newlinesScalar;
+}
+
+/// A place in some text. Both count from 1; columns are in bytes.
+struct TextLocation {
+  size_t row;
+  size_t col;
+};
+
+/**
+ * @brief Works out the row and column of a char by counting the lines before
+ * it, 64 bytes at a time
+ *
+ * @param p The start of the text
+ * @param at The char to find; somewhere in [p, end of the text]
+ */
+inline TextLocation locate(const char *p, const char *at) {
+  static const NewlineFinder finder = newlineFinderFor(instructionSet());
+  TextLocation result{1, 1};
+  const char *lineStart = p;
+  while (at - p >= static_cast<std::ptrdiff_t>(blockSize)) {
+    uint64_t newlines = finder(p);
+    if (newlines) {
+      result.row += popCount(newlines);
+      lineStart = p + lastBit(newlines) + 1;
+    }
+    p += blockSize;
+  }
+  for (; p != at; ++p)
+    if (*p == '\n') {
+      ++result.row;
+      lineStart = p + 1;
+    }
+  result.col = at - lineStart + 1;
+  return result;
+}
+
+/// For each bit, the xor of it and all the bits below it. Applied to the
+/// quote mask, that sets the bits from each opening quote up to (but not
+/// including) its closing quote.
+inline uint64_t prefixXor(uint64_t bits) {
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+/// Where we are while skipping over arrays and objects
+struct SkipState {
+  size_t depth;  // How many brackets we still need to close
+  bool inString; // Inside a string
+  bool escaped;  // The next block's first char is escaped by a backslash
+};
+
+/**
+ * @brief Finds the chars that are escaped by a backslash
+ *
+ * A backslash escapes the next char unless it's escaped itself, so in each
+ * run of backslashes every other one counts, starting with the first. Adding
+ * the start of each odd positioned run to the run carries through it; the bits
+ * that flip tell us which runs have an odd length. The same trick as in
+ * simdjson.
+ *
+ * @param backslash The backslashes in the block
+ * @param carry In: whether the first char is escaped by the last block. Out:
+ *              whether the first char of the next block is.
+ * @returns A mask of the escaped chars
+ */
+inline uint64_t escapedChars(uint64_t backslash, bool &carry) {
+  const uint64_t evenBits = 0x5555555555555555ULL;
+  const uint64_t carried = carry ? 1 : 0;
+  backslash &= ~carried;
+  const uint64_t followsEscape = (backslash << 1) | carried;
+  const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+  const uint64_t evenRuns = oddStarts + backslash;
+  carry = evenRuns < backslash; // It overflowed
+  const uint64_t invert = evenRuns << 1;
+  return (evenBits ^ invert) & followsEscape;
+}
+
+/**
+ * @brief Skips over part of one 64 byte block
+ *
+ * Quotes that aren't escaped toggle whether we're in a string; a prefix xor
+ * of them masks out the brackets inside strings. If there are fewer closing
+ * brackets than levels left to close, we just count them.
+ *
+ * @returns The position just after the bracket that closes the last level
+ *          (state.depth is then 0), or blockSize if it isn't in this block
+ */
+inline size_t skipBlock(const char *block, SkipState &state) {
+  static const BracketClassifier classifier =
+      bracketClassifierFor(instructionSet());
+  BracketMasks masks = classifier(block);
+  if (masks.backslash || state.escaped)
+    masks.quote &= ~escapedChars(masks.backslash, state.escaped);
+  const uint64_t inside =
+      prefixXor(masks.quote) ^ (state.inString ? ~uint64_t(0) : 0);
+  state.inString = (inside >> 63) != 0;
+  const uint64_t open = masks.open & ~inside;
+  const uint64_t close = masks.close & ~inside;
+  const int closing = popCount(close);
+  if (static_cast<size_t>(closing) < state.depth) {
+    // The depth can't get to zero in this block
+    state.depth += popCount(open) - closing;
+    return blockSize;
+  }
+  for (uint64_t brackets = open | close; brackets;
+       brackets &= brackets - 1) {
+    const int i = firstBit(brackets);
+    if (open & (uint64_t(1) << i))
+      ++state.depth;
+    else if (--state.depth == 0)
+      return i + 1;
+  }
+  return blockSize;
+}
+
+/**
+ * @brief Skips to the end of the arrays and objects that we're inside
+ *
+ * Only brackets and string boundaries are looked at; the json in between
+ * isn't checked.
+ *
+ * @param p Somewhere inside an array or object, but not inside a string
+ * @param pe One past the end of the input
+ * @param levels How many arrays and objects to skip out of
+ * @returns Just after the bracket that closes the outermost one, or nullptr
+ *          if the input ends first
+ */
+inline const char *skipContainers(const char *p, const char *pe,
+                                  size_t levels) {
+  SkipState state{levels, false, false};
+  while (pe - p >= static_cast<std::ptrdiff_t>(blockSize)) {
+    size_t used = skipBlock(p, state);
+    if (state.depth == 0)
+      return p + used;
+    p += blockSize;
+  }
+  if (p == pe)
+    return nullptr;
+  // Pad the tail with spaces, which don't mean anything here
+  char block[blockSize];
+  std::memset(block, ' ', blockSize);
+  std::memcpy(block, p, pe - p);
+  size_t used = skipBlock(block, state);
+  return state.depth == 0 ? p + used : nullptr;
+}
+
+/// Classifies the last (less than 64 byte) piece of the input. The missing
+/// bytes are filled with a char that is neither whitespace nor structural, so
+/// they just look like more significant input
+inline BlockMasks classifyTail(const char *p, const char *pe) {
+  assert(pe - p < static_cast<std::ptrdiff_t>(blockSize));
+  char block[blockSize];
+  std::memset(block, 'x', blockSize);
+  std::memcpy(block, p, pe - p);
+  return classify(block);
+}
+
+/**
+ * @brief Returns a pointer to the first non whitespace char in [p, pe)
+ *
+ * Indentation in pretty printed JSON comes in long runs, so after checking the
+ * first char by hand, we classify whole blocks and jump to the first char that
+ * isn't whitespace.
+ *
+ * @param p The start of the input
+ * @param pe One past the end of the input
+ * @returns The first non whitespace char, or pe if it's all whitespace
+ */
+inline const char *skipWhitespace(const char *p, const char *pe) {
+  if (p == pe)
+    return p;
+  switch (*p) {
+  case ' ':
+  case '\t':
+  case '\n':
+  case '\r':
+    break;
+  default:
+    return p;
+  }
+  while (pe - p >= static_cast<std::ptrdiff_t>(blockSize)) {
+    uint64_t significant = ~classify(p).whitespace;
+    if (significant)
+      return p + firstBit(significant);
+    p += blockSize;
+  }
+  if (p == pe)
+    return p;
+  uint64_t significant = ~classifyTail(p, pe).whitespace;
+  return p + firstBit(significant);
+}
+
+/**
+ * @brief Runs a pointer based scanner over a contiguous iterator range
+ *
+ * @param p The iterator to start from. It's moved to where the scanner stopped.
+ * @param pe One past the end of the input
+ * @param scanner Called with (const char* begin, const char* end) and must
+ *                return a pointer in that range
+ */
+template <typename Iterator, typename Scanner>
+inline void scanContiguous(Iterator &p, const Iterator &pe, Scanner scanner) {
+  BOOST_HANA_CONSTANT_ASSERT(is_contiguous_iterator(p));
+  if (p == pe)
+    return;
+  const char *begin = &*p;
+  const char *end = begin + (pe - p);
+  p += scanner(begin, end) - begin;
+}
+
+} // namespace simd
+} // namespace json
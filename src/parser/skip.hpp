@@ -0,0 +1,156 @@
+/// Moves past json values without decoding them
+///
+/// Skipping only tracks nesting depth and where strings start and end, so it
+/// doesn't check that the skipped json is valid; it only complains if the
+/// input ends part way through. Contiguous char input is skipped 64 bytes at
+/// a time with the vectorized scanners in simd.hpp.
+#pragma once
+
+#include "outer.hpp"
+#include "simd.hpp"
+#include "status.hpp"
+#include "string.hpp"
+#include "utils.hpp"
+
+#include <iterator>
+
+namespace json {
+
+/// Moves past the rest of a number. getNextOuterToken doesn't consume any of
+/// it.
+template <typename Status> inline void skipNumber(Status &status) {
+  auto &p = status.p;
+  while (p != status.pe) {
+    switch (*p) {
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+    case '-': case '+': case '.': case 'e': case 'E':
+      ++p;
+      continue;
+    default:
+      return;
+    }
+  }
+}
+
+/// Moves past the rest of a string, from just after its opening quote
+template <typename Status> inline void skipString(Status &status) {
+  hana::if_(is_contiguous_iterator(status.p),
+            [](auto &status) {
+              auto &p = status.p;
+              const auto &pe = status.pe;
+              while (p != pe) {
+                simd::scanContiguous(p, pe, simd::findStringSpecial);
+                if (p == pe)
+                  break;
+                switch (*p++) {
+                case '"':
+                  return;
+                case '\\':
+                  if (p != pe)
+                    ++p;
+                  break;
+                default:
+                  break; // A control char. Not our problem here.
+                }
+              }
+              status.onError(ErrorCode::unexpectedEnd,
+                             "Hit the end of input inside a string");
+            },
+            [](auto &status) {
+              std::advance(status.p, getRawStringLength(status));
+              if (status.p == status.pe) {
+                status.onError(ErrorCode::unexpectedEnd,
+                               "Hit the end of input inside a string");
+                return;
+              }
+              ++status.p; // The closing quote
+            })(status);
+}
+
+/**
+ * @brief Moves past the end of the arrays and objects that we're inside
+ *
+ * @param status The parser status; somewhere inside an array or object, but
+ *               not inside a string
+ * @param levels How many arrays and objects to skip out of
+ */
+template <typename Status>
+inline void skipContainers(Status &status, size_t levels = 1) {
+  hana::if_(is_contiguous_iterator(status.p),
+            [](auto &status, size_t levels) {
+              auto &p = status.p;
+              const auto &pe = status.pe;
+              if (p != pe) {
+                const char *begin = &*p;
+                const char *stop =
+                    simd::skipContainers(begin, begin + (pe - p), levels);
+                if (stop) {
+                  p += stop - begin;
+                  return;
+                }
+                // Not 'p = pe', so a LocatingIterator keeps its start
+                p += pe - p;
+              }
+              status.onError(ErrorCode::unexpectedEnd,
+                             "Hit the end of input inside an array or object");
+            },
+            [](auto &status, size_t levels) {
+              auto &p = status.p;
+              while (p != status.pe) {
+                switch (*p++) {
+                case '"':
+                  skipString(status);
+                  break;
+                case '[':
+                case '{':
+                  ++levels;
+                  break;
+                case ']':
+                case '}':
+                  if (--levels == 0)
+                    return;
+                  break;
+                default:
+                  break;
+                }
+              }
+              status.onError(ErrorCode::unexpectedEnd,
+                             "Hit the end of input inside an array or object");
+            })(status, levels);
+}
+
+/**
+ * @brief Moves past the next value without decoding it
+ *
+ * @param status The parser status
+ * @param token The value's token, if the caller already read it
+ */
+template <typename Status>
+inline void skipValue(Status &status, Token token = ERROR) {
+  BOOST_HANA_CONSTANT_ASSERT(is_valid_status(status));
+  if (token == ERROR)
+    token = require(valueTokens(), status);
+  switch (token) {
+  case null:
+    readNull(status);
+    break;
+  case boolean:
+    readBoolean(status);
+    break;
+  case number:
+    skipNumber(status);
+    break;
+  case string:
+    skipString(status);
+    break;
+  case array:
+  case object:
+    skipContainers(status);
+    break;
+  default:
+    status.onError(ErrorCode::unexpectedToken, "Expected a value to skip");
+  }
+}
+
+} // namespace json
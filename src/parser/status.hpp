@@ -8,19 +8,27 @@ namespace json {
 auto is_comparable_to_char =
     hana::is_valid([](auto &&x) -> decltype(x == 'c') {});
 
+/**
+ * @brief Where the parser is up to, and what to do when it finds an error
+ *
+ * @tparam ErrorPolicy An ErrorThrower (the default), or one of the error
+ *                     policies in error.hpp if you know at compile time what
+ *                     you want done with errors
+ */
 template <typename Iterator,
-          typename Iterator_traits = std::iterator_traits<Iterator>>
+          typename Iterator_traits = std::iterator_traits<Iterator>,
+          typename ErrorPolicy = ErrorThrower<Iterator>>
 struct Status {
 
   using iterator = Iterator;
   using iterator_traits = Iterator_traits;
+  using error_policy = ErrorPolicy;
 
   iterator p;
   iterator pe;
-  ErrorThrower<iterator> _onError = throwError<iterator>;
+  ErrorPolicy _onError;
 
-  Status(iterator p, iterator pe,
-         ErrorThrower<iterator> onError = throwError<iterator>)
+  Status(iterator p, iterator pe, ErrorPolicy onError = throwError<iterator>)
       : p(p), pe(pe), _onError(onError) {
     BOOST_HANA_CONSTANT_ASSERT(is_input_iterator(p));
     BOOST_HANA_CONSTANT_ASSERT(is_comparable_to_char(*p));
@@ -33,13 +41,23 @@ struct Status {
     return *this;
   }
 
-  void onError(const std::string& msg) const {
-    if (_onError)
-      _onError(msg, p);
+  /**
+   * @brief Reports an error at 'p'
+   *
+   * @param code What kind of error it is
+   * @param msg The message; a string, or something that makes one when it's
+   *            called, for messages that are expensive to build
+   */
+  template <typename Message> void onError(ErrorCode code, Message &&msg) {
+    reportError(_onError, code, std::forward<Message>(msg), p, pe);
   }
 
-  Status<Iterator, Iterator_traits> copy() const {
-    Status<Iterator, Iterator_traits> result = *this;
+  /// True if an error was reported and parsing carried on anyway; the parse
+  /// is winding up, so don't send any more results
+  bool failed() const { return hasFailed(_onError); }
+
+  Status copy() const {
+    Status result = *this;
     return result;
   }
 
@@ -53,6 +71,16 @@ make_status(iterator p, iterator pe,
   return Status<iterator, iterator_traits>(p, pe, onError);
 }
 
+/// Makes a Status that sends its errors to one of the error policies in
+/// error.hpp, eg. make_status(p, pe, RecordErrors<const char*>(error))
+template <typename iterator, typename Policy,
+          typename = std::enable_if_t<std::is_base_of<ErrorPolicy, Policy>::value>>
+Status<iterator, std::iterator_traits<iterator>, Policy>
+make_status(iterator p, iterator pe, Policy onError) {
+  return Status<iterator, std::iterator_traits<iterator>, Policy>(p, pe,
+                                                                  onError);
+}
+
 /// Check if something is a valid status
 
 auto is_valid_status = [](auto && status) {
@@ -78,8 +106,8 @@ template <typename Status,
 inline bool
 checkStaticString(Status& status, const Char *expected) {
   BOOST_HANA_CONSTANT_CHECK(is_valid_status(status));
-  while (*expected)
-    if ((*expected++) != (*status.p++))
+  for (; *expected; ++expected, ++status.p)
+    if ((status.p == status.pe) || (*expected != *status.p))
       return false;
   return true;
 }
@@ -97,7 +125,8 @@ template <typename Status,
 inline void requireStaticString(Status &status, const Char *expected) {
   BOOST_HANA_CONSTANT_CHECK(is_valid_status(status));
   if (!checkStaticString(status, expected))
-    status.onError(std::string("Static String '") + expected +
-                   "' doesn't match");
+    status.onError(ErrorCode::badLiteral, [expected]() {
+      return std::string("Static String '") + expected + "' doesn't match";
+    });
 }
 }
@@ -5,6 +5,7 @@
 #include "../unicode.hpp"
 #include "status.hpp"
 #include "utf8_writer.hpp"
+#include "simd.hpp"
 
 #include <string>
 #include <algorithm>
@@ -14,19 +15,29 @@
 namespace json {
 
 /// When we come across a block of normal chars, return the char just past the
-/// end of it
+/// end of it. Stops on '"', '\\' and unescaped control chars, which aren't
+/// allowed in a JSON string.
 template <typename Iterator>
 inline Iterator findEndOfUnchangedCharBlock(Iterator p, Iterator pe) {
-  while (p != pe) {
-    switch (*p) {
-    case '\\':
-    case '"':
-      return p;
-    default:
-      ++p;
-    };
-  }
-  return p;
+  return hana::if_(is_contiguous_iterator(p),
+                   [](auto p, const auto &pe) {
+                     simd::scanContiguous(p, pe, simd::findStringSpecial);
+                     return p;
+                   },
+                   [](auto p, const auto &pe) {
+                     while (p != pe) {
+                       switch (*p) {
+                       case '\\':
+                       case '"':
+                         return p;
+                       default:
+                         if (simd::isControlChar(*p))
+                           return p;
+                         ++p;
+                       };
+                     }
+                     return p;
+                   })(p, pe);
 }
 
 /// Most basic string parser. Calls back functions for each token/block that it
@@ -35,12 +46,13 @@ template <typename Status,
           typename f1 = std::function<
               void(typename Status::iterator, typename Status::iterator)>,
           typename f2 =
-              std::function<void(typename Status::iterator_traits::value_type)>>
+              std::function<void(typename Status::iterator_traits::value_type)>,
+          typename f3 = std::function<void(char32_t)>>
 inline void
 parseString(Status &status,
             f1 recordUnchangedChars, /// Takes the begin and end iterators of a
                                      /// block of unchanged chars
-            f2 recordChar, std::function<void(char32_t)> recordUnicode) {
+            f2 recordChar, f3 recordUnicode) {
 
   BOOST_HANA_CONSTANT_CHECK(is_valid_status(status));
   BOOST_HANA_CONSTANT_ASSERT(is_forward_iterator(status.p));
@@ -56,13 +68,8 @@ parseString(Status &status,
     int uniCharNibbles = 0;
     auto& p = s.p;
     auto& pe = s.pe;
-    while (p != pe) {
-      if (uniCharNibbles == 8) {
-        std::stringstream msg;
-        msg << "A unicode character must be of the format \u0000 where 0000 "
-               "are 4 hexadecimal characters";
-        s.onError(msg.str());
-      }
+    // Exactly 4 hex chars; anything after them is just more of the string
+    while ((p != pe) && (uniCharNibbles < 4)) {
       Char ch = *p;
       if ((ch >= '0') && (ch <= '9')) {
         *u <<= 4;
@@ -81,21 +88,29 @@ parseString(Status &status,
     // See how many hex characters we got
     switch (uniCharNibbles) {
     case 0:
-      s.onError("\\u with no hex after it");
+      s.onError(ErrorCode::badString, "\\u with no hex after it");
+      return *u;
     case 1:
     case 2:
     case 3:
-      s.onError("\\u needs 4 hex chars after it");
+      s.onError(ErrorCode::badString, "\\u needs 4 hex chars after it");
+      return *u;
     case 4:
-      // See if we're followed by another \u
-      auto peeker = s;
-      if (checkStaticString(peeker, R"(\u)")) {
-        u[1] = readUnicode(peeker);
-        char32_t result;
-        // Decode the two utf chars
-        from16(u, &result);
-        s = peeker;
-        return result;
+      // The first half of a surrogate pair should be followed by a \u with the
+      // second half
+      if ((*u >= 0xD800) && (*u <= 0xDBFF)) {
+        auto peeker = s;
+        if (checkStaticString(peeker, R"(\u)")) {
+          char32_t low = readUnicode(peeker);
+          if ((low >= 0xDC00) && (low <= 0xDFFF)) {
+            u[1] = static_cast<char16_t>(low);
+            char32_t result;
+            // Decode the two utf chars
+            from16(u, &result);
+            s = peeker;
+            return result;
+          }
+        }
       }
       return *u;
     }
@@ -106,7 +121,12 @@ parseString(Status &status,
   /// @return true if we handled it; false if it turned out to be just an normal
   /// char (eg '\\')
   auto handleEscape = [&]() {
-    switch (*++p) {
+    if (++p == pe) {
+      status.onError(ErrorCode::unexpectedEnd,
+                     "Hit the end of input inside a string");
+      return true;
+    }
+    switch (*p) {
     case 'b':
       recordChar('\b');
       ++p;
@@ -152,12 +172,21 @@ parseString(Status &status,
     // chain of normal chars, so don't break out of the switch statement here;
     // continue on to handle the chain
     default: {
+      if (simd::isControlChar(*p)) {
+        status.onError(ErrorCode::badString,
+                       "Unescaped control character in string");
+        return;
+      }
+      // The first char is always part of the block, even if it's an escaped
+      // '"' or '\\'
       unchangedCharsStart = p;
-      p = findEndOfUnchangedCharBlock(p, pe);
+      p = findEndOfUnchangedCharBlock(++p, pe);
       recordUnchangedChars(unchangedCharsStart, p);
     }
     }
   }
+  status.onError(ErrorCode::unexpectedEnd,
+                 "Hit the end of input inside a string");
 }
 
 /**
@@ -206,7 +235,7 @@ template <typename Iterator> struct string_reference {
 template <typename Status>
 inline size_t getRawStringLength(Status status) {
 
-  BOOST_HANA_CONSTANT_CHECK_MESSAGE(is_valid_status(status),
+  BOOST_HANA_CONSTANT_CHECK_MSG(is_valid_status(status),
                                     "The status object must have "
                                     "iterators p, pe, and an error "
                                     "thrower function; onError");
@@ -366,9 +395,9 @@ size_t copyRawString(Status &status, OutputIterator out) {
 /**
  * @brief Decodes a json string to an output iterator
  *
- * It's advisable to use getDecodedStringLength() or getRawStringLength() to
- * allocate the memory needed in one go, as allocating on the fly can cause
- * unnecessary memory copying.
+ * Works in a single pass over the input. If the output needs its memory
+ * allocated up front, getDecodedStringLength() can size it, at the cost of
+ * a second pass.
  *
  * @tparam Status Some kind of parser.hpp Status template instantiation
  * @param Status A reference to a valid parser status instance
@@ -400,14 +429,71 @@ inline void decodeString(Status &status, OutputIterator out) {
   parseString(status, recordUnchangedChars, recordChar, recordUnicode);
 }
 
-/// Decodes a JSON string
-template <typename Status> std::string decodeString(Status &status) {
+/**
+ * @brief Decodes a JSON string from contiguous chars in a single pass
+ *
+ * Most strings have no escapes, so we find the first special char with the
+ * vectorized scanner and, if it's the closing quote, copy the whole string
+ * with one memcpy. Otherwise we carry on with parseString from the first
+ * escape, appending the rest and letting 'out' grow as it needs to.
+ *
+ * @tparam Status Some kind of parser.hpp Status template instantiation
+ * @param status A reference to a valid parser status, just after the first '"'
+ * @param out The decoded string is appended to this
+ */
+template <typename Status, typename String>
+inline void decodeContiguousString(Status &status, String &out) {
+  BOOST_HANA_CONSTANT_ASSERT(is_contiguous_iterator(status.p));
+
+  using Iterator = typename Status::iterator;
+  auto &p = status.p;
+  const auto &pe = status.pe;
+
+  auto append = [&out](Iterator begin, Iterator end) {
+    if (begin != end)
+      out.append(&*begin, end - begin);
+  };
+
+  // Fast path: a run of plain chars followed by the closing quote
+  Iterator runStart = p;
+  p = findEndOfUnchangedCharBlock(p, pe);
+  append(runStart, p);
+  if ((p != pe) && (*p == '"')) {
+    ++p;
+    return;
+  }
+
+  // Slow path: we hit an escape (or an error, which parseString reports)
+  auto recordChar = [&out](char c) { out.push_back(c); };
+  auto recordUnicode = [&out](char32_t u) {
+    utf8encode(u, std::back_inserter(out));
+  };
+  parseString(status, append, recordChar, recordUnicode);
+}
+
+/**
+ * @brief Decodes a JSON string onto the end of a std::basic_string
+ *
+ * @param status A reference to a valid parser status, just after the first '"'
+ * @param out The string to append to. It keeps its own allocator.
+ */
+template <typename Status, typename String>
+inline void appendDecodedString(Status &status, String &out) {
   BOOST_HANA_CONSTANT_ASSERT(is_valid_status(status));
   BOOST_HANA_CONSTANT_ASSERT(is_forward_iterator(status.p));
+  hana::if_(is_contiguous_iterator(status.p),
+            [](auto &status, auto &out) {
+              decodeContiguousString(status, out);
+            },
+            [](auto &status, auto &out) {
+              decodeString(status, std::back_inserter(out));
+            })(status, out);
+}
 
+/// Decodes a JSON string
+template <typename Status> std::string decodeString(Status &status) {
   std::string result;
-  result.reserve(getDecodedStringLength(status));
-  decodeString(status, std::back_inserter(result));
+  appendDecodedString(status, result);
   return result;
 }
 }
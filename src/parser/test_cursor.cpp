@@ -0,0 +1,147 @@
+/// Tests reading json on demand with a Cursor
+
+#include <bandit/bandit.h>
+
+#include "cursor.hpp"
+#include "LocatingIterator.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+go_bandit([]() {
+
+  describe("Cursor", [&]() {
+
+    const std::string json = R"({
+      "skipped": {"deep": [1, [2, "]}"], {"x": "\"}"}], "n": null},
+      "name": "Widget",
+      "tags": ["a", "b\n", "c"],
+      "size": {"w": 12, "h": 2.5, "unit": "cm"},
+      "ok": true,
+      "count": -7
+    })";
+
+    it("1.0 Finds members and skips the ones before them", [&]() {
+      auto status = make_status(json.data(), json.data() + json.size());
+      auto cursor = makeCursor(status);
+      auto root = cursor.enterObject();
+      AssertThat(root.find("name"), Equals(true));
+      AssertThat(cursor.type(), Equals(string));
+      AssertThat(cursor.readString(), Equals("Widget"));
+      AssertThat(root.find("ok"), Equals(true));
+      AssertThat(cursor.readBoolean(), Equals(true));
+      AssertThat(root.find("count"), Equals(true));
+      AssertThat(cursor.readNumber<int>(), Equals(-7));
+      AssertThat(root.next(), Equals(false));
+      AssertThat(status.p, Equals(json.data() + json.size()));
+    });
+
+    it("1.1 Walks arrays and nested objects", [&]() {
+      auto status = make_status(json.data(), json.data() + json.size());
+      auto cursor = makeCursor(status);
+      auto root = cursor.enterObject();
+      std::vector<std::string> keys, tags;
+      double width = 0, height = 0;
+      while (root.next()) {
+        keys.push_back(root.key());
+        if (root.key() == "tags") {
+          auto list = cursor.enterArray();
+          while (list.next())
+            tags.push_back(cursor.readString());
+        } else if (root.key() == "size") {
+          auto size = cursor.enterObject();
+          while (size.next())
+            if (size.key() == "w")
+              width = cursor.readNumber<double>();
+            else if (size.key() == "h")
+              height = cursor.readNumber<double>();
+        }
+      }
+      AssertThat(keys, Equals(std::vector<std::string>{
+                           "skipped", "name", "tags", "size", "ok", "count"}));
+      AssertThat(tags, Equals(std::vector<std::string>{"a", "b\n", "c"}));
+      AssertThat(width, Equals(12));
+      AssertThat(height, Equals(2.5));
+      AssertThat(status.p, Equals(json.data() + json.size()));
+    });
+
+    it("1.2 Skips what's left of containers that it stops reading", [&]() {
+      std::string input = R"([[1, 2, [3, {"a": "]"}]], "after", [[[]]], 4])";
+      auto status = make_status(input.data(), input.data() + input.size());
+      auto cursor = makeCursor(status);
+      auto outer = cursor.enterArray();
+      AssertThat(outer.next(), Equals(true));
+      auto inner = cursor.enterArray();
+      AssertThat(inner.next(), Equals(true));
+      AssertThat(cursor.readNumber<int>(), Equals(1));
+      // Abandon 'inner' part way through
+      AssertThat(outer.next(), Equals(true));
+      AssertThat(cursor.readString(), Equals("after"));
+      AssertThat(outer.next(), Equals(true));
+      AssertThat(cursor.type(), Equals(array)); // Looked at but not read
+      AssertThat(outer.next(), Equals(true));
+      AssertThat(cursor.readNumber<int>(), Equals(4));
+      AssertThat(outer.next(), Equals(false));
+      AssertThat(outer.next(), Equals(false));
+      AssertThat(status.p, Equals(input.data() + input.size()));
+    });
+
+    it("1.3 Reads empty containers and plain values", [&]() {
+      std::string input = R"([[], {}, null, 1e3])";
+      auto status = make_status(input.data(), input.data() + input.size());
+      auto cursor = makeCursor(status);
+      auto outer = cursor.enterArray();
+      AssertThat(outer.next(), Equals(true));
+      AssertThat(cursor.enterArray().next(), Equals(false));
+      AssertThat(outer.next(), Equals(true));
+      AssertThat(cursor.enterObject().next(), Equals(false));
+      AssertThat(outer.next(), Equals(true));
+      cursor.readNull();
+      AssertThat(outer.next(), Equals(true));
+      AssertThat(cursor.readNumber<double>(), Equals(1000));
+      AssertThat(outer.next(), Equals(false));
+    });
+
+    it("1.4 Complains about the wrong type", [&]() {
+      std::string input = R"({"a": "text"})";
+      auto status = make_status(input.data(), input.data() + input.size());
+      auto cursor = makeCursor(status);
+      auto root = cursor.enterObject();
+      AssertThat(root.next(), Equals(true));
+      AssertThrows(ParserError, cursor.readNumber());
+      AssertThat(LastException<ParserError>().what(),
+                 Equals(std::string("Expected '0' but got '\"' instead")));
+    });
+
+    it("1.5 Complains about input that ends inside a skipped value", [&]() {
+      std::string input = R"({"a": [1, "2]", {}, "b": 1})";
+      auto status = make_status(input.data(), input.data() + input.size());
+      auto cursor = makeCursor(status);
+      auto root = cursor.enterObject();
+      AssertThrows(ParserError, root.find("b"));
+    });
+
+    it("1.6 Works on forward iterators", [&]() {
+      std::list<char> input(json.begin(), json.end());
+      auto status = make_status(makeLocating(input.begin()),
+                                makeLocating(input.end()));
+      auto cursor = makeCursor(status);
+      auto root = cursor.enterObject();
+      AssertThat(root.find("size"), Equals(true));
+      auto size = cursor.enterObject();
+      AssertThat(size.find("unit"), Equals(true));
+      AssertThat(cursor.readString(), Equals("cm"));
+      AssertThat(root.find("nothing"), Equals(false));
+      AssertThat(status.p == status.pe, Equals(true));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -0,0 +1,157 @@
+/// Tests decimal to double conversion against strtod
+
+#include <bandit/bandit.h>
+
+#include "decimal.hpp"
+#include "number.hpp"
+#include "error.hpp"
+
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Our answer for 'json', as bits
+uint64_t ours(const std::string &json) {
+  auto status = make_status(json.cbegin(), json.cend());
+  double result = readNumber<double>(status);
+  uint64_t bits;
+  std::memcpy(&bits, &result, sizeof(bits));
+  return bits;
+}
+
+/// strtod's answer for 'json', as bits
+uint64_t theirs(const std::string &json) {
+  double result = std::strtod(json.c_str(), nullptr);
+  uint64_t bits;
+  std::memcpy(&bits, &result, sizeof(bits));
+  return bits;
+}
+
+/// Returns the inputs that we convert differently to strtod
+std::vector<std::string> mismatches(const std::vector<std::string> &inputs) {
+  std::vector<std::string> result;
+  for (const std::string &json : inputs)
+    if (ours(json) != theirs(json))
+      result.push_back(json);
+  return result;
+}
+
+std::string format(const char *pattern, double value) {
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), pattern, value);
+  return buffer;
+}
+
+go_bandit([]() {
+
+  describe("Decimal to double conversion", [&]() {
+
+    std::mt19937_64 random(20161016);
+
+    it("1.0 Takes the fast path exactly", [&]() {
+      double result;
+      AssertThat(clingerFastPath(12345, -2, false, result), Equals(true));
+      AssertThat(result, Equals(123.45));
+      AssertThat(clingerFastPath(1, 30, true, result), Equals(true));
+      AssertThat(result, Equals(-1e30));
+      AssertThat(clingerFastPath(1, -300, false, result), Equals(false));
+    });
+
+    it("1.1 Doesn't compound rounding errors in big exponents", [&]() {
+      AssertThat(json_num2cpp_num<double>(false, 1ull, -300), Equals(1e-300));
+      AssertThat(json_num2cpp_num<double>(true, 17976931348623157ull, 292),
+                 Equals(-1.7976931348623157e308));
+      AssertThat(decimalToDouble(false, 5, -324), Equals(4.9406564584124654e-324));
+    });
+
+    it("1.2 Agrees with strtod on random significands and exponents", [&]() {
+      std::vector<std::string> inputs;
+      for (int i = 0; i < 100000; ++i) {
+        uint64_t w = random() % 10000000000000000000ull;
+        int digits = random() % 20;
+        for (int d = 0; d < digits; ++d)
+          w /= 10;
+        int q = static_cast<int>(random() % 700) - 360;
+        inputs.push_back(std::to_string(w) + "e" + std::to_string(q));
+      }
+      AssertThat(mismatches(inputs), HasLength(0));
+    });
+
+    it("1.3 Agrees with strtod on random doubles", [&]() {
+      std::vector<std::string> inputs;
+      for (int i = 0; i < 20000; ++i) {
+        uint64_t bits = random() & 0x7FEFFFFFFFFFFFFFull;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        for (const char *pattern : {"%.17g", "%.16g", "%.15g", "%.6g", "%.25e"})
+          inputs.push_back(format(pattern, value));
+      }
+      AssertThat(mismatches(inputs), HasLength(0));
+    });
+
+    it("1.4 Agrees with strtod on hard cases", [&]() {
+      std::vector<std::string> inputs = {
+          "0", "-0", "0.0", "1", "0.1", "0.3", "1e23", "8.98846567431158e307",
+          "9007199254740993", "9007199254740992.5", "9007199254740993.0000001",
+          "2.2250738585072011e-308", "2.2250738585072012e-308",
+          "2.2250738585072014e-308", "4.9406564584124654e-324",
+          "2.4703282292062327e-324", "2.4703282292062328e-324",
+          "1.7976931348623157e308", "1.7976931348623158e308",
+          "1.7976931348623159e308", "1e308", "1e309", "1e400", "1e-400",
+          "1e-350", "123456789012345678901234567890",
+          "0.000000000000000000000000000000000000001",
+          "7.2057594037927933e16", "3.4028234664e38",
+          "1.00000000000000011102230246251565404236316680908203125",
+          "1.00000000000000011102230246251565404236316680908203124",
+          "1.00000000000000011102230246251565404236316680908203126",
+          "2.470328229206232720882538e-324",
+          "179769313486231580793728971405303415079934132710037826936173778980444"
+          "968292764750946649017977587207096330286416692887910946555547851940402"
+          "630657488671505820681908902000708383676273854845817711531764475730270"
+          "069855571366959622842914819860834936475292719074168444365510704342711"
+          "559699508093042880177904174497791"};
+      AssertThat(mismatches(inputs), HasLength(0));
+    });
+
+    it("1.5 Rounds numbers halfway between two doubles to even", [&]() {
+      // long double has room for the exact midpoint of two doubles on x86
+      if (std::numeric_limits<long double>::digits < 64)
+        return;
+      std::vector<std::string> inputs;
+      char buffer[1024];
+      for (int i = 0; i < 2000; ++i) {
+        uint64_t bits = random() & 0x7FEFFFFFFFFFFFFFull;
+        double low;
+        std::memcpy(&low, &bits, sizeof(low));
+        double high = std::nextafter(low, DBL_MAX);
+        long double middle = ((long double)low + high) / 2;
+        std::snprintf(buffer, sizeof(buffer), "%.800Le", middle);
+        std::string exact(buffer);
+        size_t e = exact.find('e');
+        std::string digits = exact.substr(0, e), exponent = exact.substr(e);
+        while (digits.back() == '0')
+          digits.pop_back();
+        inputs.push_back(digits + exponent);
+        // Just above and just below the midpoint
+        inputs.push_back(digits + "0000000001" + exponent);
+        std::string below = digits;
+        below.back() -= 1;
+        inputs.push_back(below + "9999999999" + exponent);
+      }
+      AssertThat(mismatches(inputs), HasLength(0));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
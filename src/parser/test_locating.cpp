@@ -0,0 +1,98 @@
+/// Tests that parser errors say where they happened
+#include <bandit/bandit.h>
+
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <string>
+
+#include "LocatingIterator.hpp"
+#include "sax.hpp"
+#include "simd.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Parses [begin, end) and returns the row and col of the error it hits
+template <typename Iterator>
+std::pair<int, int> errorAt(Iterator begin, Iterator end) {
+  SAXHandler handler;
+  auto status = make_status(makeLocating(begin), makeLocating(end));
+  try {
+    readSAX(status, handler);
+  } catch (const LocatingParserError &e) {
+    return {e.row, e.col};
+  }
+  return {0, 0};
+}
+
+go_bandit([]() {
+
+  describe("LocatingIterator", [&]() {
+
+    // The 'x' is on row 4 col 10
+    const std::string json = "{\n  \"a\": [1, 2],\n  \"b\": {\n    \"c\": x\n}}";
+
+    it("1.0 Finds errors in contiguous input", [&]() {
+      auto where = errorAt(json.cbegin(), json.cend());
+      AssertThat(where.first, Equals(4));
+      AssertThat(where.second, Equals(10));
+    });
+
+    it("1.1 Finds errors in other forward iterators", [&]() {
+      std::list<char> input(json.begin(), json.end());
+      auto where = errorAt(input.cbegin(), input.cend());
+      AssertThat(where.first, Equals(4));
+      AssertThat(where.second, Equals(10));
+    });
+
+    it("1.2 Counts as it goes over input iterators", [&]() {
+      std::istringstream input(json);
+      auto p = makeLocating(std::istreambuf_iterator<char>(input));
+      for (int i = 0; i < 35; ++i)
+        ++p;
+      AssertThat(*p, Equals('x'));
+      AssertThat(p.location().row, Equals(4u));
+      AssertThat(p.location().col, Equals(10u));
+    });
+
+    it("1.3 Keeps contiguous input on the vectorized paths", [&]() {
+      auto p = makeLocating(json.cbegin());
+      AssertThat(decltype(is_contiguous_iterator(p))::value, Equals(true));
+      auto q = p + 5;
+      q -= 2;
+      AssertThat(q - p, Equals(3));
+      AssertThat(q.location().row, Equals(2u));
+      AssertThat(q.location().col, Equals(2u));
+    });
+
+  });
+
+  describe("simd::locate", [&]() {
+
+    it("2.0 Counts newlines across many blocks", [&]() {
+      std::string text;
+      for (int i = 0; i < 500; ++i)
+        text += std::string(i % 97, ' ') + '\n';
+      text += "abc";
+      for (size_t at = 0; at <= text.size(); at += 7) {
+        simd::TextLocation expected{1, 1};
+        for (size_t i = 0; i < at; ++i) {
+          if (text[i] == '\n') {
+            ++expected.row;
+            expected.col = 1;
+          } else
+            ++expected.col;
+        }
+        auto got = simd::locate(text.data(), text.data() + at);
+        AssertThat(got.row, Equals(expected.row));
+        AssertThat(got.col, Equals(expected.col));
+      }
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
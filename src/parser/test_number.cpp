@@ -1,6 +1,8 @@
 /// Tests parsing of json numbers
 
 #include <bandit/bandit.h>
+#include <cmath>
+#include <limits>
 #include <sstream>
 
 #include "number.hpp"
@@ -71,6 +73,57 @@ go_bandit([]() {
       AssertThat(result, EqualsWithDelta(9.999, 0.001));
     });
 
+    it("1.8 Keeps 64 bit integers exact", [&]() {
+      const std::string json = "9007199254740993 -9223372036854775808 "
+                               "18446744073709551615 12345678901234567890";
+      auto status = make_status(json.cbegin(), json.cend());
+      NumberValue a = readNumberValue(status);
+      ++status.p;
+      NumberValue b = readNumberValue(status);
+      ++status.p;
+      NumberValue c = readNumberValue(status);
+      ++status.p;
+      NumberValue d = readNumberValue(status);
+      AssertThat(a.kind, Equals(NumberValue::signedInt));
+      AssertThat(a.asInt, Equals(9007199254740993));
+      AssertThat(b.kind, Equals(NumberValue::signedInt));
+      AssertThat(b.asInt, Equals(std::numeric_limits<int64_t>::min()));
+      AssertThat(c.kind, Equals(NumberValue::unsignedInt));
+      AssertThat(c.asUInt, Equals(std::numeric_limits<uint64_t>::max()));
+      AssertThat(d.kind, Equals(NumberValue::unsignedInt));
+      AssertThat(d.asUInt, Equals(12345678901234567890u));
+      AssertThat(status.p, Equals(json.cend()));
+    });
+
+    it("1.9 Falls back to a double when an integer doesn't fit", [&]() {
+      const std::string json = "18446744073709551616 -9223372036854775809 -0";
+      auto status = make_status(json.cbegin(), json.cend());
+      NumberValue a = readNumberValue(status);
+      ++status.p;
+      NumberValue b = readNumberValue(status);
+      ++status.p;
+      NumberValue c = readNumberValue(status);
+      AssertThat(a.kind, Equals(NumberValue::floating));
+      AssertThat(a.asDouble, Equals(18446744073709551616.0));
+      AssertThat(b.kind, Equals(NumberValue::floating));
+      AssertThat(b.asDouble, Equals(-9223372036854775809.0));
+      AssertThat(c.kind, Equals(NumberValue::floating));
+      AssertThat(std::signbit(c.asDouble), Equals(true));
+    });
+
+    it("1.10 Reads decimals exactly", [&]() {
+      const std::string json = "0.1";
+      auto status = make_status(json.cbegin(), json.cend());
+      AssertThat(readNumber<double>(status), Equals(0.1));
+    });
+
+    it("1.11 Still rejects bad numbers", [&]() {
+      for (std::string json : {"12-3", "1.2.3", "1e2e3", "-", "1e", "+1"}) {
+        auto status = make_status(json.cbegin(), json.cend());
+        AssertThrows(std::runtime_error, readNumber<double>(status));
+      }
+    });
+
   });
 
 });
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "outer.hpp"
+#include "utils.hpp"
 
 using namespace bandit;
 using namespace snowhouse;
@@ -177,6 +178,40 @@ go_bandit([]() {
       AssertThat(*status.p, Equals('h'));
     });
   });
+
+  describe("require", [&]() {
+
+    using Status = json::Status<std::string::const_iterator>;
+
+    // Checked at compile time
+    static_assert(valueTokens().contains(object), "");
+    static_assert(!valueTokens().contains(ARRAY_END), "");
+    static_assert((valueTokens() | ARRAY_END).contains(ARRAY_END), "");
+
+    it("13: Returns an acceptable token", [&]() {
+      std::string json{" ] "};
+      Status status(json.cbegin(), json.cend());
+      AssertThat(require({COMMA, ARRAY_END}, status), Equals(ARRAY_END));
+      AssertThat(status.p, Equals(json.cbegin() + 2));
+    });
+
+    it("14: Lists the tokens it wanted in char order", [&]() {
+      std::string json{"]"};
+      Status status(json.cbegin(), json.cend());
+      AssertThrows(ParserError, require(valueTokens(), status));
+      AssertThat(LastException<ParserError>().what(),
+                 Equals(std::string("Expected '\"', '0', '[', 'n', 't', '{'' "
+                                    "but got ']' instead")));
+    });
+
+    it("15: Says when it hit the end", [&]() {
+      std::string json{"  "};
+      Status status(json.cbegin(), json.cend());
+      AssertThrows(ParserError, require(COLON, status));
+      AssertThat(LastException<ParserError>().what(),
+                 Equals(std::string("Expected ':'' but hit the end of input")));
+    });
+  });
 });
 
 int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -0,0 +1,190 @@
+/// Tests reading json that arrives in chunks
+
+#include <bandit/bandit.h>
+
+#include "push.hpp"
+#include "sax.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Writes every event it gets into 'log'
+struct Recorder : SAXHandler {
+  std::string log;
+  std::vector<const char *> starts;
+  void onNull() { log += "null "; }
+  void onBoolean(bool value) { log += value ? "true " : "false "; }
+  void onNumber(const NumberValue &value) {
+    switch (value.kind) {
+    case NumberValue::signedInt: log += "int:" + std::to_string(value.asInt); break;
+    case NumberValue::unsignedInt: log += "uint:" + std::to_string(value.asUInt); break;
+    case NumberValue::floating: log += "double:" + std::to_string(value.asDouble); break;
+    }
+    log += ' ';
+  }
+  void onString(const SAXString &value) {
+    starts.push_back(value.begin());
+    log += "'" + std::string(value) + "' ";
+  }
+  void onKey(const SAXString &key) { log += std::string(key) + ": "; }
+  void onStartObject() { log += "{ "; }
+  void onEndObject() { log += "} "; }
+  void onStartArray() { log += "[ "; }
+  void onEndArray() { log += "] "; }
+  void onEndDocument() { log += "| "; }
+};
+
+/// The events readSAX sends for 'json', plus the end of the document
+std::string wholeLog(const std::string &json) {
+  Recorder recorder;
+  readSAX(json.data(), json.data() + json.size(), recorder);
+  return recorder.log + "| ";
+}
+
+/// The events a PushParser sends for 'json', fed in 'chunk' byte pieces,
+/// starting with a 'first' byte piece
+std::string pushedLog(const std::string &json, size_t first, size_t chunk) {
+  Recorder recorder;
+  PushParser<Recorder> parser(recorder);
+  for (size_t p = 0; p < json.size();) {
+    size_t size = std::min(p ? chunk : first, json.size() - p);
+    // Copy it so nothing can point into 'json' past the chunk
+    std::string piece = json.substr(p, size);
+    parser.feed(piece);
+    p += size;
+  }
+  parser.finish();
+  return recorder.log;
+}
+
+go_bandit([]() {
+
+  describe("PushParser", [&]() {
+
+    const std::string json =
+        R"({"a": [1, -2.5e3, 18446744073709551615, true, false, null],)"
+        R"( "long key": "plain text", "esc": "q\"\\\/\né😀\u00e9\ud83d\ude00",)"
+        R"( "e": {}, "l": [[], {"x": -0}], "trailing": [1,],})";
+
+    it("1.0 Sends the same events as readSAX, however the input is cut", [&]() {
+      const std::string expected = wholeLog(json);
+      AssertThat(pushedLog(json, json.size(), 1), Equals(expected));
+      for (size_t first = 1; first < json.size(); ++first)
+        AssertThat(pushedLog(json, first, json.size()), Equals(expected));
+      for (size_t chunk = 1; chunk < 8; ++chunk)
+        AssertThat(pushedLog(json, chunk, chunk), Equals(expected));
+    });
+
+    it("1.1 Sends events as soon as values are complete", [&]() {
+      Recorder recorder;
+      PushParser<Recorder> parser(recorder);
+      parser.feed(std::string(R"([1, "tw)"));
+      AssertThat(recorder.log, Equals("[ int:1 "));
+      parser.feed(std::string(R"(o", tr)"));
+      AssertThat(recorder.log, Equals("[ int:1 'two' "));
+      parser.feed(std::string("ue]"));
+      AssertThat(recorder.log, Equals("[ int:1 'two' true ] | "));
+      AssertThat(parser.atDocumentEnd(), Equals(true));
+      AssertThat(parser.position(), Equals(16u));
+    });
+
+    it("1.2 Reads one top level value after another", [&]() {
+      Recorder recorder;
+      PushParser<Recorder> parser(recorder);
+      parser.feed(std::string("{\"a\": 1}\n[2]\n\"s\" 3"));
+      AssertThat(recorder.log, Equals("{ a: int:1 } | [ int:2 ] | 's' | "));
+      // We can't tell that the 3 has finished until we're told
+      parser.finish();
+      AssertThat(recorder.log,
+                 Equals("{ a: int:1 } | [ int:2 ] | 's' | int:3 | "));
+    });
+
+    it("1.3 Borrows strings that are all in one chunk", [&]() {
+      Recorder recorder;
+      PushParser<Recorder> parser(recorder);
+      std::string first = R"(["in chunk", "spl)";
+      std::string second = R"(it"])";
+      parser.feed(first);
+      parser.feed(second);
+      AssertThat(recorder.starts.size(), Equals(2u));
+      AssertThat(recorder.starts[0], Equals(first.data() + 2));
+      AssertThat(recorder.starts[1] < second.data() ||
+                     recorder.starts[1] >= second.data() + second.size(),
+                 Equals(true));
+    });
+
+    it("1.4 Complains about bad json like require() does", [&]() {
+      for (std::string bad : {"[1 2]", R"({"a" 1})", "[nul]", "[truex]",
+                              "{,}", "[1,,]"}) {
+        Recorder whole;
+        std::string wanted;
+        try {
+          readSAX(bad.data(), bad.data() + bad.size(), whole);
+        } catch (const ParserError &e) {
+          wanted = e.what();
+        }
+        Recorder recorder;
+        PushParser<Recorder> parser(recorder);
+        AssertThrows(ParserError, parser.feed(bad); parser.finish());
+        AssertThat(std::string(LastException<ParserError>().what()),
+                   Equals(wanted));
+      }
+    });
+
+    it("1.5 Complains about input that stops part way", [&]() {
+      for (std::string cut : {"[1, 2", "{\"a\":", "\"abc", "[tr"}) {
+        Recorder recorder;
+        PushParser<Recorder> parser(recorder);
+        parser.feed(cut);
+        AssertThrows(ParserError, parser.finish());
+      }
+    });
+
+    it("1.6 Stops if the error handler doesn't throw", [&]() {
+      Recorder recorder;
+      std::vector<std::string> errors;
+      PushParser<Recorder> parser(
+          recorder, [&](std::string msg, const char *) { errors.push_back(msg); });
+      parser.feed(std::string("[1 2] [3]"));
+      parser.feed(std::string("[4]"));
+      parser.finish();
+      AssertThat(errors.size(), Equals(1u));
+      AssertThat(recorder.log, Equals("[ int:1 "));
+    });
+
+    it("1.7 Says how far into the input errors are", [&]() {
+      // The errors are at the '}' after 'nul' and at the 'x'. With small
+      // chunks, they're found in our copy of the token.
+      for (std::string json : {R"({"a": [1, 2], "b": nul})",
+                               R"({"a": [1, 2], "b": [3, 1x]})"}) {
+        const size_t expected = json.find_first_of("}x", 14);
+        for (size_t chunk = 1; chunk <= json.size(); ++chunk) {
+          Recorder recorder;
+          size_t offset = 0;
+          PushParser<Recorder> *self = nullptr;
+          PushParser<Recorder> parser(
+              recorder, [&](std::string, const char *at) {
+                offset = self->offsetOf(at);
+                throw std::runtime_error("stop");
+              });
+          self = &parser;
+          try {
+            for (size_t p = 0; p < json.size(); p += chunk)
+              parser.feed(json.substr(p, chunk));
+            parser.finish();
+          } catch (const std::runtime_error &) {
+          }
+          AssertThat(offset, Equals(expected));
+        }
+      }
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
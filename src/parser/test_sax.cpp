@@ -0,0 +1,153 @@
+/// Tests reading json as a stream of events
+
+#include <bandit/bandit.h>
+
+#include "sax.hpp"
+#include "LocatingIterator.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Writes every event it gets into 'log'
+struct Recorder : SAXHandler {
+  std::string log;
+  void onNull() { log += "null "; }
+  void onBoolean(bool value) { log += value ? "true " : "false "; }
+  void onNumber(const NumberValue &value) {
+    switch (value.kind) {
+    case NumberValue::signedInt: log += "int:" + std::to_string(value.asInt); break;
+    case NumberValue::unsignedInt: log += "uint:" + std::to_string(value.asUInt); break;
+    case NumberValue::floating: log += "double:" + std::to_string(value.asDouble); break;
+    }
+    log += ' ';
+  }
+  void onString(const SAXString &value) { log += "'" + std::string(value) + "' "; }
+  void onKey(const SAXString &key) { log += std::string(key) + ": "; }
+  void onStartObject() { log += "{ "; }
+  void onEndObject() { log += "} "; }
+  void onStartArray() { log += "[ "; }
+  void onEndArray() { log += "] "; }
+};
+
+/// Only cares about strings; remembers where they point
+struct StringGrabber : SAXHandler {
+  std::vector<const char *> starts;
+  std::vector<std::string> copies;
+  void onString(const SAXString &value) {
+    starts.push_back(value.begin());
+    copies.push_back(value);
+  }
+};
+
+go_bandit([]() {
+
+  describe("readSAX", [&]() {
+
+    it("1.0 Sends an event for every value", [&]() {
+      std::string json =
+          R"({"a": [1, -2, 2.5, 18446744073709551615], "b": {"c": null},)"
+          R"( "d": [true, false, "text", [], {}]})";
+      Recorder recorder;
+      const char *end = readSAX(json.data(), json.data() + json.size(), recorder);
+      AssertThat(end, Equals(json.data() + json.size()));
+      AssertThat(recorder.log,
+                 Equals("{ a: [ int:1 int:-2 double:2.500000 "
+                        "uint:18446744073709551615 ] b: { c: null } "
+                        "d: [ true false 'text' [ ] { } ] } "));
+    });
+
+    it("1.1 Borrows unescaped strings from the input", [&]() {
+      std::string json = R"(["plain", "esc\"aped", "é"])";
+      StringGrabber grabber;
+      readSAX(json.data(), json.data() + json.size(), grabber);
+      AssertThat(grabber.copies, Equals(std::vector<std::string>{
+                                     "plain", "esc\"aped", u8"é"}));
+      AssertThat(grabber.starts[0], Equals(json.data() + 2));
+      // Escaped strings are decoded somewhere else
+      AssertThat(grabber.starts[1] < json.data() ||
+                     grabber.starts[1] >= json.data() + json.size(),
+                 Equals(true));
+    });
+
+    it("1.2 Reads from forward iterators", [&]() {
+      std::string text = R"({"list": ["x\ty", 3]})";
+      std::list<char> json(text.begin(), text.end());
+      Recorder recorder;
+      auto status = make_status(json.begin(), json.end());
+      readSAX(status, recorder);
+      AssertThat(status.p == json.end(), Equals(true));
+      AssertThat(recorder.log, Equals("{ list: [ 'x\ty' int:3 ] } "));
+    });
+
+    it("1.3 Reports errors through the status", [&]() {
+      std::string json = R"({"a": [1, 2}})";
+      Recorder recorder;
+      AssertThrows(ParserError,
+                   readSAX(json.data(), json.data() + json.size(), recorder));
+      AssertThat(recorder.log, Equals("{ a: [ int:1 int:2 "));
+    });
+
+    it("1.4 Works with a LocatingIterator", [&]() {
+      std::string json = "[\n  null,\n  \"two\"\n]";
+      Recorder recorder;
+      auto status =
+          make_status(makeLocating(json.begin()), makeLocating(json.end()));
+      readSAX(status, recorder);
+      AssertThat(recorder.log, Equals("[ null 'two' ] "));
+    });
+
+    it("1.5 Returns errors instead of throwing them from tryReadSAX", [&]() {
+      std::string json = R"({"a": [1, 2}})";
+      Recorder recorder;
+      auto result = tryReadSAX(json.data(), json.data() + json.size(), recorder);
+      AssertThat(result.ok(), Equals(false));
+      AssertThat(result.error == ErrorCode::unexpectedToken, Equals(true));
+      AssertThat(result.offset, Equals(12u));
+      AssertThat(recorder.log, Equals("{ a: [ int:1 int:2 "));
+      Recorder good;
+      json = R"({"a": [1, 2]})";
+      AssertThat(bool(tryReadSAX(json.cbegin(), json.cend(), good)),
+                 Equals(true));
+      AssertThat(good.log, Equals("{ a: [ int:1 int:2 ] } "));
+    });
+
+    it("1.6 Stops cleanly on any kind of bad json", [&]() {
+      const std::string json =
+          R"({"a": [1, -2.5e3, true, false, null, "x\u00e9\n"], "b": {}})";
+      auto check = [](const std::string &text, ErrorCode expected) {
+        // Exactly the size of the input, so reading past it would show up
+        std::vector<char> input(text.begin(), text.end());
+        Recorder recorder;
+        auto result =
+            tryReadSAX(input.data(), input.data() + input.size(), recorder);
+        AssertThat(result.offset <= input.size(), Equals(true));
+        if (expected != ErrorCode::none)
+          AssertThat(result.error == expected, Equals(true));
+        return result;
+      };
+      check(json, ErrorCode::none);
+      for (size_t size = 0; size < json.size(); ++size)
+        AssertThat(check(json.substr(0, size), ErrorCode::none).ok(),
+                   Equals(false));
+      for (size_t i = 0; i < json.size(); ++i)
+        for (char c : {'x', '"', '\\', '}', ']', '-', '.', 'e', '\x01'}) {
+          std::string bad = json;
+          bad[i] = c;
+          check(bad, ErrorCode::none);
+        }
+      check(R"(["\u12"])", ErrorCode::badString);
+      check("[tru]", ErrorCode::badLiteral);
+      check("[1.2.3]", ErrorCode::badNumber);
+      check("[1, 2", ErrorCode::unexpectedEnd);
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -0,0 +1,160 @@
+/// Tests the vectorized scanners
+
+#include <bandit/bandit.h>
+#include <random>
+#include <string>
+
+#include "simd.hpp"
+#include "outer.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+go_bandit([]() {
+
+  describe("The block classifiers", [&]() {
+
+    it("1.0 Agree with the scalar classifier on random input", [&]() {
+      const std::string alphabet = " \t\n\r,:[]{}\"\\abz09-+.eE\x7f\x80\xff";
+      std::mt19937 random(42);
+      std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+      // Try every instruction set that this CPU supports
+      for (int set = simd::scalar; set <= simd::instructionSet(); ++set) {
+        auto classifier =
+            simd::classifierFor(static_cast<simd::InstructionSet>(set));
+        for (int n = 0; n < 1000; ++n) {
+          char block[simd::blockSize];
+          for (char &c : block)
+            c = alphabet[pick(random)];
+          simd::BlockMasks expected = simd::classifyScalar(block);
+          simd::BlockMasks got = classifier(block);
+          AssertThat(got.whitespace, Equals(expected.whitespace));
+          AssertThat(got.structural, Equals(expected.structural));
+          AssertThat(got.quote, Equals(expected.quote));
+        }
+      }
+    });
+
+    it("1.1 Set the right bits", [&]() {
+      std::string block(simd::blockSize, 'a');
+      block[0] = ' ';
+      block[5] = '{';
+      block[63] = '"';
+      simd::BlockMasks masks = simd::classify(block.data());
+      AssertThat(masks.whitespace, Equals(uint64_t(1)));
+      AssertThat(masks.structural, Equals(uint64_t(1) << 5));
+      AssertThat(masks.quote, Equals(uint64_t(1) << 63));
+    });
+
+    it("1.2 Agree on the masks for validate()", [&]() {
+      const std::string alphabet =
+          " \t\n\r,:[]{}\"\\abz09-+.eE\x01\x1f\x7f\x80\xc3\xff";
+      std::mt19937 random(42);
+      std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+      for (int set = simd::scalar; set <= simd::instructionSet(); ++set) {
+        auto classifier = simd::validationClassifierFor(
+            static_cast<simd::InstructionSet>(set));
+        for (int n = 0; n < 1000; ++n) {
+          char block[simd::blockSize];
+          for (char &c : block)
+            c = alphabet[pick(random)];
+          simd::ValidationMasks expected =
+              simd::classifyForValidationScalar(block);
+          simd::ValidationMasks got = classifier(block);
+          AssertThat(got.whitespace, Equals(expected.whitespace));
+          AssertThat(got.structural, Equals(expected.structural));
+          AssertThat(got.quote, Equals(expected.quote));
+          AssertThat(got.backslash, Equals(expected.backslash));
+          AssertThat(got.control, Equals(expected.control));
+          AssertThat(got.nonASCII, Equals(expected.nonASCII));
+        }
+      }
+    });
+
+  });
+
+  describe("The string scanners", [&]() {
+
+    it("3.0 Agree with the scalar scanner on random input", [&]() {
+      const std::string alphabet = "abcdefgh \"\\\x01\x1f\x7f\x80\xff";
+      std::mt19937 random(7);
+      std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+      std::uniform_int_distribution<size_t> length(0, 100);
+      for (int set = simd::scalar; set <= simd::instructionSet(); ++set) {
+        auto scanner =
+            simd::stringScannerFor(static_cast<simd::InstructionSet>(set));
+        for (int n = 0; n < 1000; ++n) {
+          // Mostly plain chars, so that the special ones land all over
+          std::string input(length(random), 'x');
+          for (char &c : input)
+            if (pick(random) < 3)
+              c = alphabet[pick(random)];
+          const char *p = input.data();
+          const char *pe = p + input.size();
+          AssertThat(scanner(p, pe), Equals(simd::findStringSpecialScalar(p, pe)));
+        }
+      }
+    });
+
+    it("3.1 Stop on non ASCII chars too when asked", [&]() {
+      const std::string alphabet = "\"\\\x01\x1f\x7f\x80\xc3\xff";
+      std::mt19937 random(11);
+      std::uniform_int_distribution<size_t> pick(0, 40);
+      std::uniform_int_distribution<size_t> length(0, 100);
+      for (int set = simd::scalar; set <= simd::instructionSet(); ++set) {
+        auto scanner =
+            simd::nonASCIIScannerFor(static_cast<simd::InstructionSet>(set));
+        for (int n = 0; n < 1000; ++n) {
+          std::string input(length(random), 'x');
+          for (char &c : input) {
+            size_t i = pick(random);
+            if (i < alphabet.size())
+              c = alphabet[i];
+          }
+          const char *p = input.data();
+          const char *pe = p + input.size();
+          AssertThat(scanner(p, pe),
+                     Equals(simd::findNonASCIISpecialScalar(p, pe)));
+        }
+      }
+      const std::string text = "plain \x7f then \xc3\xa9";
+      AssertThat(simd::findNonASCIISpecial(text.data(), text.data() + text.size()) -
+                     text.data(),
+                 Equals(13));
+    });
+
+  });
+
+  describe("skipWhitespace", [&]() {
+
+    it("2.0 Stops on the first significant char", [&]() {
+      for (size_t spaces = 0; spaces < 200; ++spaces) {
+        std::string json = std::string(spaces, ' ') + "\n\t{";
+        const char *p = json.data();
+        const char *pe = p + json.size();
+        AssertThat(simd::skipWhitespace(p, pe), Equals(pe - 1));
+      }
+    });
+
+    it("2.1 Stops at the end of all whitespace input", [&]() {
+      for (size_t spaces = 0; spaces < 200; ++spaces) {
+        std::string json(spaces, '\r');
+        const char *p = json.data();
+        const char *pe = p + json.size();
+        AssertThat(simd::skipWhitespace(p, pe), Equals(pe));
+      }
+    });
+
+    it("2.2 Is used by getNextOuterToken for char* input", [&]() {
+      std::string json = std::string(150, ' ') + "\n  [1]";
+      auto status = make_status(&json[0], &json[0] + json.size());
+      AssertThat(getNextOuterToken(status), Equals(array));
+      AssertThat(*status.p, Equals('1'));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -0,0 +1,159 @@
+/// Tests skipping values without decoding them
+
+#include <bandit/bandit.h>
+
+#include "skip.hpp"
+#include "simd.hpp"
+
+#include <list>
+#include <random>
+#include <string>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Makes up some json, with plenty of brackets and escapes inside strings
+std::string randomJSON(std::mt19937 &random, int depth) {
+  switch (depth > 0 ? random() % 6 : random() % 3) {
+  case 0:
+    return std::to_string(static_cast<int>(random() % 2000000) - 1000000);
+  case 1: {
+    static const char *pieces[] = {"a", "]", "}", "[", "{", "\\\"", "\\\\",
+                                   "\\n", "\\u00e9", ",", " ", "xyz"};
+    std::string result = "\"";
+    for (int i = random() % 40; i; --i)
+      result += pieces[random() % 12];
+    return result + '"';
+  }
+  case 2:
+    return random() % 2 ? "true" : "null";
+  case 3:
+  case 4: {
+    std::string result = "[";
+    for (int i = random() % 8; i; --i) {
+      result += randomJSON(random, depth - 1);
+      if (i > 1)
+        result += ", ";
+    }
+    return result + ']';
+  }
+  default: {
+    std::string result = "{";
+    for (int i = random() % 8; i; --i) {
+      result += randomJSON(random, 0).front() == '"' ? "\"k\\\"}\": " : "\"k\": ";
+      result += randomJSON(random, depth - 1);
+      if (i > 1)
+        result += ",\n";
+    }
+    return result + '}';
+  }
+  }
+}
+
+/// Where skipValue stops in 'json', for contiguous input and for a list
+std::pair<size_t, size_t> skipBothWays(const std::string &json) {
+  auto status = make_status(json.data(), json.data() + json.size());
+  skipValue(status);
+  std::list<char> chars(json.begin(), json.end());
+  auto listStatus = make_status(chars.begin(), chars.end());
+  skipValue(listStatus);
+  return {status.p - json.data(),
+          static_cast<size_t>(std::distance(chars.begin(), listStatus.p))};
+}
+
+go_bandit([]() {
+
+  describe("skipValue", [&]() {
+
+    it("1.0 Skips each kind of value", [&]() {
+      for (std::string json :
+           {"null", "true", "false", "-12.5e3", "\"te\\\"xt\"", "[1, [2]]",
+            "{\"a\": {\"b\": []}}", "  []"}) {
+        auto sizes = skipBothWays(json + ", 0");
+        AssertThat(sizes.first, Equals(json.size()));
+        AssertThat(sizes.second, Equals(json.size()));
+      }
+    });
+
+    it("1.1 Agrees with the char at a time skipper on random json", [&]() {
+      std::mt19937 random(2016);
+      for (int n = 0; n < 2000; ++n) {
+        // Shift it around so the blocks break in different places
+        std::string json =
+            std::string(random() % 64, ' ') + randomJSON(random, 5);
+        auto sizes = skipBothWays(json + ",\"after\"");
+        AssertThat(sizes.first, Equals(json.size()));
+        AssertThat(sizes.second, Equals(json.size()));
+      }
+    });
+
+    it("1.2 Copes with runs of backslashes across block boundaries", [&]() {
+      for (size_t pad = 0; pad < 130; ++pad)
+        for (size_t slashes = 0; slashes < 6; slashes += 2) {
+          std::string json = "[\"" + std::string(pad, 'x') +
+                             std::string(slashes, '\\') + "\\\"]\", 1]";
+          auto sizes = skipBothWays(json + "]");
+          AssertThat(sizes.first, Equals(json.size()));
+          AssertThat(sizes.second, Equals(json.size()));
+        }
+    });
+
+    it("1.3 Complains if the input ends first", [&]() {
+      for (std::string json : {"[1, 2", "{\"a\": \"]}", "\"abc", "[[]"}) {
+        auto status = make_status(json.data(), json.data() + json.size());
+        AssertThrows(ParserError, skipValue(status));
+        std::list<char> chars(json.begin(), json.end());
+        auto listStatus = make_status(chars.begin(), chars.end());
+        AssertThrows(ParserError, skipValue(listStatus));
+      }
+    });
+
+  });
+
+  describe("The bracket classifiers", [&]() {
+
+    it("2.0 Agree with the scalar classifier on random input", [&]() {
+      const std::string alphabet = "[]{}\"\\ax:,\x80\xff";
+      std::mt19937 random(9);
+      for (int set = simd::scalar; set <= simd::instructionSet(); ++set) {
+        auto classifier =
+            simd::bracketClassifierFor(static_cast<simd::InstructionSet>(set));
+        for (int n = 0; n < 1000; ++n) {
+          char block[simd::blockSize];
+          for (char &c : block)
+            c = alphabet[random() % alphabet.size()];
+          simd::BracketMasks expected = simd::classifyBracketsScalar(block);
+          simd::BracketMasks got = classifier(block);
+          AssertThat(got.open, Equals(expected.open));
+          AssertThat(got.close, Equals(expected.close));
+          AssertThat(got.quote, Equals(expected.quote));
+          AssertThat(got.backslash, Equals(expected.backslash));
+        }
+      }
+    });
+
+    it("2.1 Find escaped chars the same as a char at a time walk", [&]() {
+      std::mt19937_64 random(3);
+      bool carry = false, escaped = false;
+      for (int n = 0; n < 10000; ++n) {
+        // Mostly backslashes, so there are plenty of long runs
+        uint64_t backslash = random() | random() | random();
+        uint64_t expected = 0;
+        for (int i = 0; i < 64; ++i) {
+          if (escaped) {
+            expected |= uint64_t(1) << i;
+            escaped = false;
+          } else
+            escaped = (backslash >> i) & 1;
+        }
+        AssertThat(simd::escapedChars(backslash, carry), Equals(expected));
+        AssertThat(carry, Equals(escaped));
+      }
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <string>
 #include <iterator>
+#include <list>
 
 #include "status.hpp"
 #include "string.hpp"
@@ -93,11 +94,19 @@ go_bandit([]() {
     });
 
     it("1.7. Can detect a bad unicode char", [&]() {
-      std::string input = R"(\u03E01111111111111")";
+      std::string input = R"(\u03E")";
       auto status = make_status(input.begin(), input.end());
       AssertThrows(ParserError, json::decodeString(status));
     });
 
+    it("1.7.1. Reads hex after a unicode char as part of the string", [&]() {
+      std::string input = R"(\u03E01111111111111")";
+      std::string expected = u8"\u03E01111111111111";
+      auto status = make_status(input.begin(), input.end());
+      auto output = json::decodeString(status);
+      AssertThat(output, Equals(expected));
+    });
+
     it("1.8. Can parse a 32 bit unicode char", [&]() {
       std::string input = R"(\uD834\uDD1E")";
       std::string expected = u8"\U0001D11E";
@@ -106,6 +115,14 @@ go_bandit([]() {
       AssertThat(output, Equals(expected));
     });
 
+    it("1.8.1. Only joins \\u escapes that make a surrogate pair", [&]() {
+      std::string input = R"(\u00e9\u00e8\uD834x")";
+      std::string expected = u8"\u00e9\u00e8\xed\xa0\xb4x";
+      auto status = make_status(input.begin(), input.end());
+      auto output = json::decodeString(status);
+      AssertThat(output, Equals(expected));
+    });
+
     it("1.9. Can parse a char* input type", [&]() {
       std::string data = R"(\uD834\uDD1E")";
       char* input = new char[data.size()];
@@ -117,6 +134,45 @@ go_bandit([]() {
       delete[] input;
     });
 
+    it("1.10. Can parse escaped quotes and backslashes", [&]() {
+      std::string input = R"(say \"hi\" \\o/")";
+      std::string expected = R"(say "hi" \o/)";
+      auto status = make_status(input.begin(), input.end());
+      auto output = json::decodeString(status);
+      AssertThat(output, Equals(expected));
+      AssertThat(status.p, Equals(input.end()));
+    });
+
+    it("1.11. Rejects unescaped control characters", [&]() {
+      std::string input = "a long string with a tab in the middle\tof it\"";
+      auto status = make_status(input.begin(), input.end());
+      AssertThrows(ParserError, json::decodeString(status));
+      std::string input2 = "\n\"";
+      auto status2 = make_status(input2.begin(), input2.end());
+      AssertThrows(ParserError, json::decodeString(status2));
+    });
+
+    it("1.12. Can parse long strings from contiguous input", [&]() {
+      for (size_t length = 0; length < 100; ++length) {
+        std::string expected(length, 'z');
+        std::string input = expected + R"(\n)" + expected + '"';
+        expected += '\n' + expected;
+        auto status = make_status(input.cbegin(), input.cend());
+        auto output = json::decodeString(status);
+        AssertThat(output, Equals(expected));
+        AssertThat(status.p, Equals(input.cend()));
+      }
+    });
+
+    it("1.13. Can decode from forward iterators", [&]() {
+      std::list<char> input{'a', '\\', 'n', '\\', 'u', '0', '0', 'e', '9', '"'};
+      std::string expected = u8"a\n\u00e9";
+      auto status = make_status(input.cbegin(), input.cend());
+      auto output = json::decodeString(status);
+      AssertThat(output, Equals(expected));
+      AssertThat(status.p, Equals(input.cend()));
+    });
+
   });
 });
 
@@ -0,0 +1,152 @@
+/// Tests checking json without reading it
+
+#include <bandit/bandit.h>
+
+#include "validate.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Validates 'json' from an exactly sized buffer and from a std::list, and
+/// checks that they agree
+ParseResult<void> check(const std::string &json) {
+  // Exactly the size of the input, so reading past it would show up
+  std::vector<char> buffer(json.begin(), json.end());
+  auto contiguous = validate(buffer.data(), buffer.data() + buffer.size());
+  std::list<char> list(json.begin(), json.end());
+  auto forward = validate(list.begin(), list.end());
+  AssertThat(forward.error == contiguous.error, Equals(true));
+  AssertThat(forward.offset, Equals(contiguous.offset));
+  return contiguous;
+}
+
+/// Expects 'json' to be rejected with 'code' at 'offset'
+void reject(const std::string &json, ErrorCode code, size_t offset) {
+  auto result = check(json);
+  AssertThat(describe(result.error), Equals(describe(code)));
+  AssertThat(result.offset, Equals(offset));
+}
+
+go_bandit([]() {
+
+  describe("validate", [&]() {
+
+    it("1.0 Accepts valid json", [&]() {
+      std::ifstream file("sample.json");
+      std::string sample(std::istreambuf_iterator<char>(file.rdbuf()),
+                         std::istreambuf_iterator<char>());
+      AssertThat(check(sample).ok(), Equals(true));
+      for (std::string json :
+           {"0", "-0", "1.5", "-12.25e+10", "3E-2", "1e5", "true", "false",
+            "null", "\"\"", " \t\r\n[ ] ", "{}", "[[[]], {}]",
+            R"({"a": {"b": [1, "two", null]}, "c": false})",
+            R"(["\"\\\/\b\f\n\r\té😀"])",
+            u8"\"é 😀   日本\"", "\"\x7f\""})
+        AssertThat(check(json).ok(), Equals(true));
+    });
+
+    it("1.1 Says what's wrong and where", [&]() {
+      reject("", ErrorCode::unexpectedEnd, 0);
+      reject("  ", ErrorCode::unexpectedEnd, 2);
+      reject("[1, 2", ErrorCode::unexpectedEnd, 5);
+      reject("[1 2]", ErrorCode::unexpectedToken, 3);
+      reject("[1,]", ErrorCode::unexpectedToken, 3);
+      reject(R"({"a" 1})", ErrorCode::unexpectedToken, 5);
+      reject(R"({"a": 1,})", ErrorCode::unexpectedToken, 8);
+      reject("{1: 2}", ErrorCode::unexpectedToken, 1);
+      reject("[1] [2]", ErrorCode::unexpectedToken, 4);
+      reject("[1}", ErrorCode::unexpectedToken, 2);
+      reject("[nul]", ErrorCode::badLiteral, 4);
+      reject("tru", ErrorCode::unexpectedEnd, 3);
+      reject("01", ErrorCode::badNumber, 1);
+      reject("-", ErrorCode::unexpectedEnd, 1);
+      reject("[-a]", ErrorCode::badNumber, 2);
+      reject("1.", ErrorCode::unexpectedEnd, 2);
+      reject("[1.e5]", ErrorCode::badNumber, 3);
+      reject("[1e+]", ErrorCode::badNumber, 4);
+      reject("+1", ErrorCode::unexpectedToken, 0);
+      reject(R"(["\x"])", ErrorCode::badString, 3);
+      reject(R"(["\u12g4"])", ErrorCode::badString, 6);
+      reject("[\"a\tb\"]", ErrorCode::badString, 3);
+      reject(R"(["abc)", ErrorCode::unexpectedEnd, 5);
+      reject(R"(["abc\)", ErrorCode::unexpectedEnd, 6);
+    });
+
+    it("1.2 Only lets well formed UTF-8 into strings", [&]() {
+      const std::string padding(70, 'x'); // Past the first vector block
+      for (std::string good : {"\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80",
+                               "\xed\x9f\xbf", "\xef\xbf\xbf",
+                               "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf"})
+        AssertThat(check("\"" + padding + good + "\"").ok(), Equals(true));
+      for (std::string bad :
+           {"\x80", "\xbf", "\xc0\x80", "\xc1\xbf", "\xc2", "\xc2x",
+            "\xe0\x80\x80", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xef\xbf",
+            "\xf0\x80\x80\x80", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+            "\xff"}) {
+        reject("\"" + padding + bad + "\"", ErrorCode::badUTF8,
+               padding.size() + 1);
+      }
+      reject("[\xc3\xa9]", ErrorCode::unexpectedToken, 1);
+    });
+
+    it("1.3 Has a limit on nesting", [&]() {
+      const size_t limit = validateMaxDepth;
+      std::string deep = std::string(limit, '[') + std::string(limit, ']');
+      AssertThat(check(deep).ok(), Equals(true));
+      deep = std::string(limit + 1, '[') + std::string(limit + 1, ']');
+      reject(deep, ErrorCode::tooDeep, limit);
+      std::string objects;
+      for (size_t i = 0; i < 100; ++i)
+        objects += (i % 2) ? "[" : R"({"k":)";
+      for (size_t i = 100; i-- > 0;)
+        objects += (i % 2) ? "]" : "}";
+      AssertThat(check(objects).ok(), Equals(true));
+    });
+
+    it("1.4 Copes with any damage to a document", [&]() {
+      const std::string json =
+          R"({"a": [1, -2.5e3, true, false, null, "xé\n"],)"
+          u8" \"b\": {\"é\": [{}]}}";
+      AssertThat(check(json).ok(), Equals(true));
+      std::mt19937 random(3);
+      const std::string alphabet = "{}[]\",:\\u0-.eE tfn\x01\xc3\xa9";
+      for (int n = 0; n < 5000; ++n) {
+        std::string bad = json;
+        size_t i = random() % bad.size();
+        if (n % 3)
+          bad[i] = alphabet[random() % alphabet.size()];
+        else
+          bad.resize(i);
+        check(bad);
+      }
+    });
+
+    it("1.5 Doesn't care where the vector blocks fall", [&]() {
+      for (std::string json :
+           {R"(["a\\\"b", "\\\\"])", R"(["é", 12.5e-3, true])",
+            u8"{\"日本\": \"😀\"}", R"(["\u00g9"])", "[\"\\\x01\"]",
+            "[\"\xf0\x9f\x98\"]", R"({"a": 1 "b"})", "[1, 2] x", "[12, 3",
+            "\"abc\\", R"(["\"])", "[truex]"}) {
+        const auto expected = check(json);
+        for (size_t pad = 1; pad < 130; ++pad) {
+          auto result = check(std::string(pad, ' ') + json);
+          AssertThat(result.error == expected.error, Equals(true));
+          if (!result.ok())
+            AssertThat(result.offset, Equals(expected.offset + pad));
+        }
+      }
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -1,36 +1,96 @@
 /// General utilities for parsing code
 #pragma once
 
-#include <set>
-
 #include "status.hpp"
 #include "outer.hpp"
 
 #include <cassert>
+#include <cstdint>
+#include <string>
 
 namespace json {
 
+/// The tokens in the order that error messages list them (their char order)
+constexpr Token tokenOrder[] = {HIT_END, string, COMMA, number,
+                                COLON,   array,  ARRAY_END, null,
+                                boolean, ERROR,  object, OBJECT_END};
+
+/// A set of tokens, one bit each, so checking for a token is a single AND and
+/// making one doesn't allocate. Built at compile time when the tokens are
+/// constants: require({COMMA, ARRAY_END}, status)
+class TokenSet {
+public:
+  constexpr TokenSet() : bits(0) {}
+  template <typename... Tokens>
+  constexpr TokenSet(Token token, Tokens... tokens)
+      : bits(bit(token) | TokenSet(tokens...).bits) {}
+
+  constexpr bool contains(Token token) const {
+    return (bits & bit(token)) != 0;
+  }
+  constexpr TokenSet operator|(TokenSet other) const {
+    return TokenSet(Bits{static_cast<uint16_t>(bits | other.bits)});
+  }
+
+  /// The bit for a token; its position in tokenOrder
+  static constexpr uint16_t bit(Token token) {
+    switch (token) {
+    case HIT_END:    return 1 << 0;
+    case string:     return 1 << 1;
+    case COMMA:      return 1 << 2;
+    case number:     return 1 << 3;
+    case COLON:      return 1 << 4;
+    case array:      return 1 << 5;
+    case ARRAY_END:  return 1 << 6;
+    case null:       return 1 << 7;
+    case boolean:    return 1 << 8;
+    case ERROR:      return 1 << 9;
+    case object:     return 1 << 10;
+    case OBJECT_END: return 1 << 11;
+    }
+    return 0;
+  }
+
+private:
+  struct Bits {
+    uint16_t value;
+  };
+  constexpr explicit TokenSet(Bits bits) : bits(bits.value) {}
+  uint16_t bits;
+};
+
+/// Makes the error message for require()
+inline std::string unexpectedTokenMessage(TokenSet expected, Token got) {
+  std::string msg = "Expected ";
+  // List of expected tokens
+  for (Token token : tokenOrder)
+    if (expected.contains(token)) {
+      msg += '\'';
+      msg += static_cast<char>(token);
+      msg += "', ";
+    }
+  msg.resize(msg.size() - 2); // Remove the last ', '
+  if (got == HIT_END)
+    msg += "' but hit the end of input";
+  else
+    msg += std::string("' but got '") + static_cast<char>(got) + "' instead";
+  return msg;
+}
+
 /// Throws an error if the next token is not acceptable
-/// @param acceptable Tokens that don't cause an error
+/// @param expected Tokens that don't cause an error
 /// @param parser status
 /// return 
 template <typename Status>
-Token require(std::set<Token> expected, Status& status) {
+inline Token require(TokenSet expected, Status& status) {
   Token got = getNextOuterToken(status);
-  if (expected.find(got) != expected.end())
+  if (expected.contains(got))
     return got;
-  // Make up the error message
-  std::stringstream msg;
-  msg << "Expected ";
-  // List of expected tokens
-  for (auto token : expected)
-    msg << "'" << (char)token << "', ";
-  msg.seekp(-2, std::ios_base::cur); // Remove the last ', '
-  if (got == HIT_END)
-    msg << "' but hit the end of input";
-  else
-    msg << "' but got '" << (char)got << "' instead";
-  status.onError(msg.str());
+  status.onError(got == HIT_END ? ErrorCode::unexpectedEnd
+                                 : ErrorCode::unexpectedToken,
+                 [expected, got]() {
+                   return unexpectedTokenMessage(expected, got);
+                 });
   assert(true); // Code should never reach here. onError should throw an
                 // expection
   return ERROR;
@@ -47,10 +107,10 @@ Token require(std::set<Token> expected, Status& status) {
 */
 template <typename Status>
 inline Token require(Token required, Status& status) {
-  return require(std::set<Token>{required}, status);
+  return require(TokenSet(required), status);
 }
 
-inline const std::set<Token> valueTokens() {
+constexpr TokenSet valueTokens() {
   return {null, boolean, array, object, number, string};
 }
 
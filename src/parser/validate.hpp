@@ -0,0 +1,607 @@
+/// Checks that some text is valid json, without reading it into anything
+///
+/// For when you only need to know whether to accept a document, like a
+/// gateway that passes the bytes on untouched. It checks the structure, string
+/// escapes, numbers and that strings are well formed UTF-8, and it never
+/// allocates: nesting is tracked in a fixed size bit stack rather than by
+/// recursion.
+///
+///     auto result = validate(body.begin(), body.end());
+///     if (!result)
+///       reject(describe(result.error), result.offset);
+///
+/// Contiguous char input is classified 64 bytes at a time with the vectorized
+/// kernels in simd.hpp. The masks tell us which chars are inside strings, so
+/// the grammar is only checked at the brackets, commas, colons, quotes and the
+/// starts of numbers and literals; plain string text is never looked at one
+/// char at a time. Other iterators are walked a char at a time.
+///
+/// It follows RFC 8259 to the letter, so it's stricter than the readers in a
+/// couple of places: trailing commas ('[1,]') and numbers with leading zeros
+/// ('01') are rejected.
+#pragma once
+
+#include "../unicode.hpp"
+#include "error.hpp"
+#include "outer.hpp"
+#include "simd.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+namespace json {
+
+/// How deeply arrays and objects may be nested in json given to validate()
+constexpr size_t validateMaxDepth = 1024;
+
+namespace detail {
+
+/// The arrays and objects that we're inside; one bit each
+class NestingStack {
+public:
+  /// Enters an array or object; false if that's too deep
+  bool push(bool isObject) {
+    if (depth == validateMaxDepth)
+      return false;
+    const uint64_t bit = uint64_t(1) << (depth % 64);
+    if (isObject)
+      bits[depth / 64] |= bit;
+    else
+      bits[depth / 64] &= ~bit;
+    ++depth;
+    return true;
+  }
+  void pop() { --depth; }
+  bool empty() const { return depth == 0; }
+  /// True if the innermost one is an object
+  bool inObject() const {
+    const size_t top = depth - 1;
+    return (bits[top / 64] >> (top % 64)) & 1;
+  }
+
+private:
+  uint64_t bits[validateMaxDepth / 64] = {};
+  size_t depth = 0;
+};
+
+template <typename Iterator>
+bool isDigitAt(const Iterator &p, const Iterator &pe) {
+  return (p != pe) && (*p >= '0') && (*p <= '9');
+}
+
+/// Reads one or more digits
+template <typename Iterator>
+ErrorCode validateDigits(Iterator &p, const Iterator &pe) {
+  if (!isDigitAt(p, pe))
+    return (p == pe) ? ErrorCode::unexpectedEnd : ErrorCode::badNumber;
+  do
+    ++p;
+  while (isDigitAt(p, pe));
+  return ErrorCode::none;
+}
+
+/// Reads a number: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+template <typename Iterator>
+ErrorCode validateNumber(Iterator &p, const Iterator &pe) {
+  if (*p == '-')
+    ++p;
+  if ((p != pe) && (*p == '0')) {
+    ++p;
+    if (isDigitAt(p, pe))
+      return ErrorCode::badNumber; // Leading zero
+  } else {
+    const ErrorCode error = validateDigits(p, pe);
+    if (error != ErrorCode::none)
+      return error;
+  }
+  if ((p != pe) && (*p == '.')) {
+    ++p;
+    const ErrorCode error = validateDigits(p, pe);
+    if (error != ErrorCode::none)
+      return error;
+  }
+  if ((p != pe) && ((*p == 'e') || (*p == 'E'))) {
+    ++p;
+    if ((p != pe) && ((*p == '+') || (*p == '-')))
+      ++p;
+    return validateDigits(p, pe);
+  }
+  return ErrorCode::none;
+}
+
+/// Reads true, false or null
+template <typename Iterator>
+ErrorCode validateLiteral(Iterator &p, const Iterator &pe,
+                          const char *expected) {
+  for (; *expected; ++expected, ++p) {
+    if (p == pe)
+      return ErrorCode::unexpectedEnd;
+    if (*p != *expected)
+      return ErrorCode::badLiteral;
+  }
+  return ErrorCode::none;
+}
+
+/// Reads an escape sequence, starting at its '\\'
+template <typename Iterator>
+ErrorCode validateEscape(Iterator &p, const Iterator &pe) {
+  if (++p == pe)
+    return ErrorCode::unexpectedEnd;
+  switch (*p) {
+  case '"': case '\\': case '/': case 'b':
+  case 'f': case 'n': case 'r': case 't':
+    ++p;
+    return ErrorCode::none;
+  case 'u':
+    ++p;
+    for (int i = 0; i < 4; ++i, ++p) {
+      if (p == pe)
+        return ErrorCode::unexpectedEnd;
+      const char c = *p;
+      if (!(((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'f')) ||
+            ((c >= 'A') && (c <= 'F'))))
+        return ErrorCode::badString;
+    }
+    return ErrorCode::none;
+  default:
+    return ErrorCode::badString;
+  }
+}
+
+/// Walks one json document a char at a time, checking it as it goes
+template <typename Iterator> class Validator {
+public:
+  Validator(Iterator p, Iterator pe) : p(p), pe(pe) {}
+
+  /// Checks the whole input: one value with optional whitespace around it
+  ErrorCode document() {
+    if (!value())
+      return error;
+    skipWS(p, pe);
+    return (p == pe) ? ErrorCode::none : ErrorCode::unexpectedToken;
+  }
+
+  /// Where we're up to; the bad char after an error
+  Iterator p;
+
+private:
+  const Iterator pe;
+  ErrorCode error = ErrorCode::none;
+  NestingStack stack;
+
+  bool fail(ErrorCode code) {
+    error = code;
+    return false;
+  }
+
+  /// Records 'code' unless it's none
+  bool check(ErrorCode code) { return (code == ErrorCode::none) || fail(code); }
+
+  /// Skips whitespace; false if that was the end of the input
+  bool more() {
+    skipWS(p, pe);
+    return (p != pe) || fail(ErrorCode::unexpectedEnd);
+  }
+
+  /// Reads a key and its ':', just after the '{' or ','
+  bool key() {
+    if (!more())
+      return false;
+    if (*p != '"')
+      return fail(ErrorCode::unexpectedToken);
+    ++p;
+    if (!string() || !more())
+      return false;
+    if (*p != ':')
+      return fail(ErrorCode::unexpectedToken);
+    ++p;
+    return true;
+  }
+
+  /// Reads one value, and all the values inside it
+  bool value() {
+    for (;;) {
+      // Start a value
+      if (!more())
+        return false;
+      switch (*p) {
+      case '[':
+        if (!stack.push(false))
+          return fail(ErrorCode::tooDeep);
+        ++p;
+        if (!more())
+          return false;
+        if (*p != ']')
+          continue; // Read the first item
+        stack.pop();
+        ++p;
+        break;
+      case '{':
+        if (!stack.push(true))
+          return fail(ErrorCode::tooDeep);
+        ++p;
+        if (!more())
+          return false;
+        if (*p != '}') {
+          if (!key())
+            return false;
+          continue; // Read the first member's value
+        }
+        stack.pop();
+        ++p;
+        break;
+      case '"':
+        ++p;
+        if (!string())
+          return false;
+        break;
+      case '-': case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        if (!check(validateNumber(p, pe)))
+          return false;
+        break;
+      case 't':
+        if (!check(validateLiteral(p, pe, "true")))
+          return false;
+        break;
+      case 'f':
+        if (!check(validateLiteral(p, pe, "false")))
+          return false;
+        break;
+      case 'n':
+        if (!check(validateLiteral(p, pe, "null")))
+          return false;
+        break;
+      default:
+        return fail(ErrorCode::unexpectedToken);
+      }
+      // We've finished a value; close any containers that end here
+      for (;;) {
+        if (stack.empty())
+          return true;
+        if (!more())
+          return false;
+        const bool object = stack.inObject();
+        if (*p == ',') {
+          ++p;
+          if (object && !key())
+            return false;
+          break; // Read the next value
+        }
+        if (*p != (object ? '}' : ']'))
+          return fail(ErrorCode::unexpectedToken);
+        ++p;
+        stack.pop();
+      }
+    }
+  }
+
+  /// Reads the rest of a string, after its opening '"'
+  bool string() {
+    for (;;) {
+      while ((p != pe) && (*p != '"') && (*p != '\\') &&
+             (static_cast<unsigned char>(*p) >= 0x20) &&
+             (static_cast<unsigned char>(*p) < 0x80))
+        ++p;
+      if (p == pe)
+        return fail(ErrorCode::unexpectedEnd);
+      const unsigned char c = static_cast<unsigned char>(*p);
+      if (c == '"') {
+        ++p;
+        return true;
+      }
+      if (c == '\\') {
+        if (!check(validateEscape(p, pe)))
+          return false;
+      } else if (c < 0x20)
+        return fail(ErrorCode::badString);
+      else if (!skipUTF8Char(p, pe))
+        return fail(ErrorCode::badUTF8);
+    }
+  }
+};
+
+/**
+ * @brief Checks contiguous input a 64 byte block at a time
+ *
+ * Each block is classified into bit masks. Quotes that aren't escaped toggle
+ * whether we're in a string (the same prefix xor as simd::skipBlock), which
+ * gives us the tokens: brackets, commas and colons outside strings, opening
+ * quotes, and the first char of each run of anything else. Only the tokens
+ * go through the grammar; numbers and literals are then read from the input
+ * as usual.
+ *
+ * The control chars, escapes and non ASCII chars inside strings come
+ * straight from the masks too. Those string errors are found a block ahead of
+ * the grammar, so we hold on to the first one and only report it once the
+ * grammar gets past it; that way we stop at the same place as Validator.
+ */
+class BlockValidator {
+public:
+  BlockValidator(const char *p, const char *pe)
+      : where(p), start(p), pe(pe), utf8Next(p) {}
+
+  /// Checks the whole input: one value with optional whitespace around it
+  ErrorCode document() {
+    const char *p = start;
+    while (pe - p >= static_cast<std::ptrdiff_t>(simd::blockSize)) {
+      if (!block(p, p, simd::blockSize))
+        return error;
+      p += simd::blockSize;
+    }
+    if (p != pe) {
+      // Pad the tail with spaces, which are never tokens
+      char tail[simd::blockSize];
+      std::memset(tail, ' ', simd::blockSize);
+      std::memcpy(tail, p, pe - p);
+      if (!block(tail, p, pe - p))
+        return error;
+    }
+    if (stringError)
+      fail(stringErrorCode, stringError);
+    else if (inString || (expect != end))
+      fail(ErrorCode::unexpectedEnd, pe);
+    return error;
+  }
+
+  /// The bad char after an error
+  const char *where;
+
+private:
+  /// What the grammar allows next. After a value inside an array or object
+  /// comes its ',' or its end.
+  enum Expect { value, valueOrArrayEnd, keyOrObjectEnd, key, colon,
+                arrayNext, objectNext, end };
+
+  const char *const start;
+  const char *const pe;
+  ErrorCode error = ErrorCode::none;
+  NestingStack stack;
+  Expect expect = value;
+  // Carried from one block to the next
+  bool inString = false;
+  bool escaped = false;
+  bool inScalar = false;
+  /// Where the next UTF-8 char can start
+  const char *utf8Next;
+  /// The first problem inside a string, which the grammar hasn't got to yet
+  const char *stringError = nullptr;
+  ErrorCode stringErrorCode = ErrorCode::none;
+
+  bool fail(ErrorCode code, const char *at) {
+    error = code;
+    where = at;
+    return false;
+  }
+
+  /**
+   * @brief Checks one block
+   *
+   * @param bytes The block's 64 bytes
+   * @param base Where the block starts in the input; different to 'bytes' for
+   *             the padded tail
+   * @param size How many of the bytes are input
+   */
+  bool block(const char *bytes, const char *base, size_t size) {
+    static const simd::ValidationClassifier classifier =
+        simd::validationClassifierFor(simd::instructionSet());
+    const simd::ValidationMasks masks = classifier(bytes);
+    uint64_t escapes = 0;
+    if (masks.backslash || escaped)
+      escapes = simd::escapedChars(masks.backslash, escaped);
+    const uint64_t quote = masks.quote & ~escapes;
+    const uint64_t inside =
+        simd::prefixXor(quote) ^ (inString ? ~uint64_t(0) : 0);
+    inString = (inside >> 63) != 0;
+    if (!stringError &&
+        ((masks.control | escapes | masks.nonASCII) & inside))
+      checkStrings(masks, escapes, inside, base, size);
+    const uint64_t scalar =
+        ~(masks.whitespace | masks.structural | quote) & ~inside;
+    const uint64_t scalarStarts =
+        scalar & ~((scalar << 1) | (inScalar ? 1 : 0));
+    inScalar = (scalar >> 63) != 0;
+    for (uint64_t tokens =
+             (masks.structural & ~inside) | (quote & inside) | scalarStarts;
+         tokens; tokens &= tokens - 1) {
+      const char *t = base + simd::firstBit(tokens);
+      if (stringError && (stringError < t))
+        return fail(stringErrorCode, stringError);
+      if (!token(t))
+        return false;
+    }
+    return true;
+  }
+
+  /// Finds the first bad control char, escape or UTF-8 in the block's strings
+  void checkStrings(const simd::ValidationMasks &masks, uint64_t escapes,
+                    uint64_t inside, const char *base, size_t size) {
+    const uint64_t input =
+        (size == simd::blockSize) ? ~uint64_t(0) : (uint64_t(1) << size) - 1;
+    inside &= input;
+    const char *first = nullptr;
+    ErrorCode code = ErrorCode::none;
+    if (const uint64_t control = masks.control & inside) {
+      first = base + simd::firstBit(control);
+      code = ErrorCode::badString;
+    }
+    for (uint64_t bits = escapes & inside; bits; bits &= bits - 1) {
+      const char *p = base + simd::firstBit(bits) - 1; // The backslash
+      if (first && (p >= first))
+        break;
+      const ErrorCode bad = validateEscape(p, pe);
+      if (bad != ErrorCode::none) {
+        if (!first || (p < first)) {
+          first = p;
+          code = bad;
+        }
+        break;
+      }
+    }
+    for (uint64_t bits = masks.nonASCII & inside; bits; bits &= bits - 1) {
+      const char *p = base + simd::firstBit(bits);
+      if (p < utf8Next)
+        continue; // Part of the last char
+      if (first && (p >= first))
+        break;
+      const char *lead = p;
+      if (!skipUTF8Char(p, pe)) {
+        first = lead;
+        code = ErrorCode::badUTF8;
+        break;
+      }
+      utf8Next = p;
+    }
+    stringError = first;
+    stringErrorCode = code;
+  }
+
+  /// Moves on after a whole value
+  bool endValue() {
+    expect = stack.empty() ? end
+                           : (stack.inObject() ? objectNext : arrayNext);
+    return true;
+  }
+
+  /// Closes the innermost array or object
+  bool close() {
+    stack.pop();
+    return endValue();
+  }
+
+  bool open(bool isObject, const char *t) {
+    if (!stack.push(isObject))
+      return fail(ErrorCode::tooDeep, t);
+    expect = isObject ? keyOrObjectEnd : valueOrArrayEnd;
+    return true;
+  }
+
+  /// Reads a number or literal that starts at 't'. It has to fill its whole
+  /// run of chars.
+  template <typename Reader> bool scalar(const char *t, Reader read) {
+    const char *p = t;
+    const ErrorCode code = read(p);
+    if (code != ErrorCode::none)
+      return fail(code, p);
+    if (p != pe) {
+      switch (*p) {
+      case ' ': case '\t': case '\n': case '\r': case '"':
+      case ',': case ':': case '[': case ']': case '{': case '}':
+        break;
+      default:
+        return fail(ErrorCode::unexpectedToken, p);
+      }
+    }
+    return endValue();
+  }
+
+  /// Checks a token against the grammar
+  bool token(const char *t) {
+    const char c = *t;
+    switch (expect) {
+    case value:
+    case valueOrArrayEnd:
+      switch (c) {
+      case '[':
+        return open(false, t);
+      case '{':
+        return open(true, t);
+      case ']':
+        if (expect == valueOrArrayEnd)
+          return close();
+        break;
+      case '"':
+        return endValue(); // checkStrings looks after what's inside
+      case '-': case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9':
+        return scalar(t, [this](const char *&p) {
+          return validateNumber(p, pe);
+        });
+      case 't':
+        return scalar(t, [this](const char *&p) {
+          return validateLiteral(p, pe, "true");
+        });
+      case 'f':
+        return scalar(t, [this](const char *&p) {
+          return validateLiteral(p, pe, "false");
+        });
+      case 'n':
+        return scalar(t, [this](const char *&p) {
+          return validateLiteral(p, pe, "null");
+        });
+      }
+      break;
+    case keyOrObjectEnd:
+      if (c == '}')
+        return close();
+    // Fall through
+    case key:
+      if (c == '"') {
+        expect = colon;
+        return true;
+      }
+      break;
+    case colon:
+      if (c == ':') {
+        expect = value;
+        return true;
+      }
+      break;
+    case arrayNext:
+      if (c == ',') {
+        expect = value;
+        return true;
+      }
+      if (c == ']')
+        return close();
+      break;
+    case objectNext:
+      if (c == ',') {
+        expect = key;
+        return true;
+      }
+      if (c == '}')
+        return close();
+      break;
+    case end:
+      break;
+    }
+    return fail(ErrorCode::unexpectedToken, t);
+  }
+};
+
+} // namespace detail
+
+/**
+ * @brief Checks that [begin, end) holds exactly one valid json value
+ *
+ * @tparam Iterator A forward iterator over chars
+ *
+ * @return No error if it's valid; otherwise what the first problem was and its
+ *         offset from 'begin'
+ */
+template <typename Iterator>
+ParseResult<void> validate(Iterator begin, Iterator end) {
+  BOOST_HANA_CONSTANT_ASSERT(is_forward_iterator(begin));
+  ParseResult<void> result;
+  hana::if_(is_contiguous_iterator(begin),
+            [](const auto &begin, const auto &end, auto &result) {
+              const char *first = (begin == end) ? "" : &*begin;
+              detail::BlockValidator validator(first, first + (end - begin));
+              result.error = validator.document();
+              result.offset = validator.where - first;
+            },
+            [](const auto &begin, const auto &end, auto &result) {
+              using It = std::decay_t<decltype(begin)>;
+              detail::Validator<It> validator(begin, end);
+              result.error = validator.document();
+              if (result.error != ErrorCode::none)
+                result.offset = std::distance(begin, validator.p);
+            })(begin, end, result);
+  if (result.ok())
+    result.offset = 0;
+  return result;
+}
+
+} // namespace json
@@ -0,0 +1,71 @@
+/// Tests the monotonic memory arena
+
+#include <bandit/bandit.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "arena.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+go_bandit([]() {
+
+  describe("The arena", [&]() {
+
+    it("1.0 Hands out aligned memory", [&]() {
+      Arena arena(64);
+      for (size_t alignment = 1; alignment <= 64; alignment *= 2) {
+        arena.allocate(1, 1);
+        auto p = reinterpret_cast<std::uintptr_t>(arena.allocate(3, alignment));
+        AssertThat(p % alignment, Equals(0u));
+      }
+    });
+
+    it("1.1 Grows in blocks", [&]() {
+      Arena arena(64);
+      for (int i = 0; i < 1000; ++i)
+        arena.allocate(16, 8);
+      AssertThat(arena.bytesAllocated(), Equals(16000u));
+      // 64 + 128 + ... doubles, so 16000 bytes needs far fewer than 1000 blocks
+      AssertThat(arena.blockCount() < 10, Equals(true));
+    });
+
+    it("1.2 Can allocate more than a block at once", [&]() {
+      Arena arena(64);
+      char *p = arena.allocateArray<char>(10000);
+      p[9999] = 'x';
+      AssertThat(arena.blockCount(), Equals(1u));
+    });
+
+    it("1.3 Copies strings and releases everything at once", [&]() {
+      Arena arena;
+      std::string text = "hello";
+      const char *copy = arena.copy(text.data(), text.size());
+      AssertThat(std::string(copy, copy + 5), Equals(text));
+      arena.release();
+      AssertThat(arena.blockCount(), Equals(0u));
+      AssertThat(arena.bytesAllocated(), Equals(0u));
+    });
+
+    it("1.4 Stays inside blocks that aren't a multiple of the alignment", [&]() {
+      for (size_t size = 97; size < 104; ++size) {
+        Arena arena(size);
+        char *bytes = static_cast<char *>(arena.allocate(size - 3, 1));
+        // Aligning the end of those bytes goes past the end of the block
+        char *word = static_cast<char *>(arena.allocate(8, 8));
+        AssertThat(arena.blockCount(), Equals(2u));
+        AssertThat(reinterpret_cast<std::uintptr_t>(word) % 8, Equals(0u));
+        std::memset(bytes, 'a', size - 3);
+        std::memset(word, 'b', 8);
+      }
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
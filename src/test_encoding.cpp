@@ -0,0 +1,149 @@
+/// Tests working out how json is encoded, and converting wide json in blocks
+#include <bandit/bandit.h>
+
+#include <string>
+
+#include "encoding.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Encodes utf-8 'text' as 'encoding', a byte at a time
+std::string encode(const std::string &text, Encoding encoding) {
+  const char *p = text.data();
+  const char *pe = p + text.size();
+  std::u32string chars(wideSize<char32_t>(p, pe), U'\0');
+  utf8ToWide(p, pe, &chars[0]);
+  std::u16string units;
+  for (char32_t c : chars)
+    to16(&c, std::back_inserter(units));
+  const bool big = (encoding == Encoding::utf16BE) ||
+                   (encoding == Encoding::utf32BE);
+  std::string result;
+  auto put = [&](uint32_t unit, int width) {
+    for (int i = 0; i != width; ++i) {
+      const int shift = 8 * (big ? width - 1 - i : i);
+      result += static_cast<char>((unit >> shift) & 0xFF);
+    }
+  };
+  if (unitSize(encoding) == 2)
+    for (char16_t unit : units)
+      put(unit, 2);
+  else
+    for (char32_t c : chars)
+      put(c, 4);
+  return result;
+}
+
+/// Runs 'bytes' through UTF8Blocks and joins up the blocks
+std::string convert(const std::string &bytes, Encoding encoding,
+                    size_t *blockCount = nullptr) {
+  UTF8Blocks blocks(bytes.data(), bytes.data() + bytes.size(), encoding);
+  std::string result;
+  size_t count = 0;
+  while (blocks.next()) {
+    result.append(blocks.data(), blocks.size());
+    ++count;
+  }
+  if (blockCount)
+    *blockCount = count;
+  return result;
+}
+
+const Encoding wideEncodings[] = {Encoding::utf16BE, Encoding::utf16LE,
+                                  Encoding::utf32BE, Encoding::utf32LE};
+
+go_bandit([]() {
+
+  describe("detectEncoding", [&]() {
+
+    it("1.0 Goes by the nulls in the first four bytes", [&]() {
+      for (std::string json : {"{}", "[1]", "12", "\"x\"", " \n{\"a\": 1}"})
+        for (Encoding encoding : wideEncodings) {
+          const std::string bytes = encode(json, encoding);
+          AssertThat(detectEncoding(bytes.data(), bytes.data() + bytes.size()) ==
+                         encoding,
+                     Equals(true));
+        }
+      for (std::string json : {"{}", "1", "", u8"\"é\""})
+        AssertThat(detectEncoding(json.data(), json.data() + json.size()) ==
+                       Encoding::utf8,
+                   Equals(true));
+    });
+
+    it("1.1 Goes by byte order marks, and can skip them", [&]() {
+      for (Encoding encoding : wideEncodings) {
+        const std::string bytes = encode(u8"\uFEFF[]", encoding);
+        const char *p = bytes.data();
+        const char *pe = p + bytes.size();
+        AssertThat(detectEncoding(p, pe) == encoding, Equals(true));
+        AssertThat(byteOrderMarkSize(p, pe, encoding), Equals(unitSize(encoding)));
+        AssertThat(byteOrderMarkSize(p + unitSize(encoding), pe, encoding),
+                   Equals(0u));
+      }
+      const std::string utf8 = "\xEF\xBB\xBF[]";
+      AssertThat(detectEncoding(utf8.data(), utf8.data() + utf8.size()) ==
+                     Encoding::utf8,
+                 Equals(true));
+      AssertThat(byteOrderMarkSize(utf8.data(), utf8.data() + utf8.size(),
+                                   Encoding::utf8),
+                 Equals(3u));
+    });
+
+  });
+
+  describe("UTF8Blocks", [&]() {
+
+    // Long enough for a few blocks, with surrogate pairs landing on every
+    // block boundary one way or another
+    std::string text;
+    while (text.size() < 5 * UTF8Blocks::blockUnits)
+      text += u8"ab\U0001F600cé日";
+
+    it("2.0 Converts wide text in either byte order", [&]() {
+      for (Encoding encoding : wideEncodings) {
+        size_t blocks = 0;
+        AssertThat(convert(encode(text, encoding), encoding, &blocks),
+                   Equals(text));
+        AssertThat(blocks > 1, Equals(true));
+      }
+    });
+
+    it("2.1 Doesn't split surrogate pairs between blocks", [&]() {
+      for (size_t shift = 0; shift < 4; ++shift) {
+        const std::string shifted = std::string(shift, 'x') + text;
+        AssertThat(convert(encode(shifted, Encoding::utf16LE), Encoding::utf16LE),
+                   Equals(shifted));
+      }
+    });
+
+    it("2.2 Writes U+FFFD for what's not text", [&]() {
+      std::string bytes = encode("a", Encoding::utf16LE) + std::string("\x00\xD8", 2) +
+                          encode("b", Encoding::utf16LE) + "c";
+      AssertThat(convert(bytes, Encoding::utf16LE),
+                 Equals(u8"a\uFFFDb\uFFFD"));
+      bytes = encode("a", Encoding::utf32BE) + std::string("\x00\x11\x00\x00", 4);
+      AssertThat(convert(bytes, Encoding::utf32BE), Equals(u8"a\uFFFD"));
+    });
+
+    it("2.3 Says where the utf-8 came from", [&]() {
+      const std::string bytes = encode(u8"aé\U0001F600b", Encoding::utf16BE);
+      UTF8Blocks blocks(bytes.data(), bytes.data() + bytes.size(),
+                        Encoding::utf16BE);
+      AssertThat(blocks.next(), Equals(true));
+      const char *utf8 = blocks.data();
+      // a é é 😀 😀 😀 😀 b
+      const size_t expected[] = {0, 2, 2, 4, 4, 4, 4, 8};
+      for (size_t i = 0; i != 8; ++i)
+        AssertThat(blocks.source(utf8 + i) - bytes.data(), Equals(expected[i]));
+      AssertThat(blocks.source(utf8 + blocks.size()) - bytes.data(), Equals(10));
+      AssertThat(blocks.source(nullptr) - bytes.data(), Equals(10));
+      AssertThat(blocks.next(), Equals(false));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
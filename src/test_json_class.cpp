@@ -58,7 +58,7 @@ go_bandit([]() {
       AssertThat(j.whatIs(), Equals(JSON::number));
       AssertThat((long double)j, Equals(3.1415927));
       output << j;
-      AssertThat(output.str(), Equals("3.14159"));
+      AssertThat(output.str(), Equals("3.1415927"));
     });
 
     it("1.6. Can be a string", [&]() {
@@ -111,7 +111,80 @@ go_bandit([]() {
                                     JMap{{"username", username},
                                          {"apiKey", apiKey}}}}}});
       std::string output = json.toString();
-      AssertThat(output, Equals(R"({"auth":{"RAX-KSKEY:apiKeyCredentials":{"apiKey":"1234567890","username":"mister awesome"}}})"));
+      AssertThat(output, Equals(R"({"auth":{"RAX-KSKEY:apiKeyCredentials":{"username":"mister awesome","apiKey":"1234567890"}}})"));
+    });
+
+    it("1.10. Fits in 16 bytes", [&]() {
+      AssertThat(sizeof(JSON), Equals((size_t)16));
+    });
+
+    it("1.11. Keeps short and long strings", [&]() {
+      std::string fits(JSON::shortTextCapacity, 'a');
+      std::string tooLong(JSON::shortTextCapacity + 1, 'b');
+      JSON shortOne(fits.c_str());
+      JSON longOne(tooLong);
+      AssertThat(std::string(shortOne), Equals(fits));
+      AssertThat(std::string(longOne), Equals(tooLong));
+      JSON copy(longOne);
+      JSON moved(std::move(shortOne));
+      AssertThat(std::string(copy), Equals(tooLong));
+      AssertThat(std::string(moved), Equals(fits));
+      AssertThat(shortOne.isNull(), Equals(true));
+      AssertThat(JSON("") == JSON(std::string()), Equals(true));
+      AssertThat(bool(JSON("")), Equals(false));
+    });
+
+    it("1.12. Keeps 64 bit integers exactly", [&]() {
+      JSON big(int64_t(-9007199254740993));
+      JSON huge(uint64_t(18446744073709551615u));
+      AssertThat(big.isInteger(), Equals(true));
+      AssertThat(static_cast<int64_t>(big), Equals(int64_t(-9007199254740993)));
+      AssertThat(static_cast<uint64_t>(huge), Equals(uint64_t(18446744073709551615u)));
+      AssertThat(big.toString(), Equals("-9007199254740993"));
+      AssertThat(huge.toString(), Equals("18446744073709551615"));
+      AssertThat(JSON(2.5).isInteger(), Equals(false));
+      AssertThat(JSON(3) == JSON(3u), Equals(true));
+      AssertThat(JSON(-1) == JSON(uint64_t(18446744073709551615u)), Equals(false));
+      AssertThat(JSON(3) == JSON(3.0), Equals(true));
+    });
+
+    it("1.13. Writes the same text to a string, an iterator and a stream", [&]() {
+      JSON j(JList{JSON(), JBool(false), 1, -2.5, "text",
+                   JMap{{"a", JList{}}, {"b", JMap{}}}});
+      const std::string expected = R"([null,false,1,-2.5,"text",{"a":[],"b":{}}])";
+      AssertThat(j.toString(), Equals(expected));
+      std::string viaIterator;
+      write(j, std::back_inserter(viaIterator));
+      AssertThat(viaIterator, Equals(expected));
+      output << j;
+      AssertThat(output.str(), Equals(expected));
+      // More than the stream sink's buffer holds
+      JList many(2000, JSON("0123456789"));
+      std::stringstream big;
+      big << JSON(many);
+      AssertThat(big.str(), Equals(JSON(many).toString()));
+      AssertThat(big.str().size(), Equals(size_t(2000 * 13 + 1)));
+    });
+
+    it("1.14. Escapes strings and keys", [&]() {
+      JSON j(JMap{{"say \"hi\"", JList{"tab\there", u8"caf\u00e9"}}});
+      AssertThat(j.toString(), Equals(R"({"say \"hi\"":["tab\there","caf)"
+                                      u8"\u00e9" R"("]})"));
+      AssertThat(j.toString(Escape::nonASCII),
+                 Equals(R"({"say \"hi\"":["tab\there","caf\u00e9"]})"));
+      output << JSON("a\\b");
+      AssertThat(output.str(), Equals(R"("a\\b")"));
+    });
+
+    it("1.15. Converts text to a wide string", [&]() {
+      std::string text = u8"plain ascii, caf\u00e9, \u65e5\u672c and \U0001F600 ";
+      for (int i = 0; i < 4; ++i)
+        text += text;
+      std::wstring expected;
+      json::transformFrom8(text.cbegin(), text.cend(), std::back_inserter(expected));
+      AssertThat(std::wstring(JSON(text)), Equals(expected));
+      AssertThat(std::wstring(JSON("")), Equals(std::wstring()));
+      AssertThrows(UnicodeError, std::wstring(JSON("bad \xff")));
     });
 
   });
@@ -178,6 +251,75 @@ go_bandit([]() {
       AssertThat(got, Equals(expected));
     });
 
+    it("2.6. Keeps entries in the order they were added", [&]() {
+      JSON j{JMap{{"zebra", 1}, {"apple", 2}}};
+      j["mango"] = {3};
+      j["apple"] = {4};
+      AssertThat(j.toString(), Equals(R"({"zebra":1,"apple":4,"mango":3})"));
+      JSON reordered{JMap{{"mango", 3}, {"apple", 4}, {"zebra", 1}}};
+      AssertThat(j == reordered, Equals(true));
+    });
+
+    it("2.7. Finds entries in big maps", [&]() {
+      JSON j{JMap{}};
+      for (int i = 0; i < 1000; ++i)
+        j[std::to_string(i)] = {static_cast<long double>(i)};
+      const JMap &map = j;
+      AssertThat(map.size(), Equals((size_t)1000));
+      for (int i = 0; i < 1000; ++i)
+        AssertThat(static_cast<int>(j.at(std::to_string(i))), Equals(i));
+      AssertThat(j.find("1000") == map.end(), Equals(true));
+      AssertThat(map.begin()->first, Equals("0"));
+      j["500"] = {-1};
+      AssertThat(map.size(), Equals((size_t)1000));
+      AssertThat(static_cast<int>(j["500"]), Equals(-1));
+    });
+
+    it("2.8. Copies entries into new keys of the same map", [&]() {
+      JSON j{JMap{{"0", "a string too long to be stored in the node"}}};
+      // Enough keys to fill a few chunks and build the hash index
+      for (int i = 1; i < 100; ++i)
+        j[std::to_string(i)] = j[std::to_string(i - 1)];
+      const JMap &map = j;
+      AssertThat(map.size(), Equals((size_t)100));
+      for (int i = 0; i < 100; ++i)
+        AssertThat(std::string(j.at(std::to_string(i))),
+                   Equals("a string too long to be stored in the node"));
+      // References stay put as the map grows
+      JSON &first = j["0"];
+      for (int i = 100; i < 200; ++i)
+        j[std::to_string(i)] = {i};
+      AssertThat(&first == &j["0"], Equals(true));
+    });
+
+    it("2.9. Erases entries by key and by iterator", [&]() {
+      for (int size : {5, 40}) {
+        JSON j{JMap{}};
+        JMap &map = j;
+        for (int i = 0; i < size; ++i) {
+          const std::string key = std::to_string(i);
+          map.insert_or_assign(key, JSON(i));
+        }
+        AssertThat(map.erase(std::string("3")), Equals((size_t)1));
+        AssertThat(map.erase("3"), Equals((size_t)0));
+        auto next = map.erase(map.begin());
+        AssertThat(next->first, Equals("1"));
+        next = map.erase(map.find("2"));
+        AssertThat(next->first, Equals("4"));
+        AssertThat(map.size(), Equals((size_t)size - 3));
+        AssertThat(map.count("0") + map.count("2") + map.count("3"),
+                   Equals((size_t)0));
+        for (int i = 4; i < size; ++i)
+          AssertThat(static_cast<int>(j.at(std::to_string(i))), Equals(i));
+        AssertThat(map.begin()->first, Equals("1"));
+        AssertThat((map.begin() + 1)->first, Equals("4"));
+        // Added entries go at the end, after a reused chunk
+        j["new"] = {-1};
+        AssertThat((map.end() - 1)->first, Equals("new"));
+        AssertThat(static_cast<int>(j.at("new")), Equals(-1));
+      }
+    });
+
   });
 
   describe("The model as a list", [&]() {
@@ -215,6 +357,30 @@ go_bandit([]() {
 
   });
 
+  describe("The model with an arena allocator", [&]() {
+
+    using AJSON = basic_JSON<ArenaAllocator<char>>;
+
+    it("4.1. Keeps its strings, lists and maps in the arena", [&]() {
+      Arena arena;
+      ArenaAllocator<char> alloc(arena);
+      AJSON j{AJSON::JMap(alloc)};
+      j["name"] = AJSON("value", alloc);
+      j["list"] = AJSON::JList({AJSON(1), AJSON("a long string, too long for SSO", alloc)}, alloc);
+      output << j;
+      AssertThat(output.str(), Equals(R"({"name":"value","list":[1,"a long string, too long for SSO"]})"));
+      AssertThat(std::string(j.at("name")), Equals("value"));
+      AssertThat(std::string(j.at(std::string("name"))), Equals("value"));
+      size_t used = arena.bytesAllocated();
+      AssertThat(used > 0, Equals(true));
+      // Copies share the arena
+      AJSON copy(j);
+      AssertThat(copy == j, Equals(true));
+      AssertThat(arena.bytesAllocated() > used, Equals(true));
+    });
+
+  });
+
 });
 
 int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
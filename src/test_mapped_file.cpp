@@ -0,0 +1,73 @@
+/// Tests reading json files through a memory map
+#include <bandit/bandit.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include "mapped_file.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Writes 'contents' to a file called 'path'
+void makeFile(const std::string &path, const std::string &contents) {
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+}
+
+go_bandit([]() {
+
+  describe("readFile", [&]() {
+
+    it("1.0 - Reads the same as loading the file into a string", [&]() {
+      std::ifstream file("sample.json");
+      std::string json(std::istreambuf_iterator<char>(file.rdbuf()),
+                       std::istreambuf_iterator<char>());
+      JSON loaded = readValue(json.begin(), json.end());
+      JSON mapped = readFile("sample.json");
+      AssertThat(mapped.toString(), Equals(loaded.toString()));
+      std::string id = mapped["access"]["token"]["id"];
+      AssertThat(id, Equals("930fa23xxxxxxxxxxd711582ac0df492"));
+    });
+
+    it("1.1 - Maps the whole file", [&]() {
+      makeFile("mapped_file_test.json", "[1, 2, 3]");
+      MappedFile file("mapped_file_test.json");
+      AssertThat(std::string(file.begin(), file.end()), Equals("[1, 2, 3]"));
+      MappedFile moved(std::move(file));
+      AssertThat(moved.size(), Equals(9u));
+      AssertThat(file.size(), Equals(0u));
+      std::remove("mapped_file_test.json");
+    });
+
+    it("1.2 - Copes with empty files", [&]() {
+      makeFile("mapped_file_test.json", "");
+      MappedFile file("mapped_file_test.json");
+      AssertThat(file.size(), Equals(0u));
+      AssertThat(file.begin() == file.end(), Equals(true));
+      AssertThrows(ParserError, readFile("mapped_file_test.json"));
+      std::remove("mapped_file_test.json");
+    });
+
+    it("1.3 - Throws a system_error for missing files", [&]() {
+      AssertThrows(std::system_error, readFile("no such file.json"));
+      AssertThat(std::string(LastException<std::system_error>().what())
+                         .find("no such file.json") != std::string::npos,
+                 Equals(true));
+    });
+
+    it("1.4 - Reports parse errors", [&]() {
+      makeFile("mapped_file_test.json", R"({"a": [1, 2})");
+      AssertThrows(ParserError, readFile("mapped_file_test.json"));
+      std::remove("mapped_file_test.json");
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
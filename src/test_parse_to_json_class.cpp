@@ -46,6 +46,153 @@ go_bandit([]() {
       AssertThat(content_type,
                  snowhouse::Equals("application/x-www-form-urlencoded"));
     });
+    it("1.2 - Can read a complex object into an arena", [&]() {
+      std::ifstream file("sample.json");
+      std::string json(std::istreambuf_iterator<char>(file.rdbuf()),
+                       std::istreambuf_iterator<char>());
+      ArenaJSON result = readArenaValue(json.cbegin(), json.cend());
+      auto &token = result.root().at("access")["token"];
+      std::string id = token.at("id");
+      AssertThat(id, snowhouse::Equals("930fa23xxxxxxxxxxd711582ac0df492"));
+      // Everything is in the arena, and the arena only needed a few blocks
+      AssertThat(result.arena().bytesAllocated() > json.size(),
+                 snowhouse::Equals(true));
+      AssertThat(result.arena().blockCount() < 10, snowhouse::Equals(true));
+      // The tree can be copied out into a normal JSON
+      std::stringstream arenaText, jsonText;
+      arenaText << result.root();
+      jsonText << readValue(json.cbegin(), json.cend());
+      AssertThat(arenaText.str(), snowhouse::Equals(jsonText.str()));
+    });
+    it("1.3 - Keeps 64 bit integers exactly", [&]() {
+      std::string json =
+          R"([9007199254740993,-9223372036854775808,18446744073709551615,1.5])";
+      JSON result = readValue(json.cbegin(), json.cend());
+      AssertThat(result[0].isInteger(), snowhouse::Equals(true));
+      AssertThat(static_cast<int64_t>(result[0]),
+                 snowhouse::Equals(int64_t(9007199254740993)));
+      AssertThat(static_cast<int64_t>(result[1]),
+                 snowhouse::Equals(std::numeric_limits<int64_t>::min()));
+      AssertThat(static_cast<uint64_t>(result[2]),
+                 snowhouse::Equals(std::numeric_limits<uint64_t>::max()));
+      AssertThat(result[3].isInteger(), snowhouse::Equals(false));
+      AssertThat(result.toString(), snowhouse::Equals(json));
+    });
+    it("1.4 - Returns errors from tryReadValue", [&]() {
+      std::string json = R"({"a": [1, 2], "b": nul})";
+      auto result = tryReadValue(json.cbegin(), json.cend());
+      AssertThat(result.ok(), snowhouse::Equals(false));
+      AssertThat(result.error == ErrorCode::badLiteral,
+                 snowhouse::Equals(true));
+      AssertThat(result.offset, snowhouse::Equals(22u));
+      AssertThat(result.value.isNull(), snowhouse::Equals(true));
+      json = R"({"a": [1, 2], "b": null})";
+      result = tryReadValue(json.cbegin(), json.cend());
+      AssertThat(result.ok(), snowhouse::Equals(true));
+      AssertThat(result.value.toString(),
+                 snowhouse::Equals(readValue(json.cbegin(), json.cend()).toString()));
+    });
+    it("1.5 - Reads utf-16 and utf-32 in either byte order", [&]() {
+      std::ifstream file("sample.json");
+      std::string json(std::istreambuf_iterator<char>(file.rdbuf()),
+                       std::istreambuf_iterator<char>());
+      json.insert(json.find("930fa23"), u8"\u00e9\U0001F600 ");
+      const std::string expected = readValue(json.cbegin(), json.cend()).toString();
+      const char *p = json.data();
+      std::u16string utf16(wideSize<char16_t>(p, p + json.size()), u'\0');
+      utf8ToWide(p, p + json.size(), &utf16[0]);
+      std::u32string utf32(wideSize<char32_t>(p, p + json.size()), U'\0');
+      utf8ToWide(p, p + json.size(), &utf32[0]);
+      // Native units
+      AssertThat(readValue(utf16.data(), utf16.data() + utf16.size()).toString(),
+                 snowhouse::Equals(expected));
+      AssertThat(readValue(utf32.data(), utf32.data() + utf32.size()).toString(),
+                 snowhouse::Equals(expected));
+      // Bytes, as they'd come from a file or socket, with and without a byte
+      // order mark
+      for (int swapped = 0; swapped != 2; ++swapped) {
+        for (const std::u16string &units : {utf16, u"\uFEFF" + utf16}) {
+          std::string bytes;
+          for (char16_t unit : units) {
+            bytes += static_cast<char>(swapped ? unit >> 8 : unit & 0xFF);
+            bytes += static_cast<char>(swapped ? unit & 0xFF : unit >> 8);
+          }
+          AssertThat(readValue(bytes.cbegin(), bytes.cend()).toString(),
+                     snowhouse::Equals(expected));
+        }
+        std::string bytes;
+        for (char32_t unit : utf32)
+          for (int i = 0; i != 4; ++i)
+            bytes += static_cast<char>(unit >> (8 * (swapped ? 3 - i : i)));
+        AssertThat(readValue(bytes.cbegin(), bytes.cend()).toString(),
+                   snowhouse::Equals(expected));
+      }
+      // utf-8 can have a byte order mark too
+      const std::string marked = "\xEF\xBB\xBF" + json;
+      AssertThat(readValue(marked.cbegin(), marked.cend()).toString(),
+                 snowhouse::Equals(expected));
+      AssertThat(readValue(std::u16string(u"7")).toString(),
+                 snowhouse::Equals("7"));
+    });
+
+    it("1.6 - Says where errors are in wide input", [&]() {
+      std::u16string json = u"{\"a\": [1, 2], \"\U0001F600\": nul}";
+      const char16_t *where = nullptr;
+      ErrorThrower<const char16_t *> onError =
+          [&](std::string, const char16_t *at) {
+            where = at;
+            throw std::runtime_error("stop");
+          };
+      AssertThrows(std::runtime_error,
+                   readValue(json.data(), json.data() + json.size(), onError));
+      AssertThat(where - json.data(), snowhouse::Equals(23));
+      AssertThrows(ParserError,
+                   readValue(json.data(), json.data() + json.size() - 5));
+      // Long enough that the error's well past the first block
+      std::u16string big = u"[";
+      for (int i = 0; i < 10000; ++i)
+        big += u"\"\u65e5\U0001F600\", ";
+      const size_t bad = big.size();
+      big += u"x]";
+      std::string bytes(reinterpret_cast<const char *>(big.data()),
+                        big.size() * 2);
+      const char *at = nullptr;
+      ErrorThrower<std::string::const_iterator> onBytes =
+          [&](std::string, std::string::const_iterator p) {
+            at = &*p;
+            throw std::runtime_error("stop");
+          };
+      AssertThrows(std::runtime_error,
+                   readValue(bytes.cbegin(), bytes.cend(), onBytes));
+      AssertThat(size_t(at - bytes.data()), snowhouse::Equals(bad * 2));
+    });
+
+    it("1.7 - Stops after the first value in wide input too", [&]() {
+      std::string longer = "[";
+      for (int i = 0; i < 20000; ++i)
+        longer += "1, ";
+      longer += "2] x";
+      for (const std::string &json :
+           {std::string("[1] x"), std::string("{\"a\": 1}}"),
+            std::string("\"s\" 2"), std::string("7 x"),
+            std::string("[1][2"), std::string("null,"), longer}) {
+        const std::string expected =
+            readValue(json.cbegin(), json.cend()).toString();
+        const char *p = json.data();
+        std::u16string utf16(wideSize<char16_t>(p, p + json.size()), u'\0');
+        utf8ToWide(p, p + json.size(), &utf16[0]);
+        AssertThat(
+            readValue(utf16.data(), utf16.data() + utf16.size()).toString(),
+            snowhouse::Equals(expected));
+        std::string bytes;
+        for (char16_t unit : utf16) {
+          bytes += static_cast<char>(unit & 0xFF);
+          bytes += static_cast<char>(unit >> 8);
+        }
+        AssertThat(readValue(bytes.cbegin(), bytes.cend()).toString(),
+                   snowhouse::Equals(expected));
+      }
+    });
   });
 
 });
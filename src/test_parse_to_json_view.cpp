@@ -0,0 +1,87 @@
+//// Tests that we can read JSON into borrowed json::JDocuments
+#include <bandit/bandit.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "parse_to_json_view.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+/// Returns true if 's' points into 'text'
+bool pointsInto(StringView s, const std::string &text) {
+  return (s.begin() >= text.data()) &&
+         (s.end() <= text.data() + text.size());
+}
+
+go_bandit([]() {
+
+  describe("parse to json view", [&]() {
+
+    it("1.0 - Can read a complex object without copying strings", [&]() {
+      std::ifstream file("sample.json");
+      std::string json(std::istreambuf_iterator<char>(file.rdbuf()),
+                       std::istreambuf_iterator<char>());
+      JDocument doc = readDocument(json);
+      const JView &token = doc.root().at("access")["token"];
+      StringView id = token.at("id").str();
+      AssertThat(std::string(id),
+                 Equals("930fa23xxxxxxxxxxd711582ac0df492"));
+      AssertThat(pointsInto(id, json), Equals(true));
+      // Nothing in sample.json is escaped, so the arena only holds the lists
+      // and maps
+      const JView &roles = doc.root()["access"]["user"]["roles"];
+      AssertThat(roles.whatIs(), Equals(JView::list));
+      AssertThat(roles.size(), Equals(4u));
+      AssertThat(std::string(roles[3]["name"]), Equals("checkmate"));
+    });
+
+    it("1.1 - Decodes escaped strings into the arena", [&]() {
+      std::string json = R"({"plain": "abc", "esc\"aped": "x\nyé"})";
+      JDocument doc = readDocument(json);
+      const JView &root = doc.root();
+      AssertThat(root.size(), Equals(2u));
+      AssertThat(pointsInto(root["plain"].str(), json), Equals(true));
+      const JViewMember &escaped = root.members().begin()[1];
+      AssertThat(std::string(escaped.key), Equals("esc\"aped"));
+      AssertThat(pointsInto(escaped.key, json), Equals(false));
+      AssertThat(std::string(escaped.value), Equals(u8"x\nyé"));
+      AssertThat(pointsInto(escaped.value.str(), json), Equals(false));
+    });
+
+    it("1.2 - Can read every type", [&]() {
+      std::string json = R"([null, true, false, 1.5, "", [], {}, [[1]]])";
+      JDocument doc = readDocument(json);
+      const JView &root = doc.root();
+      AssertThat(root.size(), Equals(8u));
+      AssertThat(root[0].isNull(), Equals(true));
+      AssertThat((bool)root[1], Equals(true));
+      AssertThat((bool)root[2], Equals(false));
+      AssertThat(static_cast<double>(root[3]), Equals(1.5));
+      AssertThat(root[4].str().size(), Equals(0u));
+      AssertThat(root[5].items().empty(), Equals(true));
+      AssertThat(root[6].members().empty(), Equals(true));
+      AssertThat(static_cast<int>(root[7][0][0]), Equals(1));
+    });
+
+    it("1.3 - Throws when a key or index doesn't exist", [&]() {
+      std::string json = R"({"a": [1]})";
+      JDocument doc = readDocument(json);
+      AssertThrows(std::out_of_range, doc.root().at("b"));
+      AssertThrows(std::out_of_range, doc.root().at("a").at(1));
+      AssertThat(doc.root().find("b"), Equals(doc.root().members().end()));
+    });
+
+    it("1.4 - Reports parse errors", [&]() {
+      std::string json = R"({"a": [1, }})";
+      AssertThrows(ParserError, readDocument(json));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -0,0 +1,215 @@
+/// Tests that we can read JSON straight into hana structs
+#include <bandit/bandit.h>
+
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "parse_to_struct.hpp"
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+struct Tenant {
+  BOOST_HANA_DEFINE_STRUCT(Tenant,
+    (std::string, name),
+    (std::string, id));
+};
+
+struct AuthToken {
+  BOOST_HANA_DEFINE_STRUCT(AuthToken,
+    (std::vector<std::string>, authenticatedBy),
+    (Tenant, tenant),
+    (std::string, expires),
+    (std::string, id));
+};
+
+struct Role {
+  BOOST_HANA_DEFINE_STRUCT(Role,
+    (std::string, name),
+    (std::string, id),
+    (std::string, tenantId));
+};
+
+struct User {
+  BOOST_HANA_DEFINE_STRUCT(User,
+    (std::string, name),
+    (std::vector<Role>, roles),
+    (std::string, id));
+};
+
+struct Access {
+  BOOST_HANA_DEFINE_STRUCT(Access,
+    (AuthToken, token),
+    (User, user));
+};
+
+struct Sample {
+  BOOST_HANA_DEFINE_STRUCT(Sample,
+    (Access, access));
+};
+
+struct Mixed {
+  BOOST_HANA_DEFINE_STRUCT(Mixed,
+    (bool, on),
+    (int, count),
+    (double, ratio),
+    (unsigned long long, big),
+    (std::string, text),
+    (std::vector<std::vector<int>>, grid),
+    (std::map<std::string, int>, counts),
+    (JSON, extra));
+};
+
+/// Lots of keys, to give the perfect hash something to do
+struct Wide {
+  BOOST_HANA_DEFINE_STRUCT(Wide,
+    (int, a), (int, b), (int, c), (int, d), (int, e), (int, f), (int, g),
+    (int, h), (int, i), (int, j), (int, k), (int, l), (int, m), (int, n),
+    (int, ab), (int, ba), (int, abc), (int, cba), (int, x1), (int, x2));
+};
+
+go_bandit([]() {
+
+  describe("parse to struct", [&]() {
+
+    it("1.0 - Reads the parts of sample.json that it's asked for", [&]() {
+      std::ifstream file("sample.json");
+      std::string json(std::istreambuf_iterator<char>(file.rdbuf()),
+                       std::istreambuf_iterator<char>());
+      Sample sample = readStruct<Sample>(json.data(), json.data() + json.size());
+      const AuthToken &token = sample.access.token;
+      AssertThat(token.id, Equals("930fa23xxxxxxxxxxd711582ac0df492"));
+      AssertThat(token.expires, Equals("2014-12-07T12:06:05.368Z"));
+      AssertThat(token.tenant.name, Equals("641237"));
+      // Its json key is "RAX-AUTH:authenticatedBy", so it's not filled in
+      AssertThat(token.authenticatedBy.empty(), Equals(true));
+      const User &user = sample.access.user;
+      AssertThat(user.name, Equals("matiuxs"));
+      AssertThat(user.id, Equals("158405"));
+      AssertThat(user.roles.size(), Equals(4u));
+      AssertThat(user.roles[0].tenantId,
+                 Equals("MossoCloudFS_b3ce8b22-f8af-4540-8d88-7fb3c604d238"));
+      AssertThat(user.roles[3].name, Equals("checkmate"));
+      AssertThat(user.roles[3].tenantId, Equals(""));
+    });
+
+    it("1.1 - Reads every kind of member", [&]() {
+      std::string json = R"({
+        "on": true, "count": -12, "ratio": 0.25, "big": 18446744073709551615,
+        "text": "a\nb", "grid": [[1, 2], [], [3]],
+        "counts": {"x": 1, "y": 2}, "extra": {"any": ["thing", null]},
+        "ignored": {"deep": [1, {"count": 99}]}
+      })";
+      Mixed mixed = readStruct<Mixed>(json.begin(), json.end());
+      AssertThat(mixed.on, Equals(true));
+      AssertThat(mixed.count, Equals(-12));
+      AssertThat(mixed.ratio, Equals(0.25));
+      AssertThat(mixed.big, Equals(18446744073709551615ull));
+      AssertThat(mixed.text, Equals("a\nb"));
+      AssertThat(mixed.grid,
+                 Equals(std::vector<std::vector<int>>{{1, 2}, {}, {3}}));
+      AssertThat(mixed.counts,
+                 Equals(std::map<std::string, int>{{"x", 1}, {"y", 2}}));
+      AssertThat(std::string(mixed.extra["any"][0]), Equals("thing"));
+    });
+
+    it("1.2 - Leaves out members that are missing or null", [&]() {
+      std::string json = R"({"count": null, "text": "t"})";
+      Mixed mixed;
+      mixed.count = 7;
+      auto status = make_status(json.cbegin(), json.cend());
+      readInto(status, mixed);
+      AssertThat(mixed.count, Equals(7));
+      AssertThat(mixed.text, Equals("t"));
+      AssertThat(status.p == status.pe, Equals(true));
+    });
+
+    it("1.3 - Finds every key and nothing else", [&]() {
+      std::string json = R"({"a": 1, "b": 2, "n": 14, "ab": 15, "ba": 16,
+        "abc": 17, "cba": 18, "x1": 19, "x2": 20, "x3": 21, "": 22,
+        "aa": 23, "abcd": 24})";
+      Wide wide{};
+      auto status = make_status(json.cbegin(), json.cend());
+      readInto(status, wide);
+      AssertThat(wide.a, Equals(1));
+      AssertThat(wide.b, Equals(2));
+      AssertThat(wide.c, Equals(0));
+      AssertThat(wide.n, Equals(14));
+      AssertThat(wide.ab + wide.ba + wide.abc + wide.cba,
+                 Equals(15 + 16 + 17 + 18));
+      AssertThat(wide.x1 + wide.x2, Equals(19 + 20));
+      const auto &keys = detail::StructInfo<Wide>::keys;
+      AssertThat(keys.find("abcd", 4), Equals(-1));
+      AssertThat(keys.find("x2", 2), Equals(19));
+    });
+
+    it("1.4 - Complains about values of the wrong type", [&]() {
+      std::string json = R"({"count": "12"})";
+      AssertThrows(ParserError, readStruct<Mixed>(json.begin(), json.end()));
+      AssertThat(LastException<ParserError>().what(),
+                 Equals(std::string("Expected '0' but got '\"' instead")));
+    });
+
+    it("1.5 - Reads from forward iterators", [&]() {
+      std::string text = R"({"name": "n", "roles": [{"id": "1"}], "id": "2"})";
+      std::list<char> json(text.begin(), text.end());
+      User user = readStruct<User>(json.begin(), json.end());
+      AssertThat(user.name, Equals("n"));
+      AssertThat(user.roles.size(), Equals(1u));
+      AssertThat(user.roles[0].id, Equals("1"));
+      AssertThat(user.id, Equals("2"));
+    });
+
+    it("1.6 - Returns errors from tryReadStruct", [&]() {
+      std::string json = R"({"name": "n", "id": 2})";
+      auto result = tryReadStruct<User>(json.cbegin(), json.cend());
+      AssertThat(result.ok(), Equals(false));
+      AssertThat(result.error == ErrorCode::unexpectedToken, Equals(true));
+      AssertThat(result.offset, Equals(20u));
+      AssertThat(result.value.name, Equals("n"));
+      json = R"({"name": "n", "id": "2"})";
+      result = tryReadStruct<User>(json.cbegin(), json.cend());
+      AssertThat(result.ok(), Equals(true));
+      AssertThat(result.value.id, Equals("2"));
+    });
+
+    it("1.7 - Reads arrays of bools", [&]() {
+      std::string json = R"([true, null, false, true])";
+      std::vector<bool> flags{false};
+      auto status = make_status(json.cbegin(), json.cend());
+      readInto(status, flags);
+      AssertThat(flags, Equals(std::vector<bool>{true, false, false, true}));
+    });
+
+    it("1.8 - Complains about numbers that don't fit", [&]() {
+      for (std::string json : {R"({"count": 3000000000})",
+                               R"({"count": -2147483649})",
+                               R"({"count": 1e10})",
+                               R"({"big": -1})",
+                               R"({"big": 1e20})"}) {
+        auto result = tryReadStruct<Mixed>(json.cbegin(), json.cend());
+        AssertThat(result.error == ErrorCode::badNumber, Equals(true));
+      }
+      std::string json = R"({"count": -2147483648, "big": 1.8e19})";
+      Mixed mixed = readStruct<Mixed>(json.begin(), json.end());
+      AssertThat(mixed.count, Equals(-2147483647 - 1));
+      AssertThat(mixed.big, Equals(18000000000000000000ull));
+      std::vector<unsigned char> bytes;
+      json = "[0, 255, 256]";
+      auto status = make_status(json.cbegin(), json.cend());
+      AssertThrows(ParserError, readInto(status, bytes));
+      AssertThat(bytes, Equals(std::vector<unsigned char>{0, 255}));
+      float f = 0;
+      json = "1e39";
+      auto floatStatus = make_status(json.cbegin(), json.cend());
+      AssertThrows(ParserError, readInto(floatStatus, f));
+    });
+  });
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
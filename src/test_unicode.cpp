@@ -1,7 +1,9 @@
 /// Tests the conversion of unicode
 
 #include <bandit/bandit.h>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "unicode.hpp"
 
@@ -164,6 +166,125 @@ go_bandit([]() {
 
   });
 
+  describe("utf-16 Writer", [&]() {
+
+    it("4.0 Can write a char from the first plane", [&]() {
+      std::u32string input = U"�";
+      std::u16string output;
+      AssertThat(to16(input.cbegin(), std::back_inserter(output)), Equals(1));
+      AssertThat(output, Equals(std::u16string(u"�")));
+    });
+
+    it("4.1 Can write a surrogate pair", [&]() {
+      std::u32string input = U"\U0001F600";
+      std::u16string output;
+      AssertThat(to16(input.cbegin(), std::back_inserter(output)), Equals(2));
+      AssertThat(output, Equals(std::u16string(u"\U0001F600")));
+      AssertThat(getNumChars<char16_t>(0x1F600), Equals(2));
+    });
+
+  });
+
+  describe("Bulk conversion", [&]() {
+
+    // Every length of utf-8 char, with ASCII runs long enough for the vector
+    // copies in between
+    std::string text = u8"The quick brown fox jumps over the lazy dog. "
+                       u8"caf\u00e9 \u00fc\u00df \u65e5\u672c\u8a9e "
+                       u8"\U0001F600\U0001F680 \u16A0\u16C7";
+    for (int i = 0; i < 3; ++i)
+      text += text;
+
+    it("5.0 Finds the same bad utf-8 with every instruction set", [&]() {
+      const std::string alphabet = "ax\x7f\x80\x8f\x90\xa0\xbf\xc0\xc2\xdf"
+                                   "\xe0\xed\xef\xf0\xf4\xf5\xff";
+      std::mt19937 random(5);
+      std::uniform_int_distribution<size_t> pick(0, 60);
+      std::uniform_int_distribution<size_t> length(0, 150);
+      for (int set = simd::scalar; set <= simd::instructionSet(); ++set) {
+        auto finder =
+            detail::badUTF8FinderFor(static_cast<simd::InstructionSet>(set));
+        AssertThat(finder(text.data(), text.data() + text.size()),
+                   Equals(text.data() + text.size()));
+        for (int n = 0; n < 3000; ++n) {
+          // Mostly good text, with a few random bytes dropped in
+          std::string input = text.substr(random() % 64, length(random));
+          for (char &c : input) {
+            size_t i = pick(random);
+            if (i < alphabet.size())
+              c = alphabet[i];
+          }
+          const char *p = input.data();
+          const char *pe = p + input.size();
+          AssertThat(finder(p, pe), Equals(detail::findBadUTF8Scalar(p, pe)));
+        }
+      }
+    });
+
+    it("5.1 Converts to and from utf-16 and utf-32 with exact sizes", [&]() {
+      const char *p = text.data();
+      const char *pe = p + text.size();
+      std::u16string expected16;
+      std::u32string expected32;
+      transformFrom8(p, pe, std::back_inserter(expected32));
+      for (char32_t c : expected32)
+        to16(&c, std::back_inserter(expected16));
+      for (size_t start = 0; start < 70; start += 3) {
+        // Every alignment, and ends that don't fill a vector
+        const char *from = p + start;
+        while (detail::isContinuation(*from))
+          ++from;
+        std::u16string utf16(wideSize<char16_t>(from, pe), u'x');
+        AssertThat(utf8ToWide(from, pe, &utf16[0]), Equals(&utf16[0] + utf16.size()));
+        std::u32string utf32(wideSize<char32_t>(from, pe), U'x');
+        AssertThat(utf8ToWide(from, pe, &utf32[0]), Equals(&utf32[0] + utf32.size()));
+        AssertThat(utf16, Equals(expected16.substr(expected16.size() - utf16.size())));
+        AssertThat(utf32, Equals(expected32.substr(expected32.size() - utf32.size())));
+        std::string back(utf8Size(utf16.data(), utf16.data() + utf16.size()), 'x');
+        AssertThat(back.size(), Equals(size_t(pe - from)));
+        wideToUTF8(utf16.data(), utf16.data() + utf16.size(), &back[0]);
+        AssertThat(back, Equals(std::string(from, pe)));
+        std::fill(back.begin(), back.end(), 'x');
+        AssertThat(utf8Size(utf32.data(), utf32.data() + utf32.size()),
+                   Equals(back.size()));
+        wideToUTF8(utf32.data(), utf32.data() + utf32.size(), &back[0]);
+        AssertThat(back, Equals(std::string(from, pe)));
+      }
+      AssertThat(countUTF8(p, pe).chars, Equals(expected32.size()));
+    });
+
+    it("5.2 Writes U+FFFD for chars that have no utf-8", [&]() {
+      std::u16string lone = u"a";
+      lone += char16_t(0xD800);
+      lone += u"b";
+      lone += char16_t(0xDC00);
+      std::string out(utf8Size(lone.data(), lone.data() + lone.size()), 'x');
+      wideToUTF8(lone.data(), lone.data() + lone.size(), &out[0]);
+      AssertThat(out, Equals(u8"a\uFFFDb\uFFFD"));
+      std::u32string tooBig = {0x110000, 0xDFFF, 'c'};
+      out.assign(utf8Size(tooBig.data(), tooBig.data() + tooBig.size()), 'x');
+      wideToUTF8(tooBig.data(), tooBig.data() + tooBig.size(), &out[0]);
+      AssertThat(out, Equals(u8"\uFFFD\uFFFDc"));
+    });
+
+    it("5.3 Never writes more than it says for bad utf-8", [&]() {
+      std::mt19937 random(9);
+      for (int n = 0; n < 2000; ++n) {
+        std::string input(random() % 100, 'a');
+        for (char &c : input)
+          if (random() % 3 == 0)
+            c = static_cast<char>(0x80 + random() % 0x80);
+        const char *p = input.data();
+        const char *pe = p + input.size();
+        std::vector<char16_t> utf16(wideSize<char16_t>(p, pe));
+        AssertThat(utf8ToWide(p, pe, utf16.data()), Equals(utf16.data() + utf16.size()));
+        std::vector<char32_t> utf32(wideSize<char32_t>(p, pe));
+        AssertThat(utf8ToWide(p, pe, utf32.data()), Equals(utf32.data() + utf32.size()));
+      }
+    });
+
+  });
+
 });
 
 int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
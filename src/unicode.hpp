@@ -3,9 +3,12 @@
 #pragma once
 
 #include "utils.hpp"
+#include "parser/simd.hpp"
 
 #include <stdexcept>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 
@@ -31,7 +34,7 @@ template <typename T> int getNumChars(char32_t u) {
     return numBytes;
   }
   case 2:
-    return ((u <= 0xD7FF) || (u >= 0xE000)) ? 1 : 2;
+    return (u <= 0xFFFF) ? 1 : 2;
   case 4:
     return 1;
   };
@@ -43,17 +46,65 @@ struct UnicodeError : std::runtime_error {
 };
 
 /**
-* @brief Converts from utf-8 to utf-32; takes two iterators.
+* @brief Moves past one well formed utf-8 char
 *
-* @tparam In The input iterator type (should provide 8 bit chars).
-* @tparam Out The output iterator type (should write 32 bit chars).
-* @tparam InTraits The input iterator traits.
-* @param in The input iterator (should provide 8 bit chars)
-* @param out The output iterator (we write 32 bit chars)
+* Well formed means what RFC 3629 allows: the shortest encoding, no surrogates
+* and nothing past U+10FFFF.
+*
+* @param p The first byte of the char; left after its last byte, or on the
+*          first bad byte
+* @param pe The end of the input
+* @return false if the char was bad or cut off by the end of the input
 */
+template <typename Iterator>
+inline bool skipUTF8Char(Iterator &p, const Iterator &pe) {
+  const unsigned char lead = static_cast<unsigned char>(*p);
+  if (lead < 0x80) {
+    ++p;
+    return true;
+  }
+  // The range of the second byte depends on the first; the rest are all
+  // 0x80..0xBF
+  unsigned char low = 0x80, high = 0xBF;
+  int following;
+  if ((lead >= 0xC2) && (lead <= 0xDF))
+    following = 1;
+  else if ((lead >= 0xE0) && (lead <= 0xEF)) {
+    following = 2;
+    if (lead == 0xE0)
+      low = 0xA0; // Shorter encodings are over long
+    else if (lead == 0xED)
+      high = 0x9F; // Surrogates
+  } else if ((lead >= 0xF0) && (lead <= 0xF4)) {
+    following = 3;
+    if (lead == 0xF0)
+      low = 0x90;
+    else if (lead == 0xF4)
+      high = 0x8F; // Past U+10FFFF
+  } else
+    return false;
+  Iterator q = p;
+  ++q;
+  for (int i = 0; i < following; ++i, ++q) {
+    if (q == pe)
+      return false;
+    const unsigned char byte = static_cast<unsigned char>(*q);
+    if ((byte < low) || (byte > high))
+      return false;
+    low = 0x80;
+    high = 0xBF;
+  }
+  p = q;
+  return true;
+}
+
+namespace detail {
+
+/// Reads one utf-8 char from 'in' and writes it to 'out' as utf-32, moving
+/// both on
 template <typename In, typename Out,
           typename InTraits=std::iterator_traits<In>>
-inline void from8(In in, Out out) {
+inline void readUTF8(In &in, Out &out) {
   BOOST_HANA_CONSTANT_ASSERT(is_input_iterator(in));
   BOOST_HANA_CONSTANT_ASSERT(is_output_iterator(out));
   static_assert(sizeof(typename InTraits::value_type) == 1, "Expected the input to be 8 bits at a time");
@@ -86,7 +137,7 @@ inline void from8(In in, Out out) {
 
   // Simplest most common case - one byte encoding
   if ((byte & 0x80) == 0) {
-    *out = byte;
+    *(out++) = byte;
     return;
   }
 
@@ -141,6 +192,23 @@ inline void from8(In in, Out out) {
   *(out++) = result;
 }
 
+} // namespace detail
+
+/**
+* @brief Converts from utf-8 to utf-32; takes two iterators.
+*
+* @tparam In The input iterator type (should provide 8 bit chars).
+* @tparam Out The output iterator type (should write 32 bit chars).
+* @tparam InTraits The input iterator traits.
+* @param in The input iterator (should provide 8 bit chars)
+* @param out The output iterator (we write 32 bit chars)
+*/
+template <typename In, typename Out,
+          typename InTraits=std::iterator_traits<In>>
+inline void from8(In in, Out out) {
+  detail::readUTF8(in, out);
+}
+
 /**
 * @brief Converts from utf-16 to utf-32; takes two iterators.
 *
@@ -253,9 +321,9 @@ inline int to16(In in, Out out) {
   BOOST_HANA_CONSTANT_CHECK(is_input_iterator(in));
   static_assert(sizeof(decltype(*in)) == 4, "Expected the input to be 32 bits wide");
 
-  // Is this in one of the first plane ?
+  // Is this in the first plane ?
   int bytesWritten = 1;
-  if ((*in <= 0xD7FF) || (*in >= 0xE000)) {
+  if (*in <= 0xFFFF) {
     *out = static_cast<char16_t>(*in);
   } else {
     char32_t chr = *in - 0x10000;
@@ -283,8 +351,848 @@ inline void transform(In begin, In end, Out out, std::function<void(In, Out)> co
 template<typename In, typename Out>
 inline void transformFrom8(In begin, In end, Out out) {
   while (begin != end)
-    from8(begin, out);
+    detail::readUTF8(begin, out);
+}
+
+// Bulk conversions
+//
+// The functions above convert one char per call, through iterators. The ones
+// below work on whole contiguous buffers, a vector register at a time where
+// they can, with scalar, SSE4.2 and AVX2 versions that are picked between at
+// runtime like the scanners in parser/simd.hpp.
+//
+// To convert, ask how big the output will be (wideSize(), utf8Size()), make
+// the buffer exactly that big, then convert into it. 'Wide' means utf-16 for
+// 16 bit units and utf-32 for 32 bit ones, so wchar_t works on any platform.
+// The utf-8 readers want well formed input (check it with findBadUTF8()); on
+// bad input their output is rubbish, but never bigger than they said it would
+// be. Lone surrogates and values past U+10FFFF in wide input are written as
+// U+FFFD.
+
+/// How many chars some utf-8 holds, and how many of those are past U+FFFF
+struct UTF8Counts {
+  size_t chars;
+  size_t supplementary;
+};
+
+namespace detail {
+
+/// True for utf-8 continuation bytes: 10xxxxxx
+inline bool isContinuation(char byte) {
+  return (static_cast<unsigned char>(byte) & 0xC0) == 0x80;
+}
+
+inline const char *findBadUTF8Scalar(const char *p, const char *pe) {
+  while (p != pe) {
+    // Plain ASCII goes 8 bytes at a time
+    if (pe - p >= 8) {
+      uint64_t word;
+      std::memcpy(&word, p, 8);
+      if ((word & 0x8080808080808080ULL) == 0) {
+        p += 8;
+        continue;
+      }
+    }
+    if (!skipUTF8Char(p, pe))
+      return p;
+  }
+  return p;
+}
+
+inline UTF8Counts countUTF8Scalar(const char *p, const char *pe) {
+  UTF8Counts result{0, 0};
+  for (; p != pe; ++p) {
+    result.chars += !isContinuation(*p);
+    result.supplementary += static_cast<unsigned char>(*p) >= 0xF0;
+  }
+  return result;
+}
+
+/// Bytes of utf-8 needed for the utf-16 unit at 'p'; moves past it, and past
+/// the low surrogate after it if it's the start of a pair
+template <typename Unit>
+inline size_t utf8SizeOf16(const Unit *&p, const Unit *pe) {
+  const uint16_t unit = static_cast<uint16_t>(*p++);
+  if (unit < 0x80)
+    return 1;
+  if (unit < 0x800)
+    return 2;
+  if ((unit >= 0xD800) && (unit < 0xDC00) && (p != pe) &&
+      ((static_cast<uint16_t>(*p) & 0xFC00) == 0xDC00)) {
+    ++p;
+    return 4;
+  }
+  return 3; // Including lone surrogates, which become U+FFFD
+}
+
+/// Bytes of utf-8 needed for one utf-32 unit
+template <typename Unit> inline size_t utf8SizeOf32(Unit unit) {
+  const uint32_t u = static_cast<uint32_t>(unit);
+  if (u < 0x80)
+    return 1;
+  if (u < 0x800)
+    return 2;
+  if ((u >= 0x10000) && (u <= 0x10FFFF))
+    return 4;
+  return 3; // Including surrogates and too big values, which become U+FFFD
+}
+
+template <typename Unit>
+inline size_t utf8SizeFrom16Scalar(const Unit *p, const Unit *pe) {
+  size_t result = 0;
+  while (p != pe)
+    result += utf8SizeOf16(p, pe);
+  return result;
+}
+
+template <typename Unit>
+inline size_t utf8SizeFrom32Scalar(const Unit *p, const Unit *pe) {
+  size_t result = 0;
+  for (; p != pe; ++p)
+    result += utf8SizeOf32(*p);
+  return result;
+}
+
+/**
+ * @brief Reads one char of utf-8 and writes it as utf-16 or utf-32
+ *
+ * Every byte that isn't a continuation byte writes one unit (two for utf-16
+ * if it's a 4 byte lead), whether the input is well formed or not, so the
+ * output is never bigger than wideSize() said.
+ */
+template <typename Unit>
+inline void decodeUTF8(const char *&p, const char *pe, Unit *&out) {
+  const unsigned char lead = static_cast<unsigned char>(*p++);
+  if (lead < 0x80) {
+    *out++ = static_cast<Unit>(lead);
+    return;
+  }
+  if (lead < 0xC0)
+    return; // A stray continuation byte
+  int following = (lead < 0xE0) ? 1 : (lead < 0xF0) ? 2 : 3;
+  char32_t c = lead & (0x3F >> following);
+  for (; following && (p != pe) && isContinuation(*p); --following, ++p)
+    c = (c << 6) | (static_cast<unsigned char>(*p) & 0x3F);
+  if ((sizeof(Unit) == 2) && (lead >= 0xF0)) {
+    c -= 0x10000;
+    *out++ = static_cast<Unit>(0xD800 + ((c >> 10) & 0x3FF));
+    *out++ = static_cast<Unit>(0xDC00 + (c & 0x3FF));
+  } else
+    *out++ = static_cast<Unit>(c);
+}
+
+/// Writes one char as utf-8
+inline char *encodeUTF8(char32_t c, char *out) {
+  if (c < 0x80) {
+    *out++ = static_cast<char>(c);
+  } else if (c < 0x800) {
+    *out++ = static_cast<char>(0xC0 | (c >> 6));
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    *out++ = static_cast<char>(0xE0 | (c >> 12));
+    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xF0 | (c >> 18));
+    *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+  }
+  return out;
+}
+
+/// Writes the utf-16 char at 'p' as utf-8, moving past it
+template <typename Unit>
+inline char *encodeUTF16(const Unit *&p, const Unit *pe, char *out) {
+  char32_t c = static_cast<uint16_t>(*p++);
+  if ((c & 0xF800) == 0xD800) {
+    if ((c < 0xDC00) && (p != pe) &&
+        ((static_cast<uint16_t>(*p) & 0xFC00) == 0xDC00))
+      c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<uint16_t>(*p++) - 0xDC00);
+    else
+      c = 0xFFFD;
+  }
+  return encodeUTF8(c, out);
+}
+
+/// Writes one utf-32 char as utf-8
+template <typename Unit> inline char *encodeUTF32(Unit unit, char *out) {
+  char32_t c = static_cast<uint32_t>(unit);
+  if (((c & 0xFFFFF800) == 0xD800) || (c > 0x10FFFF))
+    c = 0xFFFD;
+  return encodeUTF8(c, out);
+}
+
+/// Converts utf-8 at the start of [p, pe) a block at a time, moving 'p' past
+/// what it read and returning one past the last unit written. It stops near
+/// the end, maybe in the middle of a char, and leaves the rest to decodeUTF8;
+/// the scalar version leaves it all.
+template <typename Unit>
+inline Unit *decodeUTF8Scalar(const char *&, const char *, Unit *out) {
+  return out;
+}
+
+/// The same the other way: copies leading ASCII wide chars to utf-8
+template <typename Unit>
+inline size_t narrowASCIIScalar(const Unit *, const Unit *, char *) {
+  return 0;
+}
+
+#ifdef JSON_SIMD_X86
+
+/// Where to go back to, a char at a time, after the vector check found a
+/// problem in the block starting at 'block': the first char that could reach
+/// into it
+inline const char *utf8Restart(const char *begin, const char *block) {
+  const char *p = (block - begin > 3) ? block - 3 : begin;
+  while ((p != block) && isContinuation(*p))
+    ++p;
+  return p;
+}
+
+// The tables for the Keiser-Lemire check ("Validating UTF-8 In Less Than One
+// Instruction Per Byte", 2021). Each byte is looked up by its high nibble,
+// and the byte before it by its high and low nibbles; the results are anded
+// together, and any bit that's left is an error. The bits are:
+//   0x01 too short: a lead byte or ASCII where a continuation should be
+//   0x02 too long: a continuation after ASCII
+//   0x04 overlong 3 byte char; 0x20 overlong 2 byte char
+//   0x08 past U+10FFFF; 0x10 surrogate
+//   0x40 overlong 4 byte char, or past U+10FFFF
+//   0x80 two continuations in a row (checked against the lead bytes further
+//        back)
+
+inline __m128i utf8Byte1HighTable() {
+  return _mm_setr_epi8(0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+                       char(0x80), char(0x80), char(0x80), char(0x80), 0x21,
+                       0x01, 0x15, 0x49);
+}
+
+inline __m128i utf8Byte1LowTable() {
+  return _mm_setr_epi8(char(0xE7), char(0xA3), char(0x83), char(0x83),
+                       char(0x8B), char(0xCB), char(0xCB), char(0xCB),
+                       char(0xCB), char(0xCB), char(0xCB), char(0xCB),
+                       char(0xCB), char(0xDB), char(0xCB), char(0xCB));
+}
+
+inline __m128i utf8Byte2HighTable() {
+  return _mm_setr_epi8(0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+                       char(0xE6), char(0xAE), char(0xBA), char(0xBA), 0x01,
+                       0x01, 0x01, 0x01);
+}
+
+/// The errors in 16 bytes of utf-8, given the 16 before them
+__attribute__((target("sse4.2"))) inline __m128i
+utf8ErrorsSSE42(__m128i input, __m128i previous) {
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+  const __m128i special = _mm_and_si128(
+      _mm_and_si128(
+          _mm_shuffle_epi8(utf8Byte1HighTable(),
+                           _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+          _mm_shuffle_epi8(utf8Byte1LowTable(), _mm_and_si128(prev1, nibble))),
+      _mm_shuffle_epi8(utf8Byte2HighTable(),
+                       _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+  // The second and third continuations of 3 and 4 byte chars are expected;
+  // any other continuation after a continuation is an error
+  const __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+  const __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+  const __m128i expected = _mm_or_si128(
+      _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80))),
+      _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80))));
+  return _mm_xor_si128(_mm_and_si128(expected, _mm_set1_epi8(char(0x80))),
+                       special);
+}
+
+/// Checks utf-8 16 bytes at a time
+__attribute__((target("sse4.2"))) inline const char *
+findBadUTF8SSE42(const char *p, const char *pe) {
+  const char *begin = p;
+  __m128i previous = _mm_setzero_si128();
+  bool previousASCII = true;
+  for (; pe - p >= 16; p += 16) {
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const bool ascii = _mm_movemask_epi8(input) == 0;
+    if (!ascii || !previousASCII) {
+      const __m128i errors = utf8ErrorsSSE42(input, previous);
+      if (!_mm_testz_si128(errors, errors))
+        return findBadUTF8Scalar(utf8Restart(begin, p), pe);
+    }
+    previous = input;
+    previousASCII = ascii;
+  }
+  // The rest, padded with zeros. Those are ASCII, so a char cut off by the
+  // end of the input shows up as too short.
+  char tail[16] = {};
+  if (p != pe)
+    std::memcpy(tail, p, pe - p);
+  const __m128i errors = utf8ErrorsSSE42(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail)), previous);
+  if (!_mm_testz_si128(errors, errors))
+    return findBadUTF8Scalar(utf8Restart(begin, p), pe);
+  return pe;
+}
+
+/// The 32 bytes before each byte of 'input', shifted by 'n' bytes
+template <int n>
+__attribute__((target("avx2"))) inline __m256i avx2Before(__m256i input,
+                                                          __m256i previous) {
+  return _mm256_alignr_epi8(
+      input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - n);
+}
+
+/// The errors in 32 bytes of utf-8, given the 32 before them
+__attribute__((target("avx2"))) inline __m256i
+utf8ErrorsAVX2(__m256i input, __m256i previous) {
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i prev1 = avx2Before<1>(input, previous);
+  const __m256i special = _mm256_and_si256(
+      _mm256_and_si256(
+          _mm256_shuffle_epi8(
+              _mm256_broadcastsi128_si256(utf8Byte1HighTable()),
+              _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+          _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(utf8Byte1LowTable()),
+                              _mm256_and_si256(prev1, nibble))),
+      _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(utf8Byte2HighTable()),
+                          _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+  const __m256i expected = _mm256_or_si256(
+      _mm256_subs_epu8(avx2Before<2>(input, previous),
+                       _mm256_set1_epi8(char(0xE0 - 0x80))),
+      _mm256_subs_epu8(avx2Before<3>(input, previous),
+                       _mm256_set1_epi8(char(0xF0 - 0x80))));
+  return _mm256_xor_si256(
+      _mm256_and_si256(expected, _mm256_set1_epi8(char(0x80))), special);
+}
+
+/// Checks utf-8 32 bytes at a time
+__attribute__((target("avx2"))) inline const char *
+findBadUTF8AVX2(const char *p, const char *pe) {
+  const char *begin = p;
+  __m256i previous = _mm256_setzero_si256();
+  bool previousASCII = true;
+  for (; pe - p >= 32; p += 32) {
+    const __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    const bool ascii = _mm256_movemask_epi8(input) == 0;
+    if (!ascii || !previousASCII) {
+      const __m256i errors = utf8ErrorsAVX2(input, previous);
+      if (!_mm256_testz_si256(errors, errors))
+        return findBadUTF8Scalar(utf8Restart(begin, p), pe);
+    }
+    previous = input;
+    previousASCII = ascii;
+  }
+  char tail[32] = {};
+  if (p != pe)
+    std::memcpy(tail, p, pe - p);
+  const __m256i errors = utf8ErrorsAVX2(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail)), previous);
+  if (!_mm256_testz_si256(errors, errors))
+    return findBadUTF8Scalar(utf8Restart(begin, p), pe);
+  return pe;
+}
+
+/// Counts utf-8 chars 16 bytes at a time
+__attribute__((target("sse4.2"))) inline UTF8Counts
+countUTF8SSE42(const char *p, const char *pe) {
+  UTF8Counts result{0, 0};
+  for (; pe - p >= 16; p += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    // 0x80..0xBF are the only bytes below 0xC0 when read as signed
+    const __m128i continuation = _mm_cmplt_epi8(chunk, _mm_set1_epi8(char(0xC0)));
+    const __m128i fourByte = _mm_cmpeq_epi8(
+        _mm_max_epu8(chunk, _mm_set1_epi8(char(0xF0))), chunk);
+    result.chars += 16 - simd::popCount(_mm_movemask_epi8(continuation));
+    result.supplementary += simd::popCount(_mm_movemask_epi8(fourByte));
+  }
+  const UTF8Counts rest = countUTF8Scalar(p, pe);
+  result.chars += rest.chars;
+  result.supplementary += rest.supplementary;
+  return result;
+}
+
+/// Counts utf-8 chars 32 bytes at a time
+__attribute__((target("avx2"))) inline UTF8Counts
+countUTF8AVX2(const char *p, const char *pe) {
+  UTF8Counts result{0, 0};
+  for (; pe - p >= 32; p += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    const __m256i continuation =
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(char(0xC0)), chunk);
+    const __m256i fourByte = _mm256_cmpeq_epi8(
+        _mm256_max_epu8(chunk, _mm256_set1_epi8(char(0xF0))), chunk);
+    result.chars += 32 - simd::popCount(simd::avx2Bits(continuation));
+    result.supplementary += simd::popCount(simd::avx2Bits(fourByte));
+  }
+  const UTF8Counts rest = countUTF8SSE42(p, pe);
+  result.chars += rest.chars;
+  result.supplementary += rest.supplementary;
+  return result;
+}
+
+/// Sizes utf-16 as utf-8, 8 units at a time while there are no surrogates
+template <typename Unit>
+__attribute__((target("sse4.2"))) inline size_t
+utf8SizeFrom16SSE42(const Unit *p, const Unit *pe) {
+  size_t result = 0;
+  while (pe - p >= 8) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i surrogates =
+        _mm_cmpeq_epi16(_mm_and_si128(chunk, _mm_set1_epi16(short(0xF800))),
+                        _mm_set1_epi16(short(0xD800)));
+    if (_mm_movemask_epi8(surrogates)) {
+      for (const Unit *end = p + 8; p < end;)
+        result += utf8SizeOf16(p, pe);
+      continue;
+    }
+    // Each unit sets two bits of the movemask
+    const __m128i twoBytes =
+        _mm_cmpeq_epi16(_mm_max_epu16(chunk, _mm_set1_epi16(0x80)), chunk);
+    const __m128i threeBytes =
+        _mm_cmpeq_epi16(_mm_max_epu16(chunk, _mm_set1_epi16(0x800)), chunk);
+    result += 8 + (simd::popCount(_mm_movemask_epi8(twoBytes)) +
+                   simd::popCount(_mm_movemask_epi8(threeBytes))) / 2;
+    p += 8;
+  }
+  return result + utf8SizeFrom16Scalar(p, pe);
+}
+
+/// Sizes utf-32 as utf-8, 4 units at a time while they're all below the
+/// surrogates
+template <typename Unit>
+__attribute__((target("sse4.2"))) inline size_t
+utf8SizeFrom32SSE42(const Unit *p, const Unit *pe) {
+  size_t result = 0;
+  for (; pe - p >= 4; p += 4) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i low =
+        _mm_cmpeq_epi32(_mm_max_epu32(chunk, _mm_set1_epi32(0xD7FF)),
+                        _mm_set1_epi32(0xD7FF));
+    if (_mm_movemask_epi8(low) != 0xFFFF) {
+      result += utf8SizeFrom32Scalar(p, p + 4);
+      continue;
+    }
+    const __m128i twoBytes =
+        _mm_cmpeq_epi32(_mm_max_epu32(chunk, _mm_set1_epi32(0x80)), chunk);
+    const __m128i threeBytes =
+        _mm_cmpeq_epi32(_mm_max_epu32(chunk, _mm_set1_epi32(0x800)), chunk);
+    result += 4 + simd::popCount(_mm_movemask_ps(_mm_castsi128_ps(twoBytes))) +
+              simd::popCount(_mm_movemask_ps(_mm_castsi128_ps(threeBytes)));
+  }
+  return result + utf8SizeFrom32Scalar(p, pe);
+}
+
+/// Writes 16 ASCII chars as 16 or 32 bit units
+template <typename Unit>
+__attribute__((target("sse4.2"))) inline void widenASCIISSE42(__m128i chunk,
+                                                              Unit *out) {
+  __m128i *to = reinterpret_cast<__m128i *>(out);
+  if (sizeof(Unit) == 2) {
+    _mm_storeu_si128(to, _mm_cvtepu8_epi16(chunk));
+    _mm_storeu_si128(to + 1, _mm_cvtepu8_epi16(_mm_srli_si128(chunk, 8)));
+  } else {
+    _mm_storeu_si128(to, _mm_cvtepu8_epi32(chunk));
+    _mm_storeu_si128(to + 1, _mm_cvtepu8_epi32(_mm_srli_si128(chunk, 4)));
+    _mm_storeu_si128(to + 2, _mm_cvtepu8_epi32(_mm_srli_si128(chunk, 8)));
+    _mm_storeu_si128(to + 3, _mm_cvtepu8_epi32(_mm_srli_si128(chunk, 12)));
+  }
+}
+
+/// For each way the chars can start in 8 bytes (a bit per byte), the shuffle
+/// that packs the 16 bit values decoded at those bytes together
+struct UTF8PackTable {
+  alignas(16) uint8_t shuffle[256][16];
+  UTF8PackTable() {
+    for (int starts = 0; starts != 256; ++starts) {
+      int out = 0;
+      for (int i = 0; i != 8; ++i) {
+        if (starts & (1 << i)) {
+          shuffle[starts][out++] = static_cast<uint8_t>(2 * i);
+          shuffle[starts][out++] = static_cast<uint8_t>(2 * i + 1);
+        }
+      }
+      while (out != 16)
+        shuffle[starts][out++] = 0x80;
+    }
+  }
+};
+
+inline const UTF8PackTable &utf8PackTable() {
+  static const UTF8PackTable table;
+  return table;
+}
+
+/**
+ * @brief Decodes the chars that start in the first 8 bytes at 'p'
+ *
+ * Works out the value of a 1, 2 or 3 byte char starting at every one of the 8
+ * bytes (the 16 bytes loaded cover the last one's continuations), then packs
+ * the ones at real starts together. Every byte that isn't a continuation
+ * writes a unit, the same as decodeUTF8. It always stores 8 units, so it's
+ * only safe when at least 8 chars start in the next 32 bytes; it says no when
+ * they don't, and to 4 byte chars.
+ *
+ * @return true if it moved 'p' on 8 bytes and 'out' on past the chars
+ */
+template <typename Unit>
+__attribute__((target("sse4.2"))) inline bool
+decodeBMPSSE42(const char *&p, Unit *&out, const UTF8PackTable &table) {
+  const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  const __m128i next =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+  const __m128i continuationMark = _mm_set1_epi8(char(0xC0));
+  const uint32_t continuations =
+      _mm_movemask_epi8(_mm_cmplt_epi8(chunk, continuationMark)) |
+      (_mm_movemask_epi8(_mm_cmplt_epi8(next, continuationMark)) << 16);
+  const __m128i fourByte = _mm_cmpeq_epi8(
+      _mm_max_epu8(chunk, _mm_set1_epi8(char(0xF0))), chunk);
+  if ((_mm_movemask_epi8(fourByte) & 0xFF) ||
+      (32 - simd::popCount(continuations) < 8))
+    return false;
+  const __m128i b0 = _mm_cvtepu8_epi16(chunk);
+  const __m128i c1 = _mm_and_si128(_mm_cvtepu8_epi16(_mm_srli_si128(chunk, 1)),
+                                   _mm_set1_epi16(0x3F));
+  const __m128i c2 = _mm_and_si128(_mm_cvtepu8_epi16(_mm_srli_si128(chunk, 2)),
+                                   _mm_set1_epi16(0x3F));
+  const __m128i two = _mm_or_si128(
+      _mm_slli_epi16(_mm_and_si128(b0, _mm_set1_epi16(0x1F)), 6), c1);
+  const __m128i three = _mm_or_si128(
+      _mm_or_si128(_mm_slli_epi16(b0, 12), _mm_slli_epi16(c1, 6)), c2);
+  __m128i value =
+      _mm_blendv_epi8(b0, two, _mm_cmpgt_epi16(b0, _mm_set1_epi16(0x7F)));
+  value = _mm_blendv_epi8(value, three,
+                          _mm_cmpgt_epi16(b0, _mm_set1_epi16(0xDF)));
+  const int starts = ~continuations & 0xFF;
+  value = _mm_shuffle_epi8(
+      value,
+      _mm_load_si128(reinterpret_cast<const __m128i *>(table.shuffle[starts])));
+  __m128i *to = reinterpret_cast<__m128i *>(out);
+  if (sizeof(Unit) == 2)
+    _mm_storeu_si128(to, value);
+  else {
+    _mm_storeu_si128(to, _mm_cvtepu16_epi32(value));
+    _mm_storeu_si128(to + 1, _mm_cvtepu16_epi32(_mm_srli_si128(value, 8)));
+  }
+  p += 8;
+  out += simd::popCount(starts);
+  return true;
+}
+
+/// Converts utf-8 to 16 or 32 bit units, 16 ASCII chars or 8 bytes of other
+/// chars at a time
+template <typename Unit>
+__attribute__((target("sse4.2"))) inline Unit *
+decodeUTF8SSE42(const char *&p, const char *pe, Unit *out) {
+  const UTF8PackTable &table = utf8PackTable();
+  while (pe - p >= 32) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    if (_mm_movemask_epi8(chunk) == 0) {
+      widenASCIISSE42(chunk, out);
+      p += 16;
+      out += 16;
+    } else if (!decodeBMPSSE42(p, out, table)) {
+      // A 4 byte char, or bad utf-8; do the 8 bytes a char at a time
+      for (const char *stop = p + 8; p < stop;)
+        decodeUTF8(p, pe, out);
+    }
+  }
+  return out;
+}
+
+/// Converts utf-8 to 16 or 32 bit units, 32 ASCII chars or 8 bytes of other
+/// chars at a time
+template <typename Unit>
+__attribute__((target("avx2"))) inline Unit *
+decodeUTF8AVX2(const char *&p, const char *pe, Unit *out) {
+  const UTF8PackTable &table = utf8PackTable();
+  while (pe - p >= 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    if (_mm256_movemask_epi8(chunk) == 0) {
+      __m256i *to = reinterpret_cast<__m256i *>(out);
+      const __m128i low = _mm256_castsi256_si128(chunk);
+      const __m128i high = _mm256_extracti128_si256(chunk, 1);
+      if (sizeof(Unit) == 2) {
+        _mm256_storeu_si256(to, _mm256_cvtepu8_epi16(low));
+        _mm256_storeu_si256(to + 1, _mm256_cvtepu8_epi16(high));
+      } else {
+        _mm256_storeu_si256(to, _mm256_cvtepu8_epi32(low));
+        _mm256_storeu_si256(to + 1,
+                            _mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+        _mm256_storeu_si256(to + 2, _mm256_cvtepu8_epi32(high));
+        _mm256_storeu_si256(to + 3,
+                            _mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+      }
+      p += 32;
+      out += 32;
+    } else if (!decodeBMPSSE42(p, out, table)) {
+      // A 4 byte char, or bad utf-8; do the 8 bytes a char at a time
+      for (const char *stop = p + 8; p < stop;)
+        decodeUTF8(p, pe, out);
+    }
+  }
+  return out;
+}
+
+/// Copies leading ASCII from 16 or 32 bit units, 16 units at a time
+template <typename Unit>
+__attribute__((target("sse4.2"))) inline size_t
+narrowASCIISSE42(const Unit *p, const Unit *pe, char *out) {
+  const Unit *start = p;
+  for (; pe - p >= 16; p += 16, out += 16) {
+    const __m128i *from = reinterpret_cast<const __m128i *>(p);
+    __m128i packed;
+    if (sizeof(Unit) == 2) {
+      const __m128i a = _mm_loadu_si128(from);
+      const __m128i b = _mm_loadu_si128(from + 1);
+      if (!_mm_testz_si128(_mm_or_si128(a, b), _mm_set1_epi16(short(0xFF80))))
+        break;
+      packed = _mm_packus_epi16(a, b);
+    } else {
+      const __m128i a = _mm_loadu_si128(from);
+      const __m128i b = _mm_loadu_si128(from + 1);
+      const __m128i c = _mm_loadu_si128(from + 2);
+      const __m128i d = _mm_loadu_si128(from + 3);
+      if (!_mm_testz_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                           _mm_set1_epi32(int(0xFFFFFF80))))
+        break;
+      packed = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), packed);
+  }
+  return p - start;
+}
+
+/// Copies leading ASCII from 16 or 32 bit units, 32 units at a time
+template <typename Unit>
+__attribute__((target("avx2"))) inline size_t
+narrowASCIIAVX2(const Unit *p, const Unit *pe, char *out) {
+  const Unit *start = p;
+  for (; pe - p >= 32; p += 32, out += 32) {
+    const __m256i *from = reinterpret_cast<const __m256i *>(p);
+    __m256i packed;
+    if (sizeof(Unit) == 2) {
+      const __m256i a = _mm256_loadu_si256(from);
+      const __m256i b = _mm256_loadu_si256(from + 1);
+      if (!_mm256_testz_si256(_mm256_or_si256(a, b),
+                              _mm256_set1_epi16(short(0xFF80))))
+        break;
+      // The packs work within each 128 bit lane, so put the lanes back in
+      // order afterwards
+      packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+    } else {
+      const __m256i a = _mm256_loadu_si256(from);
+      const __m256i b = _mm256_loadu_si256(from + 1);
+      const __m256i c = _mm256_loadu_si256(from + 2);
+      const __m256i d = _mm256_loadu_si256(from + 3);
+      if (!_mm256_testz_si256(
+              _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)),
+              _mm256_set1_epi32(int(0xFFFFFF80))))
+        break;
+      packed = _mm256_permutevar8x32_epi32(
+          _mm256_packus_epi16(_mm256_packus_epi32(a, b),
+                              _mm256_packus_epi32(c, d)),
+          _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), packed);
+  }
+  return (p - start) + narrowASCIISSE42(p, pe, out);
+}
+
+#endif
+
+using BadUTF8Finder = const char *(*)(const char *, const char *);
+using UTF8Counter = UTF8Counts (*)(const char *, const char *);
+template <typename Unit>
+using UTF8Sizer = size_t (*)(const Unit *, const Unit *);
+template <typename Unit>
+using UTF8Decoder = Unit *(*)(const char *&, const char *, Unit *);
+template <typename Unit>
+using ASCIINarrower = size_t (*)(const Unit *, const Unit *, char *);
+
+/// Returns the utf-8 checker for an instruction set
+inline BadUTF8Finder badUTF8FinderFor(simd::InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case simd::avx2:
+    return findBadUTF8AVX2;
+  case simd::sse42:
+    return findBadUTF8SSE42;
+  case simd::scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return findBadUTF8Scalar;
+}
+
+/// Returns the utf-8 char counter for an instruction set
+inline UTF8Counter utf8CounterFor(simd::InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case simd::avx2:
+    return countUTF8AVX2;
+  case simd::sse42:
+    return countUTF8SSE42;
+  case simd::scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return countUTF8Scalar;
+}
+
+/// Returns the function that sizes wide text as utf-8, for an instruction set
+template <typename Unit>
+inline UTF8Sizer<Unit> utf8SizerFor(simd::InstructionSet set) {
+  static_assert((sizeof(Unit) == 2) || (sizeof(Unit) == 4),
+                "Expected 16 or 32 bit units");
+#ifdef JSON_SIMD_X86
+  // AVX2 doesn't help much here; the SSE versions are limited by the
+  // surrogate checks
+  if (set != simd::scalar)
+    return (sizeof(Unit) == 2) ? utf8SizeFrom16SSE42<Unit>
+                               : utf8SizeFrom32SSE42<Unit>;
+#else
+  (void)set;
+#endif
+  return (sizeof(Unit) == 2) ? utf8SizeFrom16Scalar<Unit>
+                             : utf8SizeFrom32Scalar<Unit>;
+}
+
+/// Returns the utf-8 decoder for an instruction set
+template <typename Unit>
+inline UTF8Decoder<Unit> utf8DecoderFor(simd::InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case simd::avx2:
+    return decodeUTF8AVX2<Unit>;
+  case simd::sse42:
+    return decodeUTF8SSE42<Unit>;
+  case simd::scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return decodeUTF8Scalar<Unit>;
+}
+
+/// Returns the ASCII narrower for an instruction set
+template <typename Unit>
+inline ASCIINarrower<Unit> asciiNarrowerFor(simd::InstructionSet set) {
+#ifdef JSON_SIMD_X86
+  switch (set) {
+  case simd::avx2:
+    return narrowASCIIAVX2<Unit>;
+  case simd::sse42:
+    return narrowASCIISSE42<Unit>;
+  case simd::scalar:
+    break;
+  }
+#else
+  (void)set;
+#endif
+  return narrowASCIIScalar<Unit>;
+}
+
+/// How many bytes decodeUTF8 and the encoders go through before the vector
+/// versions are tried again
+constexpr ptrdiff_t vectorRetry = 32;
+
+} // namespace detail
+
+/**
+* @brief Finds the first char that isn't well formed utf-8 (see skipUTF8Char)
+*
+* @param p The start of the text
+* @param pe One past the end of the text
+* @return The first byte of the first bad char, or pe if they're all good
+*/
+inline const char *findBadUTF8(const char *p, const char *pe) {
+  static const detail::BadUTF8Finder finder =
+      detail::badUTF8FinderFor(simd::instructionSet());
+  return finder(p, pe);
+}
+
+/// Counts the chars in some utf-8
+inline UTF8Counts countUTF8(const char *p, const char *pe) {
+  static const detail::UTF8Counter counter =
+      detail::utf8CounterFor(simd::instructionSet());
+  return counter(p, pe);
+}
+
+/// How many 'Unit's utf8ToWide() will write for [p, pe): utf-16 units for 16
+/// bit 'Unit's, and utf-32 for 32 bit ones
+template <typename Unit> inline size_t wideSize(const char *p, const char *pe) {
+  static_assert((sizeof(Unit) == 2) || (sizeof(Unit) == 4),
+                "Expected 16 or 32 bit units");
+  const UTF8Counts counts = countUTF8(p, pe);
+  return counts.chars + ((sizeof(Unit) == 2) ? counts.supplementary : 0);
 }
 
+/**
+* @brief Converts well formed utf-8 to utf-16 or utf-32
+*
+* @param p The start of the utf-8
+* @param pe One past the end of the utf-8
+* @param out Where to write wideSize<Unit>(p, pe) units
+* @return One past the last unit written
+*/
+template <typename Unit>
+inline Unit *utf8ToWide(const char *p, const char *pe, Unit *out) {
+  static_assert((sizeof(Unit) == 2) || (sizeof(Unit) == 4),
+                "Expected 16 or 32 bit units");
+  static const detail::UTF8Decoder<Unit> decode =
+      detail::utf8DecoderFor<Unit>(simd::instructionSet());
+  while (p != pe) {
+    out = decode(p, pe, out);
+    const char *retry = (pe - p > detail::vectorRetry) ? p + detail::vectorRetry : pe;
+    while (p < retry)
+      detail::decodeUTF8(p, pe, out);
+  }
+  return out;
+}
+
+/// How many bytes wideToUTF8() will write for [p, pe)
+template <typename Unit>
+inline size_t utf8Size(const Unit *p, const Unit *pe) {
+  static const detail::UTF8Sizer<Unit> sizer =
+      detail::utf8SizerFor<Unit>(simd::instructionSet());
+  return sizer(p, pe);
+}
+
+/**
+* @brief Converts utf-16 or utf-32 to utf-8
+*
+* @param p The start of the wide text; 16 bit units are read as utf-16, 32 bit
+*          ones as utf-32
+* @param pe One past the end of the wide text
+* @param out Where to write utf8Size(p, pe) bytes
+* @return One past the last byte written
+*/
+template <typename Unit>
+inline char *wideToUTF8(const Unit *p, const Unit *pe, char *out) {
+  static_assert((sizeof(Unit) == 2) || (sizeof(Unit) == 4),
+                "Expected 16 or 32 bit units");
+  static const detail::ASCIINarrower<Unit> narrow =
+      detail::asciiNarrowerFor<Unit>(simd::instructionSet());
+  while (p != pe) {
+    const size_t copied = narrow(p, pe, out);
+    p += copied;
+    out += copied;
+    const Unit *retry = (pe - p > detail::vectorRetry) ? p + detail::vectorRetry : pe;
+    while (p < retry) {
+      if (sizeof(Unit) == 2)
+        out = detail::encodeUTF16(p, pe, out);
+      else
+        out = detail::encodeUTF32(*p++, out);
+    }
+  }
+  return out;
+}
 
 }
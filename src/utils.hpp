@@ -2,6 +2,9 @@
 #pragma once
 
 #include <iterator>
+#include <string>
+#include <vector>
+#include <type_traits>
 #include <boost/hana.hpp>
 #include <boost/hana/traits.hpp>
 #include <boost/hana/ext/std/integral_constant.hpp>
@@ -72,4 +75,28 @@ auto is_output_iterator = [](auto &&x) {
          hana::traits::is_assignable(t2, t1);
 };
 
+/// Iterators that walk over one contiguous block of chars. We can't detect this
+/// from the iterator's interface, so the known types are listed here.
+template <typename T> struct is_contiguous_char_iterator : std::false_type {};
+template <> struct is_contiguous_char_iterator<char *> : std::true_type {};
+template <> struct is_contiguous_char_iterator<const char *> : std::true_type {};
+template <>
+struct is_contiguous_char_iterator<std::string::iterator> : std::true_type {};
+template <>
+struct is_contiguous_char_iterator<std::string::const_iterator>
+    : std::true_type {};
+template <>
+struct is_contiguous_char_iterator<std::vector<char>::iterator>
+    : std::true_type {};
+template <>
+struct is_contiguous_char_iterator<std::vector<char>::const_iterator>
+    : std::true_type {};
+
+/// Returns true if we can take the address of *x and read the following chars
+/// through a plain pointer
+auto is_contiguous_iterator = [](auto &&x) {
+  return hana::bool_c<
+      is_contiguous_char_iterator<std::decay_t<decltype(x)>>::value>;
+};
+
 }
@@ -0,0 +1,336 @@
+/// Writes numbers as json text, straight into a char buffer.
+///
+/// Integers use a two-digits-at-a-time itoa. Doubles use Grisu2 (Florian
+/// Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+/// Integers"), which gives the shortest digits that read back as the same
+/// double in almost every case, and never more than 17 digits. None of it
+/// depends on the locale.
+#pragma once
+
+#include "../parser/decimal.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace json {
+
+/// The most chars that writeInteger or writeDouble will write
+constexpr size_t maxNumberChars = 25;
+
+/// "00" "01" .. "99"
+inline const char *digitPairs() {
+  static const char pairs[] = "00010203040506070809"
+                              "10111213141516171819"
+                              "20212223242526272829"
+                              "30313233343536373839"
+                              "40414243444546474849"
+                              "50515253545556575859"
+                              "60616263646566676869"
+                              "70717273747576777879"
+                              "80818283848586878889"
+                              "90919293949596979899";
+  return pairs;
+}
+
+/**
+ * @brief Writes an unsigned integer
+ *
+ * @param value The number to write
+ * @param out Where to write it; needs room for maxNumberChars
+ * @returns One past the last char written
+ */
+inline char *writeInteger(uint64_t value, char *out) {
+  char buffer[20];
+  char *p = buffer + sizeof(buffer);
+  while (value >= 100) {
+    const char *pair = digitPairs() + (value % 100) * 2;
+    value /= 100;
+    *--p = pair[1];
+    *--p = pair[0];
+  }
+  if (value >= 10) {
+    const char *pair = digitPairs() + value * 2;
+    *--p = pair[1];
+    *--p = pair[0];
+  } else
+    *--p = static_cast<char>('0' + value);
+  size_t length = buffer + sizeof(buffer) - p;
+  std::memcpy(out, p, length);
+  return out + length;
+}
+
+/// Writes a signed integer
+inline char *writeInteger(int64_t value, char *out) {
+  if (value >= 0)
+    return writeInteger(static_cast<uint64_t>(value), out);
+  *out++ = '-';
+  // Negate as unsigned, so that INT64_MIN works
+  return writeInteger(uint64_t(0) - static_cast<uint64_t>(value), out);
+}
+
+namespace grisu {
+
+/// A floating point number with a 64 bit significand: f * 2^e
+struct DiyFp {
+  uint64_t f;
+  int e;
+
+  static constexpr uint64_t hiddenBit = uint64_t(1) << 52;
+
+  DiyFp(uint64_t f, int e) : f(f), e(e) {}
+  explicit DiyFp(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int biasedExponent = static_cast<int>((bits >> 52) & 0x7FF);
+    f = bits & (hiddenBit - 1);
+    if (biasedExponent != 0) {
+      f += hiddenBit;
+      e = biasedExponent - 1075;
+    } else
+      e = 1 - 1075; // Subnormal
+  }
+
+  DiyFp operator-(const DiyFp &other) const { return {f - other.f, e}; }
+
+  /// Multiplies, rounding to 64 bits
+  DiyFp operator*(const DiyFp &other) const {
+    uint64_t hi, lo;
+    multiply128(f, other.f, hi, lo);
+    if (lo & (uint64_t(1) << 63))
+      ++hi;
+    return {hi, e + other.e + 64};
+  }
+
+  DiyFp normalize() const {
+    int shift = countLeadingZeros(f);
+    return {f << shift, e - shift};
+  }
+
+  /// The neighbours halfway to the next and previous doubles, normalized to
+  /// the same exponent
+  void boundaries(DiyFp &minus, DiyFp &plus) const {
+    DiyFp upper((f << 1) + 1, e - 1);
+    while (!(upper.f & (hiddenBit << 1))) {
+      upper.f <<= 1;
+      --upper.e;
+    }
+    upper.f <<= 64 - 52 - 2;
+    upper.e -= 64 - 52 - 2;
+    // At a power of two, the previous double is half as far away
+    DiyFp lower = (f == hiddenBit) ? DiyFp((f << 2) - 1, e - 2)
+                                   : DiyFp((f << 1) - 1, e - 1);
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+    minus = lower;
+    plus = upper;
+  }
+};
+
+/// Finds a power of ten c = 10^-k such that multiplying by it brings binary
+/// exponent 'e' into the range that digitGen needs
+inline DiyFp cachedPower(int e, int &k) {
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int rounded = static_cast<int>(dk);
+  if (dk - rounded > 0.0)
+    ++rounded;
+  int index = (rounded >> 3) + 1;
+  int power = -348 + index * 8;
+  k = -power;
+  const uint64_t *row = pow10Table()[power - pow10TableMin];
+  // Round the 128 bit approximation to 64 bits
+  uint64_t f = row[1] + (row[0] >> 63);
+  return {f, ((217706 * power) >> 16) - 63};
+}
+
+/// Moves the last digit down while that brings us closer to the real value
+inline void round(char *buffer, int length, uint64_t delta, uint64_t rest,
+                  uint64_t tenKappa, uint64_t distance) {
+  while ((rest < distance) && (delta - rest >= tenKappa) &&
+         ((rest + tenKappa < distance) ||
+          (distance - rest > rest + tenKappa - distance))) {
+    --buffer[length - 1];
+    rest += tenKappa;
+  }
+}
+
+inline int countDigits(uint32_t n) {
+  if (n < 10) return 1;
+  if (n < 100) return 2;
+  if (n < 1000) return 3;
+  if (n < 10000) return 4;
+  if (n < 100000) return 5;
+  if (n < 1000000) return 6;
+  if (n < 10000000) return 7;
+  if (n < 100000000) return 8;
+  return 9;
+}
+
+/// Generates the digits of 'w', stopping as soon as they're inside
+/// [mp - delta, mp]
+inline void digitGen(const DiyFp &w, const DiyFp &mp, uint64_t delta,
+                     char *buffer, int &length, int &k) {
+  static const uint64_t powersOfTen[] = {1ull,
+                                         10ull,
+                                         100ull,
+                                         1000ull,
+                                         10000ull,
+                                         100000ull,
+                                         1000000ull,
+                                         10000000ull,
+                                         100000000ull,
+                                         1000000000ull,
+                                         10000000000ull,
+                                         100000000000ull,
+                                         1000000000000ull,
+                                         10000000000000ull,
+                                         100000000000000ull,
+                                         1000000000000000ull,
+                                         10000000000000000ull,
+                                         100000000000000000ull,
+                                         1000000000000000000ull,
+                                         10000000000000000000ull};
+  const DiyFp one(uint64_t(1) << -mp.e, mp.e);
+  const DiyFp distance = mp - w;
+  uint32_t integral = static_cast<uint32_t>(mp.f >> -one.e);
+  uint64_t fractional = mp.f & (one.f - 1);
+  int kappa = countDigits(integral);
+  length = 0;
+
+  while (kappa > 0) {
+    uint32_t divisor = static_cast<uint32_t>(powersOfTen[kappa - 1]);
+    uint32_t digit = integral / divisor;
+    integral %= divisor;
+    if (digit || length)
+      buffer[length++] = static_cast<char>('0' + digit);
+    --kappa;
+    uint64_t rest = (static_cast<uint64_t>(integral) << -one.e) + fractional;
+    if (rest <= delta) {
+      k += kappa;
+      round(buffer, length, delta, rest, powersOfTen[kappa] << -one.e,
+            distance.f);
+      return;
+    }
+  }
+
+  for (;;) {
+    fractional *= 10;
+    delta *= 10;
+    char digit = static_cast<char>(fractional >> -one.e);
+    if (digit || length)
+      buffer[length++] = static_cast<char>('0' + digit);
+    fractional &= one.f - 1;
+    --kappa;
+    if (fractional < delta) {
+      k += kappa;
+      int index = -kappa;
+      round(buffer, length, delta, fractional, one.f,
+            distance.f * (index < 20 ? powersOfTen[index] : 0));
+      return;
+    }
+  }
+}
+
+/// Writes the digits of a positive, finite double into 'buffer'; the value is
+/// digits * 10^k
+inline void grisu2(double value, char *buffer, int &length, int &k) {
+  const DiyFp v(value);
+  DiyFp minus(0, 0), plus(0, 0);
+  v.boundaries(minus, plus);
+  const DiyFp c = cachedPower(plus.e, k);
+  const DiyFp w = v.normalize() * c;
+  DiyFp upper = plus * c;
+  DiyFp lower = minus * c;
+  ++lower.f;
+  --upper.f;
+  digitGen(w, upper, upper.f - lower.f, buffer, length, k);
+}
+
+inline char *writeExponent(int k, char *out) {
+  if (k < 0) {
+    *out++ = '-';
+    k = -k;
+  }
+  if (k >= 100) {
+    *out++ = static_cast<char>('0' + k / 100);
+    k %= 100;
+    const char *pair = digitPairs() + k * 2;
+    *out++ = pair[0];
+    *out++ = pair[1];
+  } else if (k >= 10) {
+    const char *pair = digitPairs() + k * 2;
+    *out++ = pair[0];
+    *out++ = pair[1];
+  } else
+    *out++ = static_cast<char>('0' + k);
+  return out;
+}
+
+/// Lays out 'length' digits times 10^k as a json number
+inline char *format(char *buffer, int length, int k) {
+  const int point = length + k; // 10^(point-1) <= value < 10^point
+  if ((0 <= k) && (point <= 21)) {
+    // 1234e7 -> 12340000000
+    for (int i = length; i < point; ++i)
+      buffer[i] = '0';
+    return buffer + point;
+  }
+  if ((0 < point) && (point <= 21)) {
+    // 1234e-2 -> 12.34
+    std::memmove(buffer + point + 1, buffer + point, length - point);
+    buffer[point] = '.';
+    return buffer + length + 1;
+  }
+  if ((-6 < point) && (point <= 0)) {
+    // 1234e-6 -> 0.001234
+    const int offset = 2 - point;
+    std::memmove(buffer + offset, buffer, length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    for (int i = 2; i < offset; ++i)
+      buffer[i] = '0';
+    return buffer + length + offset;
+  }
+  if (length == 1) {
+    // 1e30
+    buffer[1] = 'e';
+    return writeExponent(point - 1, buffer + 2);
+  }
+  // 1234e30 -> 1.234e33
+  std::memmove(buffer + 2, buffer + 1, length - 1);
+  buffer[1] = '.';
+  buffer[length + 1] = 'e';
+  return writeExponent(point - 1, buffer + length + 2);
+}
+
+} // namespace grisu
+
+/**
+ * @brief Writes a double in the fewest digits that read back as the same value
+ *
+ * Whole numbers are written without a fraction ("3", not "3.0"). json has no
+ * NaN or infinity, so they're written as null.
+ *
+ * @param value The number to write
+ * @param out Where to write it; needs room for maxNumberChars
+ * @returns One past the last char written
+ */
+inline char *writeDouble(double value, char *out) {
+  if (!std::isfinite(value)) {
+    std::memcpy(out, "null", 4);
+    return out + 4;
+  }
+  if (std::signbit(value)) {
+    *out++ = '-';
+    value = -value;
+  }
+  if (value == 0) {
+    *out++ = '0';
+    return out;
+  }
+  int length, k;
+  grisu::grisu2(value, out, length, k);
+  return grisu::format(out, length, k);
+}
+
+} // namespace json
@@ -0,0 +1,83 @@
+/// Places the json writer can write to.
+///
+/// A sink is anything with 'put(char)' and 'write(const char*, size_t)'. The
+/// writer calls them directly, so there's no virtual call per char like there
+/// is when going through a std::ostream.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace json {
+
+/// Appends to a std::string (or anything with push_back and append)
+template <typename String = std::string> class StringSink {
+public:
+  explicit StringSink(String &out) : out(out) {}
+  void put(char c) { out.push_back(c); }
+  void write(const char *chars, size_t size) { out.append(chars, size); }
+
+private:
+  String &out;
+};
+
+/// Writes through an output iterator, like std::back_inserter or an
+/// std::ostreambuf_iterator
+template <typename OutputIterator> class IteratorSink {
+public:
+  explicit IteratorSink(OutputIterator out) : out(out) {}
+  void put(char c) { *out++ = c; }
+  void write(const char *chars, size_t size) {
+    out = std::copy(chars, chars + size, out);
+  }
+  /// Where the next char would go
+  OutputIterator position() const { return out; }
+
+private:
+  OutputIterator out;
+};
+
+/**
+ * @brief Collects chars in a fixed buffer and hands them to a std::ostream a
+ *        block at a time
+ *
+ * Whatever's left is written when the sink is destroyed, or on flush().
+ */
+class StreamSink {
+public:
+  explicit StreamSink(std::ostream &out) : out(out), used(0) {}
+  StreamSink(const StreamSink &) = delete;
+  StreamSink &operator=(const StreamSink &) = delete;
+  ~StreamSink() { flush(); }
+
+  void put(char c) {
+    if (used == sizeof(buffer))
+      flush();
+    buffer[used++] = c;
+  }
+  void write(const char *chars, size_t size) {
+    if (size > sizeof(buffer) - used) {
+      flush();
+      if (size > sizeof(buffer)) {
+        out.write(chars, size);
+        return;
+      }
+    }
+    std::copy(chars, chars + size, buffer + used);
+    used += size;
+  }
+  void flush() {
+    if (used)
+      out.write(buffer, used);
+    used = 0;
+  }
+
+private:
+  std::ostream &out;
+  char buffer[4096];
+  size_t used;
+};
+
+} // namespace json
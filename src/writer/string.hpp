@@ -0,0 +1,141 @@
+/// Writes strings as json text: quoted, with everything json needs escaped.
+///
+/// Most text has nothing to escape, so we look for the next char that needs
+/// work with the vectorized scanners in parser/simd.hpp, and copy the runs in
+/// between to the sink in one go.
+#pragma once
+
+#include "../parser/simd.hpp"
+#include "../unicode.hpp"
+
+#include <cstddef>
+
+namespace json {
+
+/// What the writer escapes in strings
+enum class Escape {
+  required, ///< Only what json requires: '"', '\\' and control chars
+  nonASCII  ///< Those, plus everything non ASCII as \uXXXX, for transports
+            ///< that only carry ASCII
+};
+
+/**
+ * @brief Reads one utf-8 encoded char
+ *
+ * Only accepts the shortest encoding of a char up to 0x10FFFF that isn't a
+ * utf-16 surrogate.
+ *
+ * @param p The first byte of the char; moved past it on success
+ * @param pe One past the end of the input
+ * @param u Where to put the char
+ * @returns false if [p, pe) doesn't start with a valid char
+ */
+inline bool decodeUTF8(const char *&p, const char *pe, char32_t &u) {
+  const unsigned char lead = static_cast<unsigned char>(*p);
+  int extra;
+  char32_t min;
+  if (lead < 0x80) {
+    u = lead;
+    ++p;
+    return true;
+  } else if ((lead & 0xE0) == 0xC0) {
+    extra = 1;
+    min = 0x80;
+    u = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    extra = 2;
+    min = 0x800;
+    u = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    extra = 3;
+    min = 0x10000;
+    u = lead & 0x07;
+  } else
+    return false;
+  if (pe - p <= extra)
+    return false;
+  for (int i = 1; i <= extra; ++i) {
+    const unsigned char byte = static_cast<unsigned char>(p[i]);
+    if ((byte & 0xC0) != 0x80)
+      return false;
+    u = (u << 6) | (byte & 0x3F);
+  }
+  if ((u < min) || (u > 0x10FFFF) || ((u >= 0xD800) && (u <= 0xDFFF)))
+    return false;
+  p += extra + 1;
+  return true;
+}
+
+/// Writes \uXXXX for one utf-16 unit
+template <typename Sink> inline void writeUnicodeEscape(Sink &out, char16_t c) {
+  static const char hex[] = "0123456789abcdef";
+  const char escaped[] = {'\\', 'u', hex[(c >> 12) & 0xF], hex[(c >> 8) & 0xF],
+                          hex[(c >> 4) & 0xF], hex[c & 0xF]};
+  out.write(escaped, sizeof(escaped));
+}
+
+/**
+ * @brief Writes a json string, quotes and all
+ *
+ * With Escape::nonASCII, chars from 0x80 up are written as \uXXXX (a
+ * surrogate pair above 0xFFFF). Bytes that aren't valid utf-8 can't be
+ * written that way, so each one becomes \ufffd.
+ *
+ * @param out Where to write it; see writer/sink.hpp
+ * @param p The utf-8 encoded text
+ * @param size How many bytes of it there are
+ * @param escape What to escape
+ */
+template <typename Sink>
+void writeString(Sink &out, const char *p, size_t size,
+                 Escape escape = Escape::required) {
+  const char *pe = p + size;
+  out.put('"');
+  for (;;) {
+    const char *special;
+    // Keys and short values aren't worth a call through the scanner pointer
+    if (pe - p < 16)
+      special = escape == Escape::required
+                    ? simd::findStringSpecialScalar(p, pe)
+                    : simd::findNonASCIISpecialScalar(p, pe);
+    else
+      special = escape == Escape::required
+                    ? simd::findStringSpecial(p, pe)
+                    : simd::findNonASCIISpecial(p, pe);
+    if (special != p)
+      out.write(p, special - p);
+    if (special == pe)
+      break;
+    p = special;
+    const unsigned char c = static_cast<unsigned char>(*p);
+    switch (c) {
+    case '"': out.write("\\\"", 2); break;
+    case '\\': out.write("\\\\", 2); break;
+    case '\b': out.write("\\b", 2); break;
+    case '\f': out.write("\\f", 2); break;
+    case '\n': out.write("\\n", 2); break;
+    case '\r': out.write("\\r", 2); break;
+    case '\t': out.write("\\t", 2); break;
+    default:
+      if (c < 0x20) {
+        writeUnicodeEscape(out, c);
+        break;
+      }
+      char32_t u;
+      if (!decodeUTF8(p, pe, u)) {
+        writeUnicodeEscape(out, 0xFFFD);
+        ++p;
+        continue;
+      }
+      char16_t units[2];
+      int count = to16(&u, units);
+      for (int i = 0; i < count; ++i)
+        writeUnicodeEscape(out, units[i]);
+      continue;
+    }
+    ++p;
+  }
+  out.put('"');
+}
+
+} // namespace json
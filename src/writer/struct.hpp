@@ -0,0 +1,203 @@
+/// Writes your own structs as json text, with no JSON tree in between
+///
+/// Declare the members with BOOST_HANA_DEFINE_STRUCT, and writeValue() writes
+/// them as an object with the same member names, in declaration order:
+///
+///     struct Tenant {
+///       BOOST_HANA_DEFINE_STRUCT(Tenant,
+///         (std::string, name),
+///         (std::string, id));
+///     };
+///     std::string json = writeToString(Tenant{"me", "641237"});
+///     // {"name":"me","id":"641237"}
+///
+/// Members can be bools, numbers, std::string, std::vector and
+/// std::map<std::string, ...> of those, other such structs, or anything with a
+/// writeTo(Sink&, Escape) method, like JSON. Each member's '"name":' (with the
+/// ',' or '{' before it) is a hana string made at compile time, so it goes to
+/// the sink in a single write. Member names are C++ identifiers, so they never
+/// need escaping.
+#pragma once
+
+#include "number.hpp"
+#include "sink.hpp"
+#include "string.hpp"
+
+#include <boost/hana.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace json {
+
+namespace hana = boost::hana;
+
+namespace detail {
+
+template <typename T>
+using StructAccessors = decltype(hana::accessors<T>());
+
+template <typename T>
+constexpr size_t writableStructSize =
+    hana::value<decltype(hana::length(std::declval<StructAccessors<T>>()))>();
+
+/// '{"key":' for the first member of a struct, ',"key":' for the others
+template <typename T, size_t I>
+using MemberPrefix = decltype(
+    hana::string_c<I == 0 ? '{' : ',', '"'> +
+    std::decay_t<decltype(
+        hana::first(hana::at_c<I>(std::declval<StructAccessors<T>>())))>{} +
+    hana::string_c<'"', ':'>);
+
+auto has_writeTo = hana::is_valid(
+    [](auto &&x) -> decltype(x.writeTo(std::declval<StringSink<> &>(),
+                                       Escape::required)) {});
+
+} // namespace detail
+
+template <typename Sink>
+void writeValue(Sink &out, bool value, Escape escape = Escape::required);
+template <typename Sink, typename T>
+std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+writeValue(Sink &out, T value, Escape escape = Escape::required);
+template <typename Sink, typename Traits, typename Allocator>
+void writeValue(Sink &out,
+                const std::basic_string<char, Traits, Allocator> &value,
+                Escape escape = Escape::required);
+template <typename Sink, typename T, typename Allocator>
+void writeValue(Sink &out, const std::vector<T, Allocator> &value,
+                Escape escape = Escape::required);
+template <typename Sink, typename T, typename Compare, typename Allocator>
+void writeValue(Sink &out,
+                const std::map<std::string, T, Compare, Allocator> &value,
+                Escape escape = Escape::required);
+template <typename Sink, typename T>
+std::enable_if_t<decltype(detail::has_writeTo(std::declval<T>()))::value>
+writeValue(Sink &out, const T &value, Escape escape = Escape::required);
+template <typename Sink, typename T>
+std::enable_if_t<hana::Struct<T>::value>
+writeValue(Sink &out, const T &value, Escape escape = Escape::required);
+
+namespace detail {
+
+/// Writes member 'I' of a struct, with its key
+template <size_t I, typename Sink, typename T>
+void writeMember(Sink &out, const T &value, Escape escape) {
+  using Prefix = MemberPrefix<T, I>;
+  out.write(hana::to<const char *>(Prefix{}),
+            hana::value<decltype(hana::length(Prefix{}))>());
+  auto &&accessor = hana::second(hana::at_c<I>(hana::accessors<T>()));
+  writeValue(out, accessor(value), escape);
+}
+
+template <typename Sink, typename T, size_t... I>
+void writeMembers(Sink &out, const T &value, Escape escape,
+                  std::index_sequence<I...>) {
+  // Not used at all for structs with no members
+  (void)escape;
+  using expand = int[];
+  (void)expand{0, (writeMember<I>(out, value, escape), 0)...};
+}
+
+} // namespace detail
+
+/// Writes true or false
+template <typename Sink> void writeValue(Sink &out, bool value, Escape) {
+  if (value)
+    out.write("true", 4);
+  else
+    out.write("false", 5);
+}
+
+/// Writes any c++ number type; non finite doubles come out as null
+template <typename Sink, typename T>
+std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+writeValue(Sink &out, T value, Escape) {
+  char buffer[maxNumberChars];
+  char *end = std::is_floating_point<T>::value
+                  ? writeDouble(static_cast<double>(value), buffer)
+                  : std::is_signed<T>::value
+                        ? writeInteger(static_cast<int64_t>(value), buffer)
+                        : writeInteger(static_cast<uint64_t>(value), buffer);
+  out.write(buffer, end - buffer);
+}
+
+/// Writes a string, quoted and escaped
+template <typename Sink, typename Traits, typename Allocator>
+void writeValue(Sink &out,
+                const std::basic_string<char, Traits, Allocator> &value,
+                Escape escape) {
+  writeString(out, value.data(), value.size(), escape);
+}
+
+/// Writes a vector as an array
+template <typename Sink, typename T, typename Allocator>
+void writeValue(Sink &out, const std::vector<T, Allocator> &value,
+                Escape escape) {
+  out.put('[');
+  bool first = true;
+  for (const auto &item : value) {
+    if (!first)
+      out.put(',');
+    first = false;
+    writeValue(out, item, escape);
+  }
+  out.put(']');
+}
+
+/// Writes a map as an object
+template <typename Sink, typename T, typename Compare, typename Allocator>
+void writeValue(Sink &out,
+                const std::map<std::string, T, Compare, Allocator> &value,
+                Escape escape) {
+  out.put('{');
+  bool first = true;
+  for (const auto &entry : value) {
+    if (!first)
+      out.put(',');
+    first = false;
+    writeString(out, entry.first.data(), entry.first.size(), escape);
+    out.put(':');
+    writeValue(out, entry.second, escape);
+  }
+  out.put('}');
+}
+
+/// Writes something that knows how to write itself, like a JSON
+template <typename Sink, typename T>
+std::enable_if_t<decltype(detail::has_writeTo(std::declval<T>()))::value>
+writeValue(Sink &out, const T &value, Escape escape) {
+  value.writeTo(out, escape);
+}
+
+/**
+ * @brief Writes a struct declared with BOOST_HANA_DEFINE_STRUCT as an object
+ *
+ * @param out The sink to write to
+ * @param value The struct; every member is written, in declaration order
+ * @param escape What to escape in the strings
+ */
+template <typename Sink, typename T>
+std::enable_if_t<hana::Struct<T>::value>
+writeValue(Sink &out, const T &value, Escape escape) {
+  constexpr size_t size = detail::writableStructSize<T>;
+  detail::writeMembers(out, value, escape, std::make_index_sequence<size>());
+  if (size == 0)
+    out.put('{');
+  out.put('}');
+}
+
+/// Writes 'value' as json text into a new string
+template <typename T>
+std::string writeToString(const T &value, Escape escape = Escape::required) {
+  std::string result;
+  StringSink<> out(result);
+  writeValue(out, value, escape);
+  return result;
+}
+
+} // namespace json
@@ -0,0 +1,122 @@
+/// Tests writing numbers
+
+#include <bandit/bandit.h>
+
+#include "number.hpp"
+
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+template <typename T> std::string written(T value) {
+  char buffer[maxNumberChars];
+  char *end = writeInteger(value, buffer);
+  return std::string(buffer, end);
+}
+
+std::string writtenDouble(double value) {
+  char buffer[maxNumberChars];
+  char *end = writeDouble(value, buffer);
+  return std::string(buffer, end);
+}
+
+/// The fewest significant digits that printf needs to round trip 'value'
+int shortestDigits(double value) {
+  char buffer[64];
+  for (int precision = 1; precision < 17; ++precision) {
+    std::snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, value);
+    if (std::strtod(buffer, nullptr) == value)
+      return precision;
+  }
+  return 17;
+}
+
+/// Significant digits in our output
+int digitsIn(const std::string &number) {
+  std::string digits;
+  for (char c : number) {
+    if (c == 'e')
+      break;
+    if ((c >= '0') && (c <= '9'))
+      digits += c;
+  }
+  size_t first = digits.find_first_not_of('0');
+  size_t last = digits.find_last_not_of('0');
+  return first == std::string::npos ? 0 : static_cast<int>(last - first + 1);
+}
+
+go_bandit([]() {
+
+  describe("The number writer", [&]() {
+
+    it("1.0 Writes integers", [&]() {
+      AssertThat(written(uint64_t(0)), Equals("0"));
+      AssertThat(written(uint64_t(7)), Equals("7"));
+      AssertThat(written(uint64_t(42)), Equals("42"));
+      AssertThat(written(uint64_t(1234567890)), Equals("1234567890"));
+      AssertThat(written(std::numeric_limits<uint64_t>::max()),
+                 Equals("18446744073709551615"));
+      AssertThat(written(int64_t(-1)), Equals("-1"));
+      AssertThat(written(std::numeric_limits<int64_t>::min()),
+                 Equals("-9223372036854775808"));
+      std::mt19937_64 random(7);
+      for (int i = 0; i < 10000; ++i) {
+        int64_t value = static_cast<int64_t>(random()) >> (random() % 64);
+        AssertThat(written(value), Equals(std::to_string(value)));
+      }
+    });
+
+    it("1.1 Writes doubles in json form", [&]() {
+      AssertThat(writtenDouble(0.0), Equals("0"));
+      AssertThat(writtenDouble(-0.0), Equals("-0"));
+      AssertThat(writtenDouble(1.0), Equals("1"));
+      AssertThat(writtenDouble(-1.5), Equals("-1.5"));
+      AssertThat(writtenDouble(0.1), Equals("0.1"));
+      AssertThat(writtenDouble(3.1415927), Equals("3.1415927"));
+      AssertThat(writtenDouble(123456.789), Equals("123456.789"));
+      AssertThat(writtenDouble(0.000001), Equals("0.000001"));
+      AssertThat(writtenDouble(1e-7), Equals("1e-7"));
+      AssertThat(writtenDouble(1e21), Equals("1e21"));
+      AssertThat(writtenDouble(1e20), Equals("100000000000000000000"));
+      AssertThat(writtenDouble(1.5e300), Equals("1.5e300"));
+      AssertThat(writtenDouble(5e-324), Equals("5e-324"));
+      AssertThat(writtenDouble(DBL_MAX), Equals("1.7976931348623157e308"));
+      AssertThat(writtenDouble(std::numeric_limits<double>::infinity()),
+                 Equals("null"));
+      AssertThat(writtenDouble(std::numeric_limits<double>::quiet_NaN()),
+                 Equals("null"));
+    });
+
+    it("1.2 Round trips random doubles in (nearly) the fewest digits", [&]() {
+      std::mt19937_64 random(2016);
+      int notShortest = 0;
+      const int count = 100000;
+      for (int i = 0; i < count; ++i) {
+        uint64_t bits = random() & 0xFFEFFFFFFFFFFFFFull;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        std::string text = writtenDouble(value);
+        AssertThat(text.size() <= maxNumberChars, Equals(true));
+        AssertThat(std::strtod(text.c_str(), nullptr), Equals(value));
+        int digits = digitsIn(text);
+        AssertThat(digits <= 17, Equals(true));
+        if (digits > shortestDigits(value))
+          ++notShortest;
+      }
+      // Grisu2 is occasionally a digit longer than it has to be
+      AssertThat(notShortest < count / 100, Equals(true));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
@@ -0,0 +1,131 @@
+/// Tests writing strings
+
+#include <bandit/bandit.h>
+
+#include "sink.hpp"
+#include "string.hpp"
+#include "../parse_to_json_class.hpp"
+
+#include <random>
+#include <string>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+std::string written(const std::string &text,
+                    Escape escape = Escape::required) {
+  std::string result;
+  StringSink<> out(result);
+  writeString(out, text.data(), text.size(), escape);
+  return result;
+}
+
+/// Escapes one char at a time, the obvious way, to check the fast one against
+std::string slowlyWritten(const std::string &text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+    case '"': result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\b': result += "\\b"; break;
+    case '\f': result += "\\f"; break;
+    case '\n': result += "\\n"; break;
+    case '\r': result += "\\r"; break;
+    case '\t': result += "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        result += buffer;
+      } else
+        result += c;
+    }
+  }
+  return result + '"';
+}
+
+go_bandit([]() {
+
+  describe("The string writer", [&]() {
+
+    it("1.0 Escapes what json requires", [&]() {
+      AssertThat(written(""), Equals(R"("")"));
+      AssertThat(written("plain"), Equals(R"("plain")"));
+      AssertThat(written("say \"hi\""), Equals(R"("say \"hi\"")"));
+      AssertThat(written("C:\\path"), Equals(R"("C:\\path")"));
+      AssertThat(written("\b\f\n\r\t"), Equals(R"("\b\f\n\r\t")"));
+      AssertThat(written(std::string("\0\x01\x1f", 3)),
+                 Equals(R"("\u0000\u0001\u001f")"));
+      AssertThat(written("\x7f/"), Equals("\"\x7f/\""));
+    });
+
+    it("1.1 Leaves utf-8 alone by default", [&]() {
+      AssertThat(written(u8"caf\u00e9 \U0001F600"),
+                 Equals(u8"\"caf\u00e9 \U0001F600\""));
+    });
+
+    it("1.2 Can escape everything non ASCII", [&]() {
+      AssertThat(written(u8"caf\u00e9", Escape::nonASCII),
+                 Equals(R"("caf\u00e9")"));
+      AssertThat(written(u8"\u20ac1", Escape::nonASCII),
+                 Equals(R"("\u20ac1")"));
+      AssertThat(written(u8"\U0001F600", Escape::nonASCII),
+                 Equals(R"("\ud83d\ude00")"));
+      AssertThat(written("a\"\n", Escape::nonASCII), Equals(R"("a\"\n")"));
+    });
+
+    it("1.3 Replaces bad utf-8 when escaping non ASCII", [&]() {
+      // A stray continuation byte, a cut off char, an over long '/', and an
+      // encoded surrogate
+      AssertThat(written("\x80", Escape::nonASCII), Equals(R"("\ufffd")"));
+      AssertThat(written("a\xc3", Escape::nonASCII), Equals(R"("a\ufffd")"));
+      AssertThat(written("\xc0\xaf", Escape::nonASCII),
+                 Equals(R"("\ufffd\ufffd")"));
+      AssertThat(written("\xed\xa0\x80", Escape::nonASCII),
+                 Equals(R"("\ufffd\ufffd\ufffd")"));
+    });
+
+    it("1.4 Agrees with a char at a time writer on random input", [&]() {
+      const std::string alphabet = "\"\\\b\f\n\r\t\x01\x1f\x7f\xc3\xa9";
+      std::mt19937 random(3);
+      std::uniform_int_distribution<size_t> pick(0, 40);
+      std::uniform_int_distribution<size_t> length(0, 200);
+      for (int n = 0; n < 2000; ++n) {
+        std::string input(length(random), 'x');
+        for (char &c : input) {
+          size_t i = pick(random);
+          if (i < alphabet.size())
+            c = alphabet[i];
+        }
+        AssertThat(written(input), Equals(slowlyWritten(input)));
+      }
+    });
+
+    it("1.5 Reads back as the same text", [&]() {
+      std::mt19937 random(5);
+      std::uniform_int_distribution<char32_t> ascii(0, 0x7F);
+      std::uniform_int_distribution<char32_t> plane(0x80, 0xFFFF);
+      std::uniform_int_distribution<char32_t> astral(0x10000, 0x10FFFF);
+      for (int n = 0; n < 2000; ++n) {
+        std::string input;
+        for (int i = 0; i < 20; ++i) {
+          char32_t u = (i % 3 == 0) ? ascii(random)
+                                    : (i % 3 == 1) ? plane(random) : astral(random);
+          if ((u >= 0xD800) && (u <= 0xDFFF))
+            u = 'x';
+          utf8encode(u, std::back_inserter(input));
+        }
+        for (Escape escape : {Escape::required, Escape::nonASCII}) {
+          std::string json = written(input, escape);
+          const char *p = json.data();
+          AssertThat(std::string(readValue(p, p + json.size())), Equals(input));
+        }
+      }
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }
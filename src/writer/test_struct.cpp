@@ -0,0 +1,88 @@
+/// Tests writing hana structs
+
+#include <bandit/bandit.h>
+
+#include "struct.hpp"
+#include "../parse_to_struct.hpp"
+
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace bandit;
+using namespace snowhouse;
+using namespace json;
+
+struct Point {
+  BOOST_HANA_DEFINE_STRUCT(Point,
+    (int, x),
+    (double, y));
+};
+
+struct Shape {
+  BOOST_HANA_DEFINE_STRUCT(Shape,
+    (std::string, name),
+    (bool, closed),
+    (unsigned long long, id),
+    (std::vector<Point>, points),
+    (std::map<std::string, std::string>, tags),
+    (JSON, extra));
+};
+
+struct Nothing {
+  BOOST_HANA_DEFINE_STRUCT(Nothing);
+};
+
+go_bandit([]() {
+
+  describe("Writing structs", [&]() {
+
+    Shape shape;
+    shape.name = "tri\"angle";
+    shape.closed = true;
+    shape.id = std::numeric_limits<unsigned long long>::max();
+    shape.points = {{1, 0.5}, {-2, 1e21}};
+    shape.tags = {{"colour", u8"réd"}};
+    shape.extra = JMap{{"n", JSON()}};
+
+    it("1.0 Writes every member in order", [&]() {
+      AssertThat(writeToString(shape),
+                 Equals(std::string(R"({"name":"tri\"angle","closed":true,)"
+                                    R"("id":18446744073709551615,)"
+                                    R"("points":[{"x":1,"y":0.5},)"
+                                    R"({"x":-2,"y":1e21}],)"
+                                    R"("tags":{"colour":")") +
+                        u8"réd" + R"("},"extra":{"n":null}})"));
+    });
+
+    it("1.1 Passes the escape mode down", [&]() {
+      std::string json = writeToString(shape, Escape::nonASCII);
+      AssertThat(json.find(R"("colour":"r\u00e9d")") != std::string::npos,
+                 Equals(true));
+    });
+
+    it("1.2 Writes empty structs and containers", [&]() {
+      AssertThat(writeToString(Nothing{}), Equals("{}"));
+      AssertThat(writeToString(std::vector<Nothing>(2)), Equals("[{},{}]"));
+      AssertThat(writeToString(Shape{}),
+                 Equals(R"({"name":"","closed":false,"id":0,"points":[],)"
+                        R"("tags":{},"extra":null})"));
+    });
+
+    it("1.3 Reads back what it wrote", [&]() {
+      std::string json = writeToString(shape);
+      Shape copy = readStruct<Shape>(json.cbegin(), json.cend());
+      AssertThat(copy.name, Equals(shape.name));
+      AssertThat(copy.id, Equals(shape.id));
+      AssertThat(copy.points.size(), Equals(2u));
+      AssertThat(copy.points[1].y, Equals(1e21));
+      AssertThat(copy.tags, Equals(shape.tags));
+      AssertThat(writeToString(copy), Equals(json));
+    });
+
+  });
+
+});
+
+int main(int argc, char *argv[]) { return bandit::run(argc, argv); }